@@ -0,0 +1,297 @@
+#include "ACAnalysis.h"
+#include "Controller/ThreadPool.h"
+#include "Model/Graph.h"
+#include "Model/MNASolver.h"
+#include "Model/NodeManager.h"
+#include "Model/Elements.h"
+
+#include <eigen3/Eigen/SparseLU>
+#include <eigen3/Eigen/OrderingMethods>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numbers>
+
+using cd = std::complex<double>;
+using SparseMatrixC = Eigen::SparseMatrix<cd>;
+
+ACAnalysis::ACAnalysis(Graph& g, MNASolver& s, NodeManager& n) : graph(g), solver(s), nm(n) {}
+
+std::vector<double> ACAnalysis::sweepPoints(const ACSweepConfig& cfg) {
+    std::vector<double> w;
+    if (cfg.N <= 0 || cfg.w_start <= 0.0 || cfg.w_stop < cfg.w_start) return w;
+
+    if (cfg.type == SweepType::Linear) {
+        if (cfg.N == 1) return {cfg.w_start};
+        for (int i = 0; i < cfg.N; ++i)
+            w.push_back(cfg.w_start + (cfg.w_stop - cfg.w_start) * i / (cfg.N - 1));
+        return w;
+    }
+
+    // N points per decade/octave starting at w_start; the last point is w_stop itself
+    double base = (cfg.type == SweepType::Decade) ? 10.0 : 2.0;
+    double span = std::log(cfg.w_stop / cfg.w_start) / std::log(base);
+    long steps = static_cast<long>(std::floor(span * cfg.N + 1e-9));
+    for (long i = 0; i <= steps; ++i) w.push_back(cfg.w_start * std::pow(base, static_cast<double>(i) / cfg.N));
+    if (w.back() < cfg.w_stop * (1.0 - 1e-12)) w.push_back(cfg.w_stop);
+    return w;
+}
+
+bool ACAnalysis::linearize() {
+    graph.canonicalizeNodes(nm);
+    solver.initializeMatrix(graph);
+    if (!solver.hasUnknowns()) {
+        std::cerr << "Error: AC analysis cannot run, the circuit is not correctly defined." << std::endl;
+        return false;
+    }
+
+    op = Eigen::VectorXd::Zero(solver.getTotalUnknowns());
+    if (!SimulationRunner::solveOperatingPoint(graph, solver, op)) {
+        std::cerr << "Error: DC operating point did not converge; AC analysis aborted." << std::endl;
+        return false;
+    }
+
+    sys = SmallSignalSystem(solver.getTotalUnknowns());
+    for (const Element* e : graph.getElements()) {
+        e->stampAC(sys, solver.getNodeToMatrixIdxMap(), solver.getExtraVariableStartIndex(), op);
+    }
+    for (int i = 0; i < solver.getNumNonGroundNodes(); ++i) sys.addG(i, i, solver.getGmin());
+    return true;
+}
+
+cd ACAnalysis::Probe::eval(const Eigen::VectorXcd& x, double omega) const {
+    if (row >= 0) return x(row);
+    cd sum = -src;
+    for (const Term& t : terms) sum += cd(t.g, omega * t.c) * x(t.col);
+    return sign * sum;
+}
+
+bool ACAnalysis::makeProbe(const OutputVariable& var, Probe& probe) const {
+    return makeProbe(graph, solver, nm, op, var, probe);
+}
+
+bool ACAnalysis::makeProbe(const Graph& g, const MNASolver& solver, NodeManager& nm,
+                           const Eigen::VectorXd& op, const OutputVariable& var, Probe& probe) {
+    const auto& idx = solver.getNodeToMatrixIdxMap();
+    probe = Probe{};
+
+    if (var.type == OutputVariable::VOLTAGE) {
+        // Ground leaves row at -1 and reads as 0
+        return SimulationRunner::voltageRow(g, solver, nm, var.name, probe.row);
+    }
+
+    const Element* elem = g.findElement(var.name);
+    if (!elem) return false;
+    if (elem->introducesExtraVariable) {
+        probe.row = solver.getExtraVariableStartIndex() + elem->extraVariableIndex;
+        return true;
+    }
+
+    // Current into node1 through the element = its own KCL row at node1 (or minus node2's)
+    SmallSignalSystem own(solver.getTotalUnknowns());
+    elem->stampAC(own, idx, solver.getExtraVariableStartIndex(), op);
+    int r = (elem->node1 != 0 && idx.count(elem->node1)) ? idx.at(elem->node1) : -1;
+    if (r == -1) {
+        if (elem->node2 == 0 || !idx.count(elem->node2)) return true;
+        r = idx.at(elem->node2);
+        probe.sign = -1.0;
+    }
+    for (const auto& t : own.G) if (t.row() == r) probe.terms.push_back({t.col(), t.value(), 0.0});
+    for (const auto& t : own.C) if (t.row() == r) probe.terms.push_back({t.col(), 0.0, t.value()});
+    probe.src = own.u(r);
+    return true;
+}
+
+PlotData ACAnalysis::run(const ACSweepConfig& cfg, const std::vector<OutputVariable>& vars) {
+    PlotData pd;
+    pd.axis = PlotAxis::Frequency;
+
+    std::vector<double> omegas = sweepPoints(cfg);
+    if (omegas.empty()) {
+        std::cerr << "Error: Invalid AC sweep (need N > 0 and 0 < start <= stop)." << std::endl;
+        return pd;
+    }
+    if (!linearize()) return pd;
+    if (sys.u.isZero()) {
+        std::cerr << "Error: No AC excitation. Use 'ac <source> <magnitude> [<phase>]' first." << std::endl;
+        return pd;
+    }
+
+    std::vector<Probe> probes(vars.size());
+    for (size_t v = 0; v < vars.size(); ++v) {
+        if (!makeProbe(vars[v], probes[v])) {
+            std::cerr << "Warning: " << (vars[v].type == OutputVariable::VOLTAGE ? "V(" : "I(")
+                      << vars[v].name << ") not found; it will read as 0." << std::endl;
+        }
+    }
+
+    // G and C on one shared pattern (explicit zeros where only the other one has an entry)
+    const int n = sys.n;
+    std::vector<Eigen::Triplet<cd>> tg, tc;
+    tg.reserve(sys.G.size() + sys.C.size());
+    tc.reserve(sys.G.size() + sys.C.size());
+    for (const auto& t : sys.G) { tg.emplace_back(t.row(), t.col(), t.value()); tc.emplace_back(t.row(), t.col(), 0.0); }
+    for (const auto& t : sys.C) { tg.emplace_back(t.row(), t.col(), 0.0); tc.emplace_back(t.row(), t.col(), t.value()); }
+    SparseMatrixC Gm(n, n), Cm(n, n);
+    Gm.setFromTriplets(tg.begin(), tg.end());
+    Cm.setFromTriplets(tc.begin(), tc.end());
+
+    // Symbolic step, once: fill-reducing column order on the shared pattern
+    Eigen::COLAMDOrdering<int> ordering;
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> perm;
+    ordering(Gm, perm);
+    SparseMatrixC Gp = Gm * perm, Cp = Cm * perm;
+    Gp.makeCompressed();
+    Cp.makeCompressed();
+    const cd* gv = Gp.valuePtr();
+    const cd* cv = Cp.valuePtr();
+    const Eigen::Index nnz = Gp.nonZeros();
+
+    struct Slot {
+        SparseMatrixC Y;
+        Eigen::SparseLU<SparseMatrixC, Eigen::NaturalOrdering<int>> lu;
+    };
+
+    const size_t F = omegas.size(), P = vars.size();
+    unsigned nWorkers = cfg.workers ? cfg.workers : defaultWorkerCount();
+    nWorkers = static_cast<unsigned>(std::min<size_t>(nWorkers, F));
+    std::vector<std::unique_ptr<Slot>> slots(nWorkers);
+    std::vector<cd> results(F * P, cd(std::numeric_limits<double>::quiet_NaN(), 0.0));
+    std::atomic<int> failed{0};
+
+    std::cout << "AC analysis: " << F << " frequency points on " << nWorkers << " worker(s)" << std::endl;
+
+    parallelFor(F, nWorkers, [&](size_t i, unsigned wi) {
+        if (!slots[wi]) {
+            slots[wi] = std::make_unique<Slot>();
+            slots[wi]->Y = Gp;
+            slots[wi]->lu.analyzePattern(slots[wi]->Y);
+        }
+        Slot& s = *slots[wi];
+        const double w = omegas[i];
+        cd* yv = s.Y.valuePtr();
+        for (Eigen::Index k = 0; k < nnz; ++k) yv[k] = gv[k] + cd(0.0, w) * cv[k];
+
+        s.lu.factorize(s.Y);
+        if (s.lu.info() != Eigen::Success) { ++failed; return; }
+        Eigen::VectorXcd x = perm * Eigen::VectorXcd(s.lu.solve(sys.u));
+        for (size_t p = 0; p < P; ++p) results[i * P + p] = probes[p].eval(x, w);
+    });
+
+    if (failed) std::cerr << "Warning: AC matrix was singular at " << failed << " frequency point(s)." << std::endl;
+
+    pd.time_axis.reserve(F);
+    for (double w : omegas) pd.time_axis.push_back(w / (2.0 * std::numbers::pi));
+
+    for (size_t p = 0; p < P; ++p) {
+        std::string base = (vars[p].type == OutputVariable::VOLTAGE ? "V(" : "I(") + vars[p].name + ")";
+        std::vector<double> mag(F), phase(F);
+        double offset = 0.0, last = 0.0;
+        for (size_t i = 0; i < F; ++i) {
+            cd v = results[i * P + p];
+            double m = std::abs(v);
+            mag[i] = cfg.out_in_dB ? 20.0 * std::log10(std::max(m, 1e-300)) : m;
+
+            // Unwrap so a Bode phase does not jump by a full turn
+            double ph = std::arg(v) * 180.0 / std::numbers::pi;
+            if (i > 0 && std::isfinite(ph) && std::isfinite(last)) {
+                double d = ph + offset - last;
+                if (d > 180.0) offset -= 360.0;
+                else if (d < -180.0) offset += 360.0;
+            }
+            ph += offset;
+            last = ph;
+            phase[i] = cfg.phase_in_deg ? ph : ph * std::numbers::pi / 180.0;
+        }
+        pd.series_names.push_back((cfg.out_in_dB ? "dB(" : "mag(") + base + ")");
+        pd.data_series.push_back(std::move(mag));
+        pd.series_names.push_back("ph(" + base + ")");
+        pd.data_series.push_back(std::move(phase));
+    }
+    return pd;
+}
+
+PlotData ACAnalysis::runPhaseSweep(const PhaseSweepConfig& cfg, const std::vector<OutputVariable>& vars) {
+    PlotData pd;
+    pd.axis = PlotAxis::Phase;
+
+    Element* swept = graph.findElement(cfg.source_name);
+    if (!swept) {
+        std::cerr << "Error: Source '" << cfg.source_name << "' not found for phase sweep." << std::endl;
+        return pd;
+    }
+    if (cfg.N <= 0 || cfg.w0 <= 0.0) {
+        std::cerr << "Error: Invalid phase sweep (need N > 0 and w0 > 0)." << std::endl;
+        return pd;
+    }
+
+    // The swept source drives at its AC magnitude (1 if none was set); its phase is the sweep variable
+    const double savedPhase = swept->acPhase, savedMag = swept->acMagnitude;
+    if (swept->acMagnitude == 0.0) swept->acMagnitude = 1.0;
+    swept->acPhase = 0.0;
+    bool ok = linearize();
+    SmallSignalSystem own(sys.n);
+    if (ok) swept->stampAC(own, solver.getNodeToMatrixIdxMap(), solver.getExtraVariableStartIndex(), op);
+
+    std::vector<Probe> probes(vars.size());
+    for (size_t v = 0; ok && v < vars.size(); ++v) {
+        if (!makeProbe(vars[v], probes[v])) {
+            std::cerr << "Warning: " << (vars[v].type == OutputVariable::VOLTAGE ? "V(" : "I(")
+                      << vars[v].name << ") not found; it will read as 0." << std::endl;
+        }
+    }
+    swept->acPhase = savedPhase;
+    swept->acMagnitude = savedMag;
+    if (!ok) return pd;
+
+    // One factorization, two right-hand sides: the swept source alone, and everything else
+    Eigen::SparseMatrix<cd> Y = sys.sparseG().cast<cd>() + cd(0.0, cfg.w0) * sys.sparseC().cast<cd>();
+    Y.makeCompressed();
+    Eigen::SparseLU<Eigen::SparseMatrix<cd>> lu;
+    lu.compute(Y);
+    if (lu.info() != Eigen::Success) {
+        std::cerr << "Error: AC matrix is singular at w0; phase sweep aborted." << std::endl;
+        return pd;
+    }
+    Eigen::MatrixXcd rhs(sys.n, 2);
+    rhs.col(0) = own.u;
+    rhs.col(1) = sys.u - own.u;
+    Eigen::MatrixXcd X = lu.solve(rhs);
+
+    // out(phi) = a + e^{j*phi} * b; only a probe on the swept source itself has a source term in b
+    const size_t P = vars.size();
+    std::vector<cd> a(P), b(P);
+    for (size_t p = 0; p < P; ++p) {
+        const bool self = vars[p].type == OutputVariable::CURRENT && vars[p].name == cfg.source_name;
+        Probe pa = probes[p], pb = probes[p];
+        (self ? pa.src : pb.src) = 0.0;
+        a[p] = pa.eval(X.col(1), cfg.w0);
+        b[p] = pb.eval(X.col(0), cfg.w0);
+    }
+
+    const int N = cfg.N;
+    std::vector<std::vector<double>> mag(P, std::vector<double>(N)), phase(P, std::vector<double>(N));
+    for (int i = 0; i < N; ++i) {
+        double phi = (N == 1) ? cfg.phi_start_deg
+                              : cfg.phi_start_deg + (cfg.phi_stop_deg - cfg.phi_start_deg) * i / (N - 1);
+        pd.time_axis.push_back(phi);
+        cd rot = std::polar(1.0, phi * std::numbers::pi / 180.0);
+        for (size_t p = 0; p < P; ++p) {
+            cd v = a[p] + rot * b[p];
+            mag[p][i] = std::abs(v);
+            phase[p][i] = std::arg(v) * 180.0 / std::numbers::pi;
+        }
+    }
+
+    for (size_t p = 0; p < P; ++p) {
+        std::string base = (vars[p].type == OutputVariable::VOLTAGE ? "V(" : "I(") + vars[p].name + ")";
+        pd.series_names.push_back("mag(" + base + ")");
+        pd.data_series.push_back(std::move(mag[p]));
+        pd.series_names.push_back("ph(" + base + ")");
+        pd.data_series.push_back(std::move(phase[p]));
+    }
+    return pd;
+}
@@ -0,0 +1,68 @@
+#ifndef MORGHSPICY_ACANALYSIS_H
+#define MORGHSPICY_ACANALYSIS_H
+
+#pragma once
+#include <complex>
+#include <string>
+#include <vector>
+#include "Controller/SimConfig.h"
+#include "Controller/SimulationRunner.h"
+#include "Model/SmallSignal.h"
+
+class Graph;
+class MNASolver;
+class NodeManager;
+class Element;
+
+// Complex small-signal analysis around the DC operating point.
+// Y(jw) = G + jw*C keeps the same sparsity pattern at every frequency, so the fill-reducing
+// column order is computed once and every frequency only does a numeric refactorization.
+// Frequency points are spread over worker threads, each with its own copy of Y and its LU.
+class ACAnalysis {
+public:
+    ACAnalysis(Graph& g, MNASolver& solver, NodeManager& nm);
+
+    // Solves the operating point and builds the small-signal system around it.
+    // Returns false (after reporting) when the circuit cannot be linearized.
+    bool linearize();
+    const SmallSignalSystem& system() const { return sys; }
+    const Eigen::VectorXd& operatingPoint() const { return op; }
+
+    // time_axis holds Hz; each variable gives a magnitude and an (unwrapped) phase series
+    PlotData run(const ACSweepConfig& cfg, const std::vector<OutputVariable>& vars);
+
+    // Fixed w0, the named source's phase swept. Y(jw0) is factored once and both the
+    // swept source's response and everyone else's are solved against it; every phase
+    // point is then a + e^{j*phi} * b per output (superposition). time_axis holds degrees.
+    PlotData runPhaseSweep(const PhaseSweepConfig& cfg, const std::vector<OutputVariable>& vars);
+
+    // Sweep points in rad/s
+    static std::vector<double> sweepPoints(const ACSweepConfig& cfg);
+
+    // Reads one output from a small-signal solution
+    struct Probe {
+        int row = -1;   // voltage / branch current: the unknown itself
+        // Two-terminal current: sign * (sum (g + jw*c) * x[col] - src)
+        struct Term { int col; double g, c; };
+        std::vector<Term> terms;
+        std::complex<double> src{};
+        double sign = 1.0;
+
+        std::complex<double> eval(const Eigen::VectorXcd& x, double omega) const;
+    };
+    // false when the node or element does not exist
+    bool makeProbe(const OutputVariable& var, Probe& probe) const;
+    // Same, for any graph/solver pair linearized at op (w = 0 gives the DC output functional)
+    static bool makeProbe(const Graph& g, const MNASolver& solver, NodeManager& nm,
+                          const Eigen::VectorXd& op, const OutputVariable& var, Probe& probe);
+
+private:
+    Graph& graph;
+    MNASolver& solver;
+    NodeManager& nm;
+
+    SmallSignalSystem sys;
+    Eigen::VectorXd op;
+};
+
+#endif //MORGHSPICY_ACANALYSIS_H
@@ -0,0 +1,206 @@
+#include "CircuitSnapshot.h"
+#include "Model/Graph.h"
+#include "Model/MappedFile.h"
+#include "Model/NodeManager.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+    constexpr char MAGIC[8] = {'M', 'S', 'N', 'A', 'P', '0', '0', '2'};   // bump when the layout or the meaning of a record changes
+
+    struct Header {
+        char magic[8];
+        std::uint64_t key;
+        std::uint64_t netlistBytes;
+        std::uint64_t labels, records, textBytes;
+        std::uint64_t lines, delegated;   // stats of the load it was taken from
+    };
+
+    struct LabelRecord {
+        std::int32_t id;
+        std::uint32_t length;
+        std::uint64_t text;
+    };
+
+    using Record = CircuitSnapshot::Writer::Record;
+
+    std::uint64_t mix(std::uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // Four independent lanes of 8-byte words, so hashing a large netlist is memory bound
+    std::uint64_t hashBytes(std::string_view s, std::uint64_t seed) {
+        constexpr std::uint64_t K = 0x9E3779B97F4A7C15ULL;
+        std::uint64_t lane[4] = {seed, seed ^ K, seed + K, seed - K};
+        const char* p = s.data();
+        std::size_t n = s.size();
+        for (; n >= 32; p += 32, n -= 32) {
+            for (int i = 0; i < 4; ++i) {
+                std::uint64_t w;
+                std::memcpy(&w, p + 8 * i, 8);
+                lane[i] = ((lane[i] ^ w) * K);
+                lane[i] ^= lane[i] >> 29;
+            }
+        }
+        std::uint64_t h = mix(lane[0]) ^ mix(lane[1] + 1) ^ mix(lane[2] + 2) ^ mix(lane[3] + 3);
+        for (; n > 0; ++p, --n) h = (h ^ static_cast<unsigned char>(*p)) * 0x100000001B3ULL;
+        return mix(h ^ s.size());
+    }
+
+    bool inText(std::uint64_t offset, std::uint64_t length, std::uint64_t textBytes) {
+        return offset <= textBytes && length <= textBytes - offset;
+    }
+}
+
+namespace CircuitSnapshot {
+    std::uint64_t key(std::string_view netlist, const std::vector<std::string>& librarySubcircuits) {
+        std::uint64_t h = hashBytes(netlist, 0);
+        for (const std::string& name : librarySubcircuits) h = hashBytes(name, h);
+        return h;
+    }
+
+    std::string pathOf(std::uint64_t key) {
+        char hex[17];
+        std::snprintf(hex, sizeof hex, "%016llx", static_cast<unsigned long long>(key));
+        return std::string("snapshots/") + hex + ".snap";
+    }
+
+    bool restore(std::uint64_t key, std::size_t netlistBytes, Graph& g, NodeManager& nm,
+                 const std::function<void(const std::string& command)>& fallback, NetlistLoadStats& stats) {
+        MappedFile file(pathOf(key));
+        if (!file.isOpen() || file.size() < sizeof(Header)) return false;
+        Header h;
+        std::memcpy(&h, file.data(), sizeof h);
+        if (std::memcmp(h.magic, MAGIC, sizeof MAGIC) != 0 || h.key != key || h.netlistBytes != netlistBytes)
+            return false;
+
+        const std::size_t labelsAt = sizeof(Header);
+        const std::size_t recordsAt = labelsAt + h.labels * sizeof(LabelRecord);
+        const std::size_t textAt = recordsAt + h.records * sizeof(Record);
+        if (h.labels > file.size() || h.records > file.size() || textAt + h.textBytes != file.size()) return false;
+        const char* text = file.data() + textAt;
+
+        auto labelAt = [&](std::size_t i) {
+            LabelRecord l;
+            std::memcpy(&l, file.data() + labelsAt + i * sizeof l, sizeof l);
+            return l;
+        };
+        auto recordAt = [&](std::size_t i) {
+            Record r;
+            std::memcpy(&r, file.data() + recordsAt + i * sizeof r, sizeof r);
+            return r;
+        };
+
+        // Check everything before touching the circuit, so a damaged file is just a miss
+        for (std::size_t i = 0; i < h.labels; ++i) {
+            const LabelRecord l = labelAt(i);
+            if (l.id < 0 || !inText(l.text, l.length, h.textBytes)) return false;
+        }
+        for (std::size_t i = 0; i < h.records; ++i) {
+            const Record r = recordAt(i);
+            if (r.node1 < 0 || r.node2 < 0 || r.nameLength == 0 ||
+                !inText(r.text, std::uint64_t(r.nameLength) + r.modelLength, h.textBytes) ||
+                !std::strchr("RCLVIDX", r.type))
+                return false;
+        }
+
+        Graph::BulkEdit bulk(g, nm, h.records);
+        for (std::size_t i = 0; i < h.labels; ++i) {
+            const LabelRecord l = labelAt(i);
+            nm.restoreLabel(std::string_view(text + l.text, l.length), l.id);
+        }
+        for (std::size_t i = 0; i < h.records; ++i) {
+            const Record r = recordAt(i);
+            std::string name(text + r.text, r.nameLength);
+            if (r.type == 'X') {
+                fallback(name);
+                ++stats.delegated;
+                continue;
+            }
+            nm.restoreNode(r.node1);
+            nm.restoreNode(r.node2);
+            Element* e = nullptr;
+            switch (r.type) {
+                case 'R': e = g.make<Resistor>(std::move(name), r.node1, r.node2, r.value); break;
+                case 'C': e = g.make<Capacitor>(std::move(name), r.node1, r.node2, r.value); break;
+                case 'L': e = g.make<Inductor>(std::move(name), r.node1, r.node2, r.value); break;
+                case 'V': e = g.make<VoltageSource>(std::move(name), r.node1, r.node2, r.value); break;
+                case 'I': e = g.make<CurrentSource>(std::move(name), r.node1, r.node2, r.value); break;
+                default:
+                    e = g.make<Diode>(std::move(name), r.node1, r.node2,
+                                      std::string(text + r.text + r.nameLength, r.modelLength));
+                    break;
+            }
+            g.addElement(e);
+            ++stats.elements;
+        }
+        stats.lines = h.lines;
+        return true;
+    }
+
+    void Writer::element(char type, std::string_view name, int n1, int n2, double value, std::string_view model) {
+        Record r{};
+        r.value = value;
+        r.node1 = n1;
+        r.node2 = n2;
+        r.text = text.size();
+        r.nameLength = static_cast<std::uint32_t>(name.size());
+        r.modelLength = static_cast<std::uint32_t>(model.size());
+        r.type = type;
+        text.append(name).append(model);
+        records.push_back(r);
+    }
+
+    void Writer::command(std::string_view command) {
+        element('X', command, 0, 0, 0.0);
+    }
+
+    bool Writer::write(std::uint64_t key, std::size_t netlistBytes, const NodeManager& nm, const NetlistLoadStats& stats) const {
+        // Label text goes after the record text
+        std::vector<LabelRecord> labels;
+        std::string labelText;
+        nm.forEachLabel([&](std::string_view label, int id) {
+            labels.push_back(LabelRecord{id, static_cast<std::uint32_t>(label.size()), text.size() + labelText.size()});
+            labelText.append(label);
+        });
+
+        Header h{};
+        std::memcpy(h.magic, MAGIC, sizeof MAGIC);
+        h.key = key;
+        h.netlistBytes = netlistBytes;
+        h.labels = labels.size();
+        h.records = records.size();
+        h.textBytes = text.size() + labelText.size();
+        h.lines = stats.lines;
+        h.delegated = stats.delegated;
+
+        std::error_code ec;
+        std::filesystem::create_directories("snapshots", ec);
+        const std::string path = pathOf(key);
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char*>(&h), sizeof h);
+            out.write(reinterpret_cast<const char*>(labels.data()), static_cast<std::streamsize>(labels.size() * sizeof(LabelRecord)));
+            out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(Record)));
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+            out.write(labelText.data(), static_cast<std::streamsize>(labelText.size()));
+            if (!out) {
+                out.close();
+                std::filesystem::remove(tmp, ec);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmp, path, ec);
+        return !ec;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef MORGHSPICY_CIRCUITSNAPSHOT_H
+#define MORGHSPICY_CIRCUITSNAPSHOT_H
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "NetlistLoader.h"
+
+class Graph;
+class NodeManager;
+
+// Binary image of what loading a netlist into an empty circuit produced: the node labels
+// with their ids and the element list in order, with names and node ids already resolved.
+// Lines the loader delegated to the command parser are kept as their command text and
+// replayed. Snapshots are written only on request (`load <file> snapshot`) and live in
+// snapshots/<key>.snap, where the key hashes the netlist bytes
+// and the library/*.sub names (they decide which lines are subcircuit instances), so an
+// edited netlist simply misses. Restoring maps the file and adds the records, without
+// tokenizing or looking up a single label.
+namespace CircuitSnapshot {
+    std::uint64_t key(std::string_view netlist, const std::vector<std::string>& librarySubcircuits);
+    std::string pathOf(std::uint64_t key);
+
+    // False when there is no valid snapshot for the key; g and nm are untouched then
+    bool restore(std::uint64_t key, std::size_t netlistBytes, Graph& g, NodeManager& nm,
+                 const std::function<void(const std::string& command)>& fallback, NetlistLoadStats& stats);
+
+    // Collects the records of a load as it happens, then writes them with the final labels
+    class Writer {
+    public:
+        // On disk as is, after the header and the labels
+        struct Record {
+            double value;
+            std::int32_t node1, node2;
+            std::uint64_t text;          // offset of the name (or command) in the text block
+            std::uint32_t nameLength;
+            std::uint32_t modelLength;   // diode model, right after the name
+            char type;                   // R C L V I D, or 'X' for a delegated command
+            char pad[7];
+        };
+
+        void element(char type, std::string_view name, int n1, int n2, double value, std::string_view model = {});
+        void command(std::string_view text);
+        // Written to a temporary file and renamed, so a reader never sees half a snapshot
+        bool write(std::uint64_t key, std::size_t netlistBytes, const NodeManager& nm, const NetlistLoadStats& stats) const;
+
+    private:
+        std::vector<Record> records;
+        std::string text;
+    };
+}
+
+#endif //MORGHSPICY_CIRCUITSNAPSHOT_H
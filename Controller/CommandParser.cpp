@@ -4,46 +4,39 @@
 #include "Model/Graph.h"
 #include "Model/NodeManager.h"
 #include "Controller/SimulationRunner.h"
+#include "Controller/MonteCarlo.h"
+#include "Controller/Sensitivity.h"
+#include "Controller/ModelReduction.h"
+#include "Controller/HarmonicBalance.h"
+#include "Controller/Fourier.h"
+#include "Model/Signal.h"
+#include "Controller/NetlistLoader.h"
 #include <sstream>
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <numbers>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 
 CommandParser::CommandParser() = default;
 
 CommandParser::CommandParser(Graph* g, NodeManager* n, SimulationRunner* r)
         : graph(g), nodeManager(n), simRunner(r) {}
 
-bool isNumber(const std::string& s) {
-    std::regex pattern(R"(^[-+]?[0-9]*\.?[0-9]+([eE][-+]?[0-9]+)?$)");
-    return std::regex_match(s, pattern);
-}
-
 double parseValueWithPrefix(const std::string& str) {
-    try {
-        double factor = 1.0;
-        std::string numPart = str;
-
-        char last = tolower(str.back());
-
-        switch (last) {
-            case 'k': factor = 1e3; numPart = str.substr(0, str.size()-1); break;
-            case 'm': factor = 1e-3; numPart = str.substr(0, str.size()-1); break;
-            case 'u': factor = 1e-6; numPart = str.substr(0, str.size()-1); break;
-            case 'n': factor = 1e-9; numPart = str.substr(0, str.size()-1); break;
-            case 'p': factor = 1e-12; numPart = str.substr(0, str.size()-1); break;
-            case 'g': factor = 1e9; numPart = str.substr(0, str.size()-1); break;
-            case 'h': factor = 1e2; numPart = str.substr(0, str.size()-1); break;
-            case 't': factor = 1e12; numPart = str.substr(0, str.size()-1); break;
-            default:
-                if (isNumber(str)) return std::stod(str);
-                break;
-        }
+    double value;
+    return parseEngineeringValue(str, value) ? value : -1e99; // خطا
+}
 
-        return std::stod(numPart) * factor;
-    } catch (...) {
-        return -1e99; // خطا
-    }
+// A whole count in [1, INT_MAX] (samples, points, steps). The double is checked before the
+// cast: a bad token (-1e99) or something like 5G would not fit in an int.
+static bool parseCount(const std::string& str, int& count) {
+    const double v = parseValueWithPrefix(str);
+    if (!(v >= 1.0 && v <= std::numeric_limits<int>::max()) || v != std::floor(v)) return false;
+    count = static_cast<int>(v);
+    return true;
 }
 
 void CommandParser::parseCommandCore(const std::string& line) {
@@ -68,7 +61,7 @@ void CommandParser::parseCommandCore(const std::string& line) {
                 return;
             }
             // Call the helper function to perform the flattening logic
-            handleAddComponent(name, n1_str, n2_str);
+            handleAddComponent(name, n1_str, n2_str, name);
             return; // IMPORTANT: Exit the function after handling the subcircuit
         }
 
@@ -85,11 +78,9 @@ void CommandParser::parseCommandCore(const std::string& line) {
             return;
         }
 
-        for (Element* e : graph->getElements()) {
-            if (e->name == name) {
-                std::cerr << "Error: " << name << " already exists in the circuit\n";
-                return;
-            }
+        if (graph->findElement(name)) {
+            std::cerr << "Error: " << name << " already exists in the circuit\n";
+            return;
         }
 
         std::string n1_str, n2_str;
@@ -97,6 +88,15 @@ void CommandParser::parseCommandCore(const std::string& line) {
             std::cerr << "Error: Syntax error\n";
             return;
         }
+        if (type == 'X') {
+            std::string sub_name;
+            if (!(iss >> sub_name)) {
+                std::cerr << "Error: Syntax for subcircuit instances is 'add X<name> <Node1> <Node2> <SubName>'" << std::endl;
+                return;
+            }
+            handleAddComponent(name, n1_str, n2_str, sub_name);
+            return;
+        }
         std::string next_token;
         // Get the current position in the stream
         std::streampos original_pos = iss.tellg();
@@ -175,12 +175,51 @@ void CommandParser::parseCommandCore(const std::string& line) {
             int n1 = nodeManager->resolveId(n1_str);
             int n2 = nodeManager->resolveId(n2_str);
 
-            graph->addElement(new PulseSource(name, n1, n2, v1, v2, td, tr, tf, pw, per));
+            graph->addElement(graph->make<PulseSource>(name, n1, n2, v1, v2, td, tr, tf, pw, per));
             std::cout << "Added pulse source: " << name << std::endl;
             return; // Important: Exit after handling the pulse source
         }
+        else if (next_token == "PWL") {
+            // add V<name> <n+> <n-> PWL file=<path> [Fs=<Hz>] [chunk=<samples>]
+            // Fs is required except for a .wav file, which carries its own rate
+            const char* usage = "Usage: add V<name> <Node1> <Node2> PWL file=<path> [Fs=<Hz>] [chunk=<samples>]";
+            std::string path, tok;
+            double Fs = 0.0;
+            int chunk = 4096;
+            while (iss >> tok) {
+                const size_t eq = tok.find('=');
+                if (eq == std::string::npos) {
+                    std::cerr << "Error: Unexpected PWL argument: " << tok << ". " << usage << std::endl;
+                    return;
+                }
+                const std::string k = tok.substr(0, eq), v = tok.substr(eq + 1);
+                if (k == "file") path = v;
+                else if (k == "Fs") Fs = parseValueWithPrefix(v);
+                else if (k == "chunk") chunk = std::atoi(v.c_str());
+                else {
+                    std::cerr << "Error: Unknown PWL option: " << k << ". " << usage << std::endl;
+                    return;
+                }
+            }
+            if (type != 'V' || path.empty() || chunk <= 0 || Fs == -1e99) {
+                std::cerr << "Error: " << usage << std::endl;
+                return;
+            }
+            Signal probe(path, Fs);
+            if (!probe.open() || probe.sampleRate() <= 0) {
+                std::cerr << "Error: Cannot read samples from " << path
+                          << (Fs <= 0 ? " (Fs=<Hz> is needed unless it is a .wav file)" : "") << std::endl;
+                return;
+            }
+            auto* src = graph->make<FileSource>(name, nodeManager->resolveId(n1_str), nodeManager->resolveId(n2_str),
+                                                path, Fs, chunk);
+            src->open();
+            graph->addElement(src);
+            std::cout << "Added file source: " << name << " (" << path << ", Fs=" << src->sampleRate() << "Hz)" << std::endl;
+            return;
+        }
         else {
-            // If it wasn't a PULSE source, go back to the original position in the stream
+            // If it wasn't a PULSE or PWL source, go back to the original position in the stream
             iss.seekg(original_pos);
         }
 
@@ -198,7 +237,7 @@ void CommandParser::parseCommandCore(const std::string& line) {
             }
             int n1 = nodeManager->resolveId(n1_str);
             int n2 = nodeManager->resolveId(n2_str);
-            graph->addElement(new Diode(name, n1, n2, model));
+            graph->addElement(graph->make<Diode>(name, n1, n2, model));
             std::cout << "Added diode: " << name << std::endl;
             return;
         }
@@ -220,9 +259,9 @@ void CommandParser::parseCommandCore(const std::string& line) {
             int c2 = nodeManager->resolveId(c2_str);
             Element* e = nullptr;
             if (type == 'G') {
-                e = new vccs(name, n1, n2, c1, c2, gain);
+                e = graph->make<vccs>(name, n1, n2, c1, c2, gain);
             } else {
-                e = new vcvs(name, n1, n2, c1, c2, gain);
+                e = graph->make<vcvs>(name, n1, n2, c1, c2, gain);
             }
             graph->addElement(e);
             std::cout << "Added element: " << name << std::endl;
@@ -244,9 +283,9 @@ void CommandParser::parseCommandCore(const std::string& line) {
             int n2 = nodeManager->resolveId(n2_str);
             Element* e = nullptr;
             if (type == 'F') {
-                e = new cccs(name, n1, n2, ctrl_name, gain);
+                e = graph->make<cccs>(name, n1, n2, ctrl_name, gain);
             } else {
-                e = new ccvs(name, n1, n2, ctrl_name, gain);
+                e = graph->make<ccvs>(name, n1, n2, ctrl_name, gain);
             }
             graph->addElement(e);
             std::cout << "Added element: " << name << std::endl;
@@ -272,7 +311,7 @@ void CommandParser::parseCommandCore(const std::string& line) {
             int n1 = nodeManager->resolveId(n1_str);
             int n2 = nodeManager->resolveId(n2_str);
 
-            Element* e = new SinusoidalSource(name, n1, n2, voffset, vamp, freq, phase);
+            Element* e = graph->make<SinusoidalSource>(name, n1, n2, voffset, vamp, freq, phase);
             graph->addElement(e);
             std::cout << "Added sinusoidal source: " << name << std::endl;
             return;
@@ -311,11 +350,11 @@ void CommandParser::parseCommandCore(const std::string& line) {
         int n2 = nodeManager->resolveId(n2_str);
         Element* e = nullptr;
         switch (type) {
-            case 'R': e = new Resistor(name, n1, n2, value); break;
-            case 'C': e = new Capacitor(name, n1, n2, value); break;
-            case 'L': e = new Inductor(name, n1, n2, value); break;
-            case 'V': e = new VoltageSource(name, n1, n2, value); break;
-            case 'I': e = new CurrentSource(name, n1, n2, value); break;
+            case 'R': e = graph->make<Resistor>(name, n1, n2, value); break;
+            case 'C': e = graph->make<Capacitor>(name, n1, n2, value); break;
+            case 'L': e = graph->make<Inductor>(name, n1, n2, value); break;
+            case 'V': e = graph->make<VoltageSource>(name, n1, n2, value); break;
+            case 'I': e = graph->make<CurrentSource>(name, n1, n2, value); break;
             default:
                 std::cerr << "Error: Element " << name << " not found in library\n";
                 return;
@@ -351,39 +390,24 @@ void CommandParser::parseCommandCore(const std::string& line) {
         nodeManager->renameNode(old_name, new_name);
 
     }else if (cmd == "load") {
-        std::string filepath;
-        if (!(iss >> filepath)) {
-            std::cerr << "Error: Syntax error. Usage: load <file_path>" << std::endl;
-            return;
-        }
-
-        std::ifstream infile(filepath);
-        if (!infile.is_open()) {
-            std::cerr << "Error: Cannot open file: " << filepath << std::endl;
+        // load <file_path> [snapshot]: with snapshot, a clean load is also cached in snapshots/
+        std::string filepath, option;
+        if (!(iss >> filepath) || ((iss >> option) && option != "snapshot")) {
+            std::cerr << "Error: Syntax error. Usage: load <file_path> [snapshot]" << std::endl;
             return;
         }
 
         std::cout << "Loading circuit from file: " << filepath << std::endl;
 
-        std::string file_line;
-        while (std::getline(infile, file_line)) {
-            if (file_line.empty() || file_line[0] == '*' || file_line[0] == '#') {
-                continue;
-            }
-
-            std::istringstream line_stream(file_line);
-            std::string type, name, n1, n2, val;
-
-            if (!(line_stream >> type >> name >> n1 >> n2 >> val)) {
-                std::cerr << "Error: Malformed line in file: " << file_line << std::endl;
-                continue;
-            }
-
-            std::string command_to_process = "add " + name + " " + n1 + " " + n2 + " " + val;
-
-            parseCommand(command_to_process);
+        const size_t before = graph->getElements().size();
+        NetlistLoadStats stats;
+        if (!loadNetlist(filepath, *graph, *nodeManager, [this](const std::string& c) { parseCommand(c); }, &stats,
+                         option == "snapshot")) {
+            std::cerr << "Error: Cannot open file: " << filepath << std::endl;
+            return;
         }
-        std::cout << std::flush;
+        std::cout << "Added " << graph->getElements().size() - before << " elements from " << stats.lines << " lines"
+                  << (stats.fromSnapshot ? " (snapshot)" : "") << "\n";
         std::cout << "Finished loading from file." << std::endl;
     }
     else if (cmd == "show") {
@@ -401,6 +425,18 @@ void CommandParser::parseCommandCore(const std::string& line) {
     else if (cmd == "save") {
         handleSaveCommand(iss);
     }
+    else if (cmd == "tolerance") {
+        handleTolerance(iss);
+    }
+    else if (cmd == "diode") {
+        handleDiodeModel(iss);
+    }
+    else if (cmd == "ac") {
+        handleACSource(iss);
+    }
+    else if (cmd == "reduce") {
+        handleReduce(iss);
+    }
     else if (cmd == "subcircuit") {
         std::string action, subName, from_keyword, n1_str, n2_str;
         if (!(iss >> action >> subName >> from_keyword >> n1_str >> n2_str) || action != "create" || from_keyword != "from") {
@@ -449,6 +485,7 @@ void CommandParser::parseCommandCore(const std::string& line) {
         }
 
         outfile.close();
+        subcircuits.forget(subName);
         std::cout << "SUCCESS: Subcircuit '" << subName << "' saved to " << sub_path << std::endl;
     }
 
@@ -537,29 +574,10 @@ void CommandParser::handlePrintCommand(std::istringstream& iss) {
         }
 
         std::vector<OutputVariable> requested_vars;
-        std::string var_token;
-        std::regex var_regex(R"((V|I)\((.+)\))");
-        while (iss >> var_token) {
-            std::smatch matches;
-            if (std::regex_match(var_token, matches, var_regex)) {
-                OutputVariable out_var;
-                out_var.type = (matches[1].str() == "V") ? OutputVariable::VOLTAGE : OutputVariable::CURRENT;
-                out_var.name = matches[2].str();
-                if (out_var.type == OutputVariable::CURRENT && !graph->findElement(out_var.name)) {
-                    std::cout << "Error: Component " << out_var.name << " not found in circuit" << std::endl;
-                    return;
-                }
-                requested_vars.push_back(out_var);
-            } else {
-                std::cerr << "Error: Invalid variable format: " << var_token << std::endl;
-                return;
-            }
-        }
-        if (requested_vars.empty()) {
-            std::cerr << "Error: No output variables specified for print command." << std::endl;
-            return;
-        }
-        simRunner->runTransient(tstep, tstop, tmaxstep, requested_vars);
+        if (!parseOutputList(iss, "TRAN", requested_vars)) return;
+        PlotData pd = simRunner->runTransient(tstep, tstop, tmaxstep, requested_vars);
+        lastWaveform = pd;
+        if (onPlot) onPlot(pd);
 
     } else if (analysis_type == "DC") {
         std::string sourceName, start_str, end_str, inc_str;
@@ -594,10 +612,601 @@ void CommandParser::handlePrintCommand(std::istringstream& iss) {
             return;
         }
         simRunner->runDCSweep(sourceName, start_val, end_val, inc_val, requested_vars);
+    } else if (analysis_type == "AC") {
+        handleAC(iss);
+    } else if (analysis_type == "PHASE") {
+        handlePhaseSweep(iss);
+    } else if (analysis_type == "PSS") {
+        handlePSS(iss);
+    } else if (analysis_type == "HB") {
+        handleHB(iss);
+    } else if (analysis_type == "FOUR") {
+        handleFourier(iss, false);
+    } else if (analysis_type == "FFT") {
+        handleFourier(iss, true);
+    } else if (analysis_type == "SENS") {
+        handleSensitivity(iss, false);
+    } else if (analysis_type == "TF") {
+        handleSensitivity(iss, true);
+    } else if (analysis_type == "MC") {
+        handleMonteCarlo(iss);
     } else {
         std::cerr << "Error: Analysis type '" << analysis_type << "' not supported." << std::endl;
     }
 }
+void CommandParser::handleMonteCarlo(std::istringstream& iss) {
+    // print MC <N> DC <measure>... [seed=<n>] [workers=<n>] [bins=<n>] [batch=0|1]
+    // print MC <N> TRAN <tstep> <tstop> <tmaxstep> <measure>... [options]
+    // measure: V(n) | I(R1) | max(V(n)) | min(...) | avg(...)   (max/min/avg are TRAN only)
+    const char* usage = "Usage: print MC <N> DC|TRAN [<tstep> <tstop> <tmaxstep>] <measure>... [seed=<n>] [workers=<n>] [bins=<n>] [batch=0|1]";
+    MonteCarloConfig cfg;
+    std::string n_str, kind;
+    if (!(iss >> n_str >> kind) || (kind != "DC" && kind != "TRAN")) {
+        std::cerr << "Error: Syntax error. " << usage << std::endl;
+        return;
+    }
+    if (!parseCount(n_str, cfg.N)) {
+        std::cerr << "Error: Monte Carlo sample count must be a positive integer." << std::endl;
+        return;
+    }
+
+    if (kind == "TRAN") {
+        std::string tstep_str, tstop_str, tmaxstep_str;
+        if (!(iss >> tstep_str >> tstop_str >> tmaxstep_str)) {
+            std::cerr << "Error: Syntax error. " << usage << std::endl;
+            return;
+        }
+        cfg.analysis = MCAnalysisKind::Transient;
+        cfg.tran.dt_init = parseValueWithPrefix(tstep_str);
+        cfg.tran.t_stop  = parseValueWithPrefix(tstop_str);
+        cfg.tran.dt_max  = parseValueWithPrefix(tmaxstep_str);
+        if (cfg.tran.dt_init <= 0 || cfg.tran.t_stop <= 0 || cfg.tran.dt_max <= 0 || cfg.tran.dt_init > cfg.tran.t_stop) {
+            std::cerr << "Error: Invalid time parameters for TRAN analysis." << std::endl;
+            return;
+        }
+    }
+
+    std::vector<MCMeasure> measures;
+    std::regex agg_regex(R"((max|min|avg)\((.+)\))");
+    std::string tok;
+    while (iss >> tok) {
+        auto eq = tok.find('=');
+        if (eq != std::string::npos) {
+            std::string k = tok.substr(0, eq), v = tok.substr(eq + 1);
+            try {
+                if      (k == "seed")    cfg.seed    = std::stoull(v);
+                else if (k == "workers") cfg.workers = static_cast<unsigned>(std::stoul(v));
+                else if (k == "bins")    cfg.bins    = std::stoi(v);
+                else if (k == "batch")   cfg.batched = std::stoi(v) != 0;
+                else { std::cerr << "Error: Unknown Monte Carlo option: " << k << std::endl; return; }
+            } catch (...) {
+                std::cerr << "Error: Invalid value for " << k << std::endl;
+                return;
+            }
+            continue;
+        }
+
+        MCMeasure m;
+        std::smatch matches;
+        if (std::regex_match(tok, matches, agg_regex)) {
+            if (cfg.analysis == MCAnalysisKind::DC) {
+                std::cerr << "Error: " << matches[1].str() << "() only applies to TRAN Monte Carlo." << std::endl;
+                return;
+            }
+            const std::string agg = matches[1].str();
+            m.kind = agg == "max" ? MCMeasure::MAX : agg == "min" ? MCMeasure::MIN : MCMeasure::AVG;
+            if (!parseOutputVariable(matches[2].str(), m.var)) return;
+        } else if (!parseOutputVariable(tok, m.var)) {
+            return;
+        }
+        measures.push_back(m);
+    }
+    if (measures.empty()) {
+        std::cerr << "Error: No output variables specified for print command." << std::endl;
+        return;
+    }
+
+    MonteCarloResult result = simRunner->runMonteCarlo(cfg, measures);
+    result.print();
+}
+
+void CommandParser::handleAC(std::istringstream& iss) {
+    // print AC <DEC|OCT|LIN> <N> <fstart> <fstop> <var1>... [workers=<n>] [db=0|1] [deg=0|1]
+    // DEC/OCT: N points per decade/octave, LIN: N points in total
+    const char* usage = "Usage: print AC <DEC|OCT|LIN> <N> <fstart> <fstop> <var1>... [workers=<n>] [db=0|1] [deg=0|1]";
+    std::string type_str, n_str, fstart_str, fstop_str;
+    if (!(iss >> type_str >> n_str >> fstart_str >> fstop_str)) {
+        std::cerr << "Error: Syntax error. " << usage << std::endl;
+        return;
+    }
+
+    ACSweepConfig cfg;
+    std::transform(type_str.begin(), type_str.end(), type_str.begin(), ::toupper);
+    if      (type_str == "DEC") cfg.type = SweepType::Decade;
+    else if (type_str == "OCT") cfg.type = SweepType::Octave;
+    else if (type_str == "LIN") cfg.type = SweepType::Linear;
+    else {
+        std::cerr << "Error: Unknown AC sweep type '" << type_str << "'. Use DEC, OCT or LIN." << std::endl;
+        return;
+    }
+    const bool countOk = parseCount(n_str, cfg.N);
+    double fstart = parseValueWithPrefix(fstart_str);
+    double fstop  = parseValueWithPrefix(fstop_str);
+    if (!countOk || fstart <= 0 || fstop < fstart) {
+        std::cerr << "Error: Invalid AC sweep parameters (need N > 0 and 0 < fstart <= fstop)." << std::endl;
+        return;
+    }
+    cfg.w_start = 2.0 * std::numbers::pi * fstart;
+    cfg.w_stop  = 2.0 * std::numbers::pi * fstop;
+
+    std::vector<OutputVariable> requested_vars;
+    const bool ok = parseOutputList(iss, "AC", requested_vars, [&](const std::string& k, const std::string& v) {
+        if      (k == "workers") cfg.workers      = static_cast<unsigned>(std::stoul(v));
+        else if (k == "db")      cfg.out_in_dB    = std::stoi(v) != 0;
+        else if (k == "deg")     cfg.phase_in_deg = std::stoi(v) != 0;
+        else return false;
+        return true;
+    });
+    if (!ok) return;
+
+    PlotData pd = simRunner->runAC(cfg, requested_vars);
+    if (pd.time_axis.empty()) return;
+    printPlotTable(pd, "Freq(Hz)");
+    if (onPlot) onPlot(pd);
+}
+
+void CommandParser::handlePhaseSweep(std::istringstream& iss) {
+    // print PHASE <Source> <f0> <phi_start_deg> <phi_stop_deg> <N> <var1>...
+    std::string src, f0_str, start_str, stop_str, n_str;
+    if (!(iss >> src >> f0_str >> start_str >> stop_str >> n_str)) {
+        std::cerr << "Error: Syntax error. Usage: print PHASE <Source> <f0> <phi_start> <phi_stop> <N> <var1>..." << std::endl;
+        return;
+    }
+    PhaseSweepConfig cfg;
+    cfg.source_name   = src;
+    cfg.w0            = 2.0 * std::numbers::pi * parseValueWithPrefix(f0_str);
+    cfg.phi_start_deg = parseValueWithPrefix(start_str);
+    cfg.phi_stop_deg  = parseValueWithPrefix(stop_str);
+    const bool countOk = parseCount(n_str, cfg.N);
+    if (cfg.w0 <= 0 || !countOk || cfg.phi_start_deg == -1e99 || cfg.phi_stop_deg == -1e99) {
+        std::cerr << "Error: Invalid phase sweep parameters." << std::endl;
+        return;
+    }
+
+    std::vector<OutputVariable> requested_vars;
+    if (!parseOutputList(iss, "PHASE", requested_vars)) return;
+
+    PlotData pd = simRunner->runPhaseSweep(cfg, requested_vars);
+    if (pd.time_axis.empty()) return;
+    printPlotTable(pd, "Phase(deg)");
+    if (onPlot) onPlot(pd);
+}
+
+void CommandParser::handlePSS(std::istringstream& iss) {
+    // print PSS <f0> <steps_per_period> <var1>... [warmup=<periods>] [tol=<rel>] [newton=<n>] [krylov=<n>]
+    const char* usage = "Usage: print PSS <f0> <steps> <var1>... [warmup=<n>] [tol=<rel>] [newton=<n>] [krylov=<n>]";
+    std::string f0_str, steps_str;
+    if (!(iss >> f0_str >> steps_str)) {
+        std::cerr << "Error: Syntax error. " << usage << std::endl;
+        return;
+    }
+    PSSConfig cfg;
+    cfg.f0    = parseValueWithPrefix(f0_str);
+    const bool stepsOk = parseCount(steps_str, cfg.steps);
+    if (cfg.f0 <= 0 || !stepsOk) {
+        std::cerr << "Error: Invalid PSS parameters (need f0 > 0 and steps > 0)." << std::endl;
+        return;
+    }
+
+    std::vector<OutputVariable> requested_vars;
+    const bool ok = parseOutputList(iss, "PSS", requested_vars, [&](const std::string& k, const std::string& v) {
+        if      (k == "warmup") cfg.warmup     = std::stoi(v);
+        else if (k == "tol")    cfg.tol        = std::stod(v);
+        else if (k == "newton") cfg.max_newton = std::stoi(v);
+        else if (k == "krylov") cfg.max_krylov = std::stoi(v);
+        else return false;
+        return true;
+    });
+    if (!ok) return;
+
+    PlotData pd = simRunner->runPSS(cfg, requested_vars);
+    if (pd.time_axis.empty()) return;
+    lastWaveform = pd;
+    if (onPlot) onPlot(pd);
+}
+
+void CommandParser::handleHB(std::istringstream& iss) {
+    // print HB <f0> <harmonics> <var1>... [tol=<abs>] [newton=<n>] [krylov=<n>]
+    const char* usage = "Usage: print HB <f0> <harmonics> <var1>... [tol=<abs>] [newton=<n>] [krylov=<n>]";
+    std::string f0_str, k_str;
+    if (!(iss >> f0_str >> k_str)) {
+        std::cerr << "Error: Syntax error. " << usage << std::endl;
+        return;
+    }
+    HBConfig cfg;
+    cfg.f0 = parseValueWithPrefix(f0_str);
+    const bool harmonicsOk = parseCount(k_str, cfg.K);
+    if (cfg.f0 <= 0 || !harmonicsOk) {
+        std::cerr << "Error: Invalid HB parameters (need f0 > 0 and at least one harmonic)." << std::endl;
+        return;
+    }
+
+    std::vector<OutputVariable> requested_vars;
+    const bool ok = parseOutputList(iss, "HB", requested_vars, [&](const std::string& k, const std::string& v) {
+        if      (k == "tol")    cfg.tol        = std::stod(v);
+        else if (k == "newton") cfg.max_newton = std::stoi(v);
+        else if (k == "krylov") cfg.max_krylov = std::stoi(v);
+        else return false;
+        return true;
+    });
+    if (!ok) return;
+
+    HBResult result;
+    if (simRunner->runHarmonicBalance(cfg, requested_vars, result)) result.print();
+}
+
+void CommandParser::handleFourier(std::istringstream& iss, bool spectrum) {
+    // print FOUR <f0> [<var>...] [harmonics=<n>] [periods=<n>] [points=<n>]
+    // print FFT [<var>...] [window=hann|hamming|blackman|flattop|rect] [points=<n>] [tstart=<s>] [db=0|1]
+    //           [path=<file> Fs=<Hz>]   (text, .f32/.f64 raw little-endian, or .wav without Fs)
+    // Both work on the last print TRAN / PSS waveform (all of its variables when none are named),
+    // or for FFT on a scope sample file.
+    const char* usage = spectrum
+            ? "Usage: print FFT [<var>...] [window=<name>] [points=<n>] [tstart=<s>] [db=0|1] [path=<file> Fs=<Hz>]"
+            : "Usage: print FOUR <f0> [<var>...] [harmonics=<n>] [periods=<n>] [points=<n>]";
+    FourierConfig cfg;
+    if (!spectrum) {
+        std::string f0_str;
+        if (!(iss >> f0_str)) {
+            std::cerr << "Error: Syntax error. " << usage << std::endl;
+            return;
+        }
+        cfg.f0 = parseValueWithPrefix(f0_str);
+        if (cfg.f0 <= 0) {
+            std::cerr << "Error: Invalid fundamental frequency: " << f0_str << std::endl;
+            return;
+        }
+    }
+
+    std::vector<std::string> names;
+    std::string path;
+    double Fs = 0.0;
+    std::string token;
+    std::regex var_regex(R"((V|I)\((.+)\))");
+    while (iss >> token) {
+        auto eq = token.find('=');
+        if (eq != std::string::npos) {
+            std::string k = token.substr(0, eq), v = token.substr(eq + 1);
+            try {
+                if      (k == "harmonics" && !spectrum) cfg.harmonics = std::stoi(v);
+                else if (k == "periods" && !spectrum)   cfg.periods   = std::stoi(v);
+                else if (k == "points")                 cfg.points    = static_cast<size_t>(std::stoul(v));
+                else if (k == "tstart" && spectrum)     cfg.t_start   = parseValueWithPrefix(v);
+                else if (k == "db" && spectrum)         cfg.out_in_dB = (v == "1" || v == "true");
+                else if (k == "path" && spectrum)       path = v;
+                else if (k == "Fs" && spectrum)         Fs = parseValueWithPrefix(v);
+                else if (k == "window" && spectrum) {
+                    if (!FourierAnalysis::parseWindow(v, cfg.window)) {
+                        std::cerr << "Error: Unknown window: " << v << std::endl;
+                        return;
+                    }
+                }
+                else { std::cerr << "Error: Unknown option: " << k << ". " << usage << std::endl; return; }
+            } catch (...) {
+                std::cerr << "Error: Invalid value for " << k << std::endl;
+                return;
+            }
+            continue;
+        }
+        if (!std::regex_match(token, var_regex)) {
+            std::cerr << "Error: Invalid variable format: " << token << std::endl;
+            return;
+        }
+        names.push_back(token);
+    }
+
+    PlotData wave;
+    if (!path.empty()) {
+        Signal sig(path, Fs, std::numeric_limits<double>::infinity());
+        if (!sig.open()) {
+            std::cerr << "Error: Could not read samples from " << path << std::endl;
+            return;
+        }
+        if (sig.format() != SignalFormat::Wav && Fs <= 0) {   // a WAV carries its own rate
+            std::cerr << "Error: path= needs a positive sample rate Fs=<Hz>." << std::endl;
+            return;
+        }
+        const SignalChunk all = sig.readAll();
+        if (all.size() == 0) {
+            std::cerr << "Error: Could not read samples from " << path << std::endl;
+            return;
+        }
+        wave.series_names.push_back(path);
+        wave.time_axis.resize(all.size());
+        for (size_t i = 0; i < all.size(); ++i) wave.time_axis[i] = all.time(i);
+        wave.data_series.emplace_back(all.samples.begin(), all.samples.end());
+    } else if (names.empty()) {
+        wave = lastWaveform;
+    } else {
+        wave.axis = lastWaveform.axis;
+        wave.time_axis = lastWaveform.time_axis;
+        for (const auto& name : names) {
+            auto it = std::find(lastWaveform.series_names.begin(), lastWaveform.series_names.end(), name);
+            if (it == lastWaveform.series_names.end()) {
+                std::cerr << "Error: " << name << " is not in the last transient result." << std::endl;
+                return;
+            }
+            wave.series_names.push_back(name);
+            wave.data_series.push_back(lastWaveform.data_series[it - lastWaveform.series_names.begin()]);
+        }
+    }
+    if (wave.data_series.empty()) {
+        std::cerr << "Error: No waveform to analyse; run print TRAN or print PSS first." << std::endl;
+        return;
+    }
+
+    if (spectrum) {
+        PlotData pd = FourierAnalysis::spectrum(wave, cfg);
+        if (pd.time_axis.empty()) return;
+        // Report the strongest bin of each series rather than the whole table
+        for (size_t v = 0; v < pd.data_series.size(); ++v) {
+            const auto& s = pd.data_series[v];
+            size_t peak = std::max_element(s.begin(), s.end()) - s.begin();
+            std::cout << pd.series_names[v] << ": " << pd.time_axis.size() << " bins of "
+                      << pd.time_axis[0] << " Hz, peak " << s[peak] << " at " << pd.time_axis[peak] << " Hz"
+                      << std::endl;
+        }
+        if (onPlot) onPlot(pd);
+    } else {
+        FourierResult result;
+        if (FourierAnalysis::fourier(wave, cfg, result)) result.print();
+    }
+}
+
+void CommandParser::handleSensitivity(std::istringstream& iss, bool transferFunction) {
+    // print SENS <V(n)|I(elem)>
+    // print TF <V(n)|I(elem)> <InputSource>
+    const char* usage = transferFunction ? "Usage: print TF <V(node)|I(element)> <InputSource>"
+                                         : "Usage: print SENS <V(node)|I(element)>";
+    std::string var_token, input;
+    if (!(iss >> var_token) || (transferFunction && !(iss >> input))) {
+        std::cerr << "Error: Syntax error. " << usage << std::endl;
+        return;
+    }
+    OutputVariable out;
+    if (!parseOutputVariable(var_token, out)) return;
+
+    if (transferFunction) {
+        TransferFunctionResult tf;
+        if (simRunner->runTransferFunction(out, input, tf)) tf.print();
+    } else {
+        SensitivityResult sens;
+        if (simRunner->runSensitivity(out, sens)) sens.print();
+    }
+}
+
+bool CommandParser::parseOutputVariable(const std::string& token, OutputVariable& out) const {
+    static const std::regex var_regex(R"((V|I)\((.+)\))");
+    std::smatch matches;
+    if (!std::regex_match(token, matches, var_regex)) {
+        std::cerr << "Error: Invalid variable format: " << token << std::endl;
+        return false;
+    }
+    out.type = (matches[1].str() == "V") ? OutputVariable::VOLTAGE : OutputVariable::CURRENT;
+    out.name = matches[2].str();
+    if (out.type == OutputVariable::CURRENT && !graph->findElement(out.name)) {
+        std::cout << "Error: Component " << out.name << " not found in circuit" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CommandParser::parseOutputList(std::istringstream& iss, const char* analysis, std::vector<OutputVariable>& vars,
+                                    const std::function<bool(const std::string& key, const std::string& value)>& option) const {
+    std::string token;
+    while (iss >> token) {
+        auto eq = token.find('=');
+        if (option && eq != std::string::npos) {
+            std::string k = token.substr(0, eq), v = token.substr(eq + 1);
+            try {
+                if (!option(k, v)) {
+                    std::cerr << "Error: Unknown " << analysis << " option: " << k << std::endl;
+                    return false;
+                }
+            } catch (...) {
+                std::cerr << "Error: Invalid value for " << k << std::endl;
+                return false;
+            }
+            continue;
+        }
+        OutputVariable out_var;
+        if (!parseOutputVariable(token, out_var)) return false;
+        vars.push_back(out_var);
+    }
+    if (vars.empty()) {
+        std::cerr << "Error: No output variables specified for print command." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void CommandParser::printPlotTable(const PlotData& pd, const std::string& axisLabel) {
+    std::cout << std::left << std::setw(15) << axisLabel;
+    for (const auto& name : pd.series_names) std::cout << std::setw(18) << name;
+    std::cout << std::endl;
+    for (size_t i = 0; i < pd.time_axis.size(); ++i) {
+        std::cout << std::left << std::scientific << std::setprecision(6) << std::setw(15) << pd.time_axis[i];
+        for (const auto& series : pd.data_series)
+            std::cout << std::setw(18) << series[i];
+        std::cout << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+void CommandParser::handleACSource(std::istringstream& iss) {
+    // ac <Source> <magnitude> [<phase_deg>]
+    std::string name, mag_str, phase_str;
+    if (!(iss >> name >> mag_str)) {
+        std::cerr << "Error: Syntax error. Usage: ac <Source> <magnitude> [<phase_deg>]" << std::endl;
+        return;
+    }
+    Element* elem = graph->findElement(name);
+    if (!elem) {
+        std::cout << "Error: Component " << name << " not found in circuit" << std::endl;
+        return;
+    }
+    if (elem->type != VOLTAGE_SOURCE && elem->type != CURRENT_SOURCE &&
+        elem->type != SINUSOIDAL_SOURCE && elem->type != PULSE_SOURCE && elem->type != FILE_SOURCE) {
+        std::cerr << "Error: " << name << " is not an independent source." << std::endl;
+        return;
+    }
+    double mag = parseValueWithPrefix(mag_str);
+    double phase = 0.0;
+    if (iss >> phase_str) phase = parseValueWithPrefix(phase_str);
+    if (mag == -1e99 || phase == -1e99) {
+        std::cerr << "Error: Invalid AC magnitude or phase" << std::endl;
+        return;
+    }
+    elem->acMagnitude = mag;
+    elem->acPhase = phase;
+    std::cout << "AC excitation for " << name << ": " << mag << " /_ " << phase << " deg" << std::endl;
+}
+
+void CommandParser::handleReduce(std::istringstream& iss) {
+    // reduce <Name> <port1> [<port2>...] [order=<q>] [fmax=<Hz>] [tol=<rel>]
+    const char* usage = "Usage: reduce <Name> <port1> [<port2>...] [order=<q>] [fmax=<Hz>] [tol=<rel>]";
+    std::string name;
+    if (!(iss >> name)) {
+        std::cerr << "Error: Syntax error. " << usage << std::endl;
+        return;
+    }
+    ReductionOptions opt;
+    opt.gmin = simRunner->getGmin();
+    std::vector<std::string> ports;
+    std::string tok;
+    while (iss >> tok) {
+        auto eq = tok.find('=');
+        if (eq == std::string::npos) {
+            ports.push_back(tok);
+            continue;
+        }
+        std::string k = tok.substr(0, eq);
+        double v = parseValueWithPrefix(tok.substr(eq + 1));
+        const bool valueOk = k == "order" ? parseCount(tok.substr(eq + 1), opt.maxOrder) : v != -1e99 && v > 0;
+        if (!valueOk) {
+            std::cerr << "Error: Invalid value for " << k << std::endl;
+            return;
+        }
+        if      (k == "order") continue;
+        else if (k == "fmax")  opt.fmax = v;
+        else if (k == "tol")   opt.tol = v;
+        else { std::cerr << "Error: Unknown reduce option: " << k << std::endl; return; }
+    }
+    if (ports.empty()) {
+        std::cerr << "Error: Syntax error. " << usage << std::endl;
+        return;
+    }
+
+    if (ReducedModel* model = reduceNetwork(*graph, *nodeManager, name, ports, opt)) {
+        model->display();
+    }
+}
+
+void CommandParser::handleTolerance(std::istringstream& iss) {
+    // tolerance <Element|Prefix*> <rel>[%] [uniform|gauss]
+    // tolerance clear
+    std::string pattern, rel_str, dist;
+    if (!(iss >> pattern)) {
+        std::cerr << "Error: Syntax error. Usage: tolerance <Element|Prefix*> <value>[%] [uniform|gauss]" << std::endl;
+        return;
+    }
+    if (pattern == "clear") {
+        simRunner->clearTolerances();
+        std::cout << "Tolerances cleared." << std::endl;
+        return;
+    }
+    if (!(iss >> rel_str)) {
+        std::cerr << "Error: Syntax error. Usage: tolerance <Element|Prefix*> <value>[%] [uniform|gauss]" << std::endl;
+        return;
+    }
+
+    ToleranceSpec spec;
+    spec.pattern = pattern;
+    bool percent = !rel_str.empty() && rel_str.back() == '%';
+    if (percent) rel_str.pop_back();
+    spec.relative = parseValueWithPrefix(rel_str);
+    if (percent) spec.relative /= 100.0;
+    if (spec.relative < 0) {
+        std::cerr << "Error: Invalid tolerance value" << std::endl;
+        return;
+    }
+    if (iss >> dist) {
+        if (dist == "gauss" || dist == "gaussian") spec.dist = ToleranceDistribution::Gaussian;
+        else if (dist != "uniform") {
+            std::cerr << "Error: Unknown distribution '" << dist << "'. Use uniform or gauss." << std::endl;
+            return;
+        }
+    }
+    simRunner->setTolerance(spec);
+    std::cout << "Tolerance for " << pattern << ": " << spec.relative * 100.0 << "% "
+              << (spec.dist == ToleranceDistribution::Gaussian ? "gauss" : "uniform") << std::endl;
+}
+
+void CommandParser::handleDiodeModel(std::istringstream& iss) {
+    // diode fast [tol=<rel>[%]] [<Diode|Prefix*>...]   tabulated I(V), see DiodeTable.h
+    // diode exact [<Diode|Prefix*>...]
+    const char* usage = "Usage: diode fast|exact [tol=<rel>] [<Diode|Prefix*>...]";
+    std::string mode;
+    if (!(iss >> mode) || (mode != "fast" && mode != "exact")) {
+        std::cerr << "Error: Syntax error. " << usage << std::endl;
+        return;
+    }
+    double tol = 1e-3;
+    std::vector<ToleranceSpec> patterns;    // only the name matching is used
+    std::string tok;
+    while (iss >> tok) {
+        if (tok.rfind("tol=", 0) == 0 && mode == "fast") {
+            std::string v = tok.substr(4);
+            bool percent = !v.empty() && v.back() == '%';
+            if (percent) v.pop_back();
+            tol = parseValueWithPrefix(v);
+            if (percent) tol /= 100.0;
+            if (tol <= 0 || tol >= 1) {
+                std::cerr << "Error: Diode table tolerance must be between 0 and 1." << std::endl;
+                return;
+            }
+            continue;
+        }
+        ToleranceSpec p;
+        p.pattern = tok;
+        patterns.push_back(p);
+    }
+
+    int count = 0;
+    size_t points = 0;
+    for (Element* e : graph->getElements()) {
+        if (e->type != DIODE) continue;
+        if (!patterns.empty() && std::none_of(patterns.begin(), patterns.end(),
+                                              [&](const ToleranceSpec& p) { return p.matches(e->name); }))
+            continue;
+        auto* d = static_cast<Diode*>(e);
+        if (mode == "fast") {
+            d->table = DiodeTable::get(d->Is, d->n * d->Vt, tol);
+            points = std::max(points, d->table->points());
+        } else {
+            d->table.reset();
+        }
+        ++count;
+    }
+    if (count == 0) {
+        std::cerr << "Error: No matching diodes in the circuit." << std::endl;
+        return;
+    }
+    std::cout << count << " diode(s) set to the " << mode << " model";
+    if (mode == "fast") std::cout << " (tol " << tol << ", " << points << " table points)";
+    std::cout << std::endl;
+}
+
 void CommandParser::handleShowSchematics() {
     while (true) {
         std::vector<std::filesystem::path> schematics;
@@ -714,6 +1323,7 @@ void CommandParser::handleSaveCommand(std::istringstream& iss) {
             case VCVS: type_char = 'E'; break;
             case CCCS: type_char = 'F'; break;
             case CCVS: type_char = 'H'; break;
+            case SUBCIRCUIT: type_char = 'X'; break;
                 // SINUSOIDAL_SOURCE و PULSE_SOURCE به فرمت متفاوتی نیاز دارند و در اینجا ساده‌سازی شده‌اند
                 // برای ذخیره کامل آن‌ها باید منطق جداگانه‌ای پیاده‌سازی شود.
             default: continue; // قطعات ناشناس یا پیچیده را ذخیره نکن
@@ -728,6 +1338,8 @@ void CommandParser::handleSaveCommand(std::istringstream& iss) {
         if (elem->type == DIODE) {
             // برای دیود، مدل آن ذخیره می‌شود
             outfile << dynamic_cast<Diode*>(elem)->model << std::endl;
+        } else if (elem->type == SUBCIRCUIT) {
+            outfile << static_cast<Subcircuit*>(elem)->def->name << std::endl;
         } else {
             // برای سایر قطعات ساده، مقدارشان ذخیره می‌شود
             outfile << elem->value << std::endl;
@@ -749,13 +1361,11 @@ void CommandParser::handleLabel(std::istringstream& in) {
     if (!(in >> a)) { std::cout << "usage: label <node|label> <name>\n"; return; }
     if (!(in >> b)) { // single token => create fresh node with that label
         nodeManager->labelNode(a);
-        graph->canonicalizeNodes(*nodeManager);
         std::cout << "labeled new node as " << a << "\n";
         return;
     }
     int id = nodeManager->resolveId(a);
     nodeManager->setLabel(id, b);
-    graph->canonicalizeNodes(*nodeManager);
     std::cout << "labeled node " << id << " as " << b << "\n";
 }
 
@@ -764,77 +1374,25 @@ void CommandParser::handleConnect(std::istringstream& in) {
     std::string a,b;
     if (!(in >> a >> b)) { std::cout << "usage: connect <a> <b>\n"; return; }
     int rep = nodeManager->connect(a,b);
-    graph->canonicalizeNodes(*nodeManager);
     std::cout << "connected; rep = " << rep << "\n";
 }
-void CommandParser::handleAddComponent(const std::string& instance_name, const std::string& external_n1_str, const std::string& external_n2_str) {
-    std::string sub_path = "library/" + instance_name + ".sub";
-    std::ifstream sub_file(sub_path);
-
-    if (!sub_file.is_open()) {
-        std::cerr << "Error: Cannot open subcircuit file: " << sub_path << std::endl;
+void CommandParser::handleAddComponent(const std::string& instance_name, const std::string& external_n1_str,
+                                       const std::string& external_n2_str, const std::string& sub_name) {
+    if (graph->findElement(instance_name)) {
+        std::cerr << "Error: " << instance_name << " already exists in the circuit\n";
         return;
     }
-
-    // 1. Read the port definition line
-    std::string line, keyword, internal_port1_name, internal_port2_name;
-    std::getline(sub_file, line);
-    std::istringstream port_iss(line);
-    if (!(port_iss >> keyword >> internal_port1_name >> internal_port2_name) || keyword != "ports") {
-        std::cerr << "Error: Invalid subcircuit file. First line must be 'ports <name1> <name2>'." << std::endl;
+    // The definition is parsed once and shared; the instance only records its port nodes
+    std::string error;
+    std::shared_ptr<const SubcircuitDef> def = subcircuits.get(sub_name, error);
+    if (!def) {
+        std::cerr << "Error: " << error << std::endl;
         return;
     }
 
-    // 2. Resolve the EXTERNAL nodes in the main circuit
     int external_n1_id = nodeManager->resolveId(external_n1_str);
     int external_n2_id = nodeManager->resolveId(external_n2_str);
-
-    // 3. Create a map to translate internal subcircuit node names to final IDs in the main graph
-    std::map<std::string, int> nodeMap;
-    nodeMap[internal_port1_name] = external_n1_id;
-    nodeMap[internal_port2_name] = external_n2_id;
-
-    // 4. Read the rest of the file to add internal elements
-    while (std::getline(sub_file, line)) {
-        if (line.empty() || line[0] == '#') continue;
-
-        std::istringstream elem_iss(line);
-        std::string add_cmd, elem_name_internal, n1_internal_str, n2_internal_str, val_str_or_model;
-
-        if (!(elem_iss >> add_cmd >> elem_name_internal >> n1_internal_str >> n2_internal_str >> val_str_or_model)) continue;
-
-        // For each node of the internal element, find its final ID in the main graph.
-        // If it's a new internal node, create a fresh, unique ID for it.
-        for (const auto& node_str : {n1_internal_str, n2_internal_str}) {
-            if (nodeMap.find(node_str) == nodeMap.end()) {
-                std::string unique_label = instance_name + "." + node_str;
-                int new_id = nodeManager->labelNode(unique_label);
-                nodeMap[node_str] = new_id;
-            }
-        }
-
-        // Create the element with the mapped node IDs and a unique name
-        int final_n1_id = nodeMap.at(n1_internal_str);
-        int final_n2_id = nodeMap.at(n2_internal_str);
-        std::string final_elem_name = instance_name + "." + elem_name_internal;
-        double value = parseValueWithPrefix(val_str_or_model); // Assumes val_str_or_model is a value
-
-        Element* new_elem = nullptr;
-        char type = toupper(elem_name_internal[0]);
-        switch (type) {
-            case 'R': new_elem = new Resistor(final_elem_name, final_n1_id, final_n2_id, value); break;
-            case 'C': new_elem = new Capacitor(final_elem_name, final_n1_id, final_n2_id, value); break;
-            case 'L': new_elem = new Inductor(final_elem_name, final_n1_id, final_n2_id, value); break;
-            case 'V': new_elem = new VoltageSource(final_elem_name, final_n1_id, final_n2_id, value); break;
-            case 'I': new_elem = new CurrentSource(final_elem_name, final_n1_id, final_n2_id, value); break;
-            case 'D': new_elem = new Diode(final_elem_name, final_n1_id, final_n2_id, val_str_or_model); break;
-                // Add cases for other element types (VCCS, VCVS, etc.) as needed
-            default:
-                std::cerr << "Warning: Skipping unknown element type '" << type << "' inside subcircuit." << std::endl;
-                continue;
-        }
-        graph->addElement(new_elem);
-    }
+    graph->addElement(graph->make<Subcircuit>(instance_name, external_n1_id, external_n2_id, std::move(def)));
     std::cout << "Successfully added subcircuit instance '" << instance_name << "' to the graph." << std::endl;
 }
 
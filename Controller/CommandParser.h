@@ -8,6 +8,7 @@
 #include "Model/Graph.h"
 #include "Model/NodeManager.h"
 #include "Controller/SimulationRunner.h"
+#include "Controller/SubcircuitLibrary.h"
 #include <functional>
 
 class Graph;
@@ -19,11 +20,34 @@ private:
     Graph* graph;
     NodeManager* nodeManager;
     SimulationRunner* simRunner;
+    PlotData lastWaveform;      // last print TRAN / PSS result, input of print FOUR / FFT
+    SubcircuitLibrary subcircuits;  // parsed .sub files shared by their instances
 
     void handlePrintCommand(std::istringstream& iss);
+    void handleMonteCarlo(std::istringstream& iss);
+    void handleAC(std::istringstream& iss);
+    void handleACSource(std::istringstream& iss);
+    void handlePhaseSweep(std::istringstream& iss);
+    void handlePSS(std::istringstream& iss);
+    void handleHB(std::istringstream& iss);
+    void handleFourier(std::istringstream& iss, bool spectrum);
+    void handleSensitivity(std::istringstream& iss, bool transferFunction);
+    static void printPlotTable(const PlotData& pd, const std::string& axisLabel);
+    // One V(<node>) / I(<element>) token; false, with the error printed, if it is not one
+    // or names no element
+    bool parseOutputVariable(const std::string& token, OutputVariable& out) const;
+    // The rest of a print line: output variables mixed with key=value options, which go to
+    // `option` (false for an unknown key; a throw is an invalid value). False, with the error
+    // printed, on any bad token or when no variable is named.
+    bool parseOutputList(std::istringstream& iss, const char* analysis, std::vector<OutputVariable>& vars,
+                         const std::function<bool(const std::string& key, const std::string& value)>& option = {}) const;
+    void handleTolerance(std::istringstream& iss);
+    void handleDiodeModel(std::istringstream& iss);
+    void handleReduce(std::istringstream& iss);
     void handleShowSchematics();
     void handleSaveCommand(std::istringstream& iss);
-    void handleAddComponent(const std::string& sub_name, const std::string& external_n1_str, const std::string& external_n2_str);
+    void handleAddComponent(const std::string& instance_name, const std::string& external_n1_str,
+                            const std::string& external_n2_str, const std::string& sub_name);
 
     void cmd_scope_load(const std::vector<std::string>& tokens);
     void cmd_scope_clear();
@@ -42,6 +66,8 @@ public:
     // Optional callbacks for scope->App bridge (set these in App if you want)
     std::function<void(const std::string& path, double Fs, double tStop, int chunk)> onScopeLoad;
     std::function<void()> onScopeClear;
+    // Receives the result of print TRAN / AC so the App can plot it
+    std::function<void(const PlotData& pd)> onPlot;
 
 // New wrapper that adds 'scope' commands then falls back to your legacy parser
     void parseCommand(const std::string& line);
@@ -0,0 +1,222 @@
+#include "Controller/Fourier.h"
+#include "Model/FFT.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numbers>
+
+namespace {
+    using cd = std::complex<double>;
+
+    // DFTs (bins 0..N/2) of two real series from one complex transform:
+    // z = a + j b  =>  A[k] = (Z[k] + conj Z[N-k]) / 2,  B[k] = (Z[k] - conj Z[N-k]) / 2j
+    void realPair(const FFTPlan& plan, const std::vector<double>& a, const std::vector<double>* b,
+                  std::vector<cd>& A, std::vector<cd>& B) {
+        const size_t N = plan.size();
+        std::vector<double> re(a), im = b ? *b : std::vector<double>(N, 0.0);
+        plan.transform(re.data(), im.data());
+        A.resize(N / 2 + 1);
+        B.resize(N / 2 + 1);
+        for (size_t k = 0; k <= N / 2; ++k) {
+            cd z(re[k], im[k]);
+            cd zc = std::conj(cd(re[(N - k) % N], im[(N - k) % N]));
+            A[k] = 0.5 * (z + zc);
+            B[k] = cd(0.0, -0.5) * (z - zc);
+        }
+    }
+
+    size_t samplesIn(const std::vector<double>& t, double t0, double t1) {
+        auto lo = std::lower_bound(t.begin(), t.end(), t0);
+        auto hi = std::upper_bound(t.begin(), t.end(), t1);
+        return hi > lo ? static_cast<size_t>(hi - lo) : 0;
+    }
+}
+
+std::vector<double> FourierAnalysis::resample(const std::vector<double>& t, const std::vector<double>& y,
+                                              double t0, double t1, size_t N, bool periodic) {
+    std::vector<double> out(N, 0.0);
+    if (t.empty() || N == 0) return out;
+    const double dt = (t1 - t0) / static_cast<double>(periodic || N < 2 ? N : N - 1);
+    size_t j = 0;
+    for (size_t i = 0; i < N; ++i) {
+        double tau = t0 + dt * static_cast<double>(i);
+        while (j + 1 < t.size() && t[j + 1] < tau) ++j;
+        if (tau <= t[j] || j + 1 >= t.size()) { out[i] = y[j]; continue; }
+        double span = t[j + 1] - t[j];
+        double a = span > 0.0 ? (tau - t[j]) / span : 0.0;
+        out[i] = y[j] + a * (y[j + 1] - y[j]);
+    }
+    return out;
+}
+
+double FourierAnalysis::applyWindow(std::vector<double>& x, FFTWindow w) {
+    const size_t N = x.size();
+    if (N == 0 || w == FFTWindow::Rectangular) return 1.0;
+    // Cosine-sum windows in their periodic form, sum a_m (-1)^m cos(2 pi m i / N)
+    std::vector<double> a;
+    switch (w) {
+        case FFTWindow::Hann:     a = {0.5, 0.5}; break;
+        case FFTWindow::Hamming:  a = {0.54, 0.46}; break;
+        case FFTWindow::Blackman: a = {0.42, 0.5, 0.08}; break;
+        case FFTWindow::FlatTop:  a = {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368}; break;
+        default: break;
+    }
+    double sum = 0.0;
+    for (size_t i = 0; i < N; ++i) {
+        double ph = 2.0 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(N);
+        double wi = 0.0;
+        for (size_t m = 0; m < a.size(); ++m)
+            wi += ((m % 2) ? -a[m] : a[m]) * std::cos(static_cast<double>(m) * ph);
+        x[i] *= wi;
+        sum += wi;
+    }
+    return sum / static_cast<double>(N);
+}
+
+bool FourierAnalysis::parseWindow(const std::string& name, FFTWindow& w) {
+    if      (name == "rect" || name == "none") w = FFTWindow::Rectangular;
+    else if (name == "hann" || name == "hanning") w = FFTWindow::Hann;
+    else if (name == "hamming") w = FFTWindow::Hamming;
+    else if (name == "blackman") w = FFTWindow::Blackman;
+    else if (name == "flattop") w = FFTWindow::FlatTop;
+    else return false;
+    return true;
+}
+
+bool FourierAnalysis::fourier(const PlotData& wave, const FourierConfig& cfg, FourierResult& result) {
+    const auto& t = wave.time_axis;
+    if (wave.axis != PlotAxis::Time || t.size() < 2) {
+        std::cerr << "Error: Fourier analysis needs a time-domain waveform (run print TRAN or PSS first)." << std::endl;
+        return false;
+    }
+    if (cfg.f0 <= 0.0 || cfg.harmonics < 1 || cfg.periods < 1) {
+        std::cerr << "Error: Invalid Fourier parameters (need f0 > 0, harmonics >= 1, periods >= 1)." << std::endl;
+        return false;
+    }
+    const double T = cfg.periods / cfg.f0;
+    const double t1 = t.back(), t0 = t1 - T;
+    if (t0 < t.front() - 1e-9 * T) {
+        std::cerr << "Error: Waveform covers " << (t1 - t.front()) << " s, shorter than " << cfg.periods
+                  << " period(s) of " << cfg.f0 << " Hz." << std::endl;
+        return false;
+    }
+
+    // Harmonic k lands exactly on bin k * periods
+    const size_t top = static_cast<size_t>(cfg.harmonics) * static_cast<size_t>(cfg.periods);
+    size_t N = cfg.points;
+    if (N == 0) N = nextPowerOfTwo(std::max({samplesIn(t, t0, t1), 4 * top, size_t(64)}));
+    if (N <= 2 * top) {
+        std::cerr << "Error: " << N << " points cannot resolve harmonic " << cfg.harmonics
+                  << " (need more than " << 2 * top << ")." << std::endl;
+        return false;
+    }
+
+    result = FourierResult{};
+    result.f0 = cfg.f0;
+    result.t_start = t0;
+    result.t_stop = t1;
+    result.points = N;
+    result.names = wave.series_names;
+
+    FFTPlan plan(N);
+    const double scale = 1.0 / static_cast<double>(N);
+    for (size_t v = 0; v < wave.data_series.size(); v += 2) {
+        std::vector<double> a = resample(t, wave.data_series[v], t0, t1, N, true);
+        std::vector<double> b;
+        bool pair = v + 1 < wave.data_series.size();
+        if (pair) b = resample(t, wave.data_series[v + 1], t0, t1, N, true);
+        std::vector<cd> A, B;
+        realPair(plan, a, pair ? &b : nullptr, A, B);
+
+        for (int s = 0; s < (pair ? 2 : 1); ++s) {
+            const auto& X = s ? B : A;
+            std::vector<cd> p(cfg.harmonics + 1);
+            p[0] = X[0] * scale;
+            for (int k = 1; k <= cfg.harmonics; ++k) {
+                // Refer the phase to t = 0 rather than the start of the span
+                cd shift = std::polar(1.0, -2.0 * std::numbers::pi * k * cfg.f0 * t0);
+                p[k] = 2.0 * scale * X[static_cast<size_t>(k) * cfg.periods] * shift;
+            }
+            result.phasors.push_back(std::move(p));
+        }
+    }
+    return true;
+}
+
+PlotData FourierAnalysis::spectrum(const PlotData& wave, const FourierConfig& cfg) {
+    PlotData pd;
+    pd.axis = PlotAxis::Frequency;
+    const auto& t = wave.time_axis;
+    if (wave.axis != PlotAxis::Time || t.size() < 2) {
+        std::cerr << "Error: Spectrum needs a time-domain waveform (run print TRAN or PSS first)." << std::endl;
+        return pd;
+    }
+    const double t1 = t.back(), t0 = cfg.t_start < 0.0 ? t.front() : cfg.t_start;
+    if (t0 < t.front() || t0 >= t1) {
+        std::cerr << "Error: Spectrum start " << t0 << " s is outside the waveform [" << t.front()
+                  << ", " << t1 << "] s." << std::endl;
+        return pd;
+    }
+    size_t N = cfg.points ? cfg.points : nextPowerOfTwo(std::max(samplesIn(t, t0, t1), size_t(16)));
+    if (N < 4) {
+        std::cerr << "Error: Spectrum needs at least 4 points." << std::endl;
+        return pd;
+    }
+
+    // Bin k is k / (t1 - t0) Hz; DC is left out so the log frequency axis stays finite
+    const size_t bins = N / 2;
+    const double df = 1.0 / (t1 - t0);
+    pd.time_axis.resize(bins);
+    for (size_t k = 1; k <= bins; ++k) pd.time_axis[k - 1] = df * static_cast<double>(k);
+
+    FFTPlan plan(N);
+    for (size_t v = 0; v < wave.data_series.size(); v += 2) {
+        bool pair = v + 1 < wave.data_series.size();
+        std::vector<double> a = resample(t, wave.data_series[v], t0, t1, N, true), b;
+        double gain = applyWindow(a, cfg.window);
+        if (pair) {
+            b = resample(t, wave.data_series[v + 1], t0, t1, N, true);
+            applyWindow(b, cfg.window);
+        }
+        std::vector<cd> A, B;
+        realPair(plan, a, pair ? &b : nullptr, A, B);
+
+        for (int s = 0; s < (pair ? 2 : 1); ++s) {
+            const auto& X = s ? B : A;
+            std::vector<double> mag(bins);
+            for (size_t k = 1; k <= bins; ++k) {
+                double m = std::abs(X[k]) * (k == N / 2 ? 1.0 : 2.0) / (static_cast<double>(N) * gain);
+                mag[k - 1] = cfg.out_in_dB ? 20.0 * std::log10(std::max(m, 1e-300)) : m;
+            }
+            pd.data_series.push_back(std::move(mag));
+            pd.series_names.push_back((cfg.out_in_dB ? "dB(" : "mag(") + wave.series_names[v + s] + ")");
+        }
+    }
+    return pd;
+}
+
+void FourierResult::print() const {
+    std::cout << "Fourier analysis: f0 = " << f0 << " Hz over [" << t_start << ", " << t_stop << "] s, "
+              << points << " points" << std::endl;
+    for (size_t v = 0; v < names.size(); ++v) {
+        const auto& p = phasors[v];
+        const double fund = p.size() > 1 ? std::abs(p[1]) : 0.0;
+        std::cout << names[v] << std::endl;
+        std::cout << std::left << std::setw(6) << "k" << std::setw(16) << "Freq(Hz)"
+                  << std::setw(16) << "Amplitude" << std::setw(16) << "Normalized"
+                  << std::setw(16) << "Phase(deg)" << std::endl;
+        double harmonics = 0.0;
+        for (size_t k = 0; k < p.size(); ++k) {
+            double amp = (k == 0) ? p[0].real() : std::abs(p[k]);
+            double ph = (k == 0) ? 0.0 : std::arg(p[k]) * 180.0 / std::numbers::pi;
+            if (k >= 2) harmonics += amp * amp;
+            std::cout << std::left << std::setw(6) << k << std::scientific << std::setprecision(6)
+                      << std::setw(16) << k * f0 << std::setw(16) << amp
+                      << std::setw(16) << (fund > 0.0 ? amp / fund : 0.0) << std::setw(16) << ph
+                      << std::defaultfloat << std::endl;
+        }
+        if (fund > 0.0) std::cout << "THD = " << 100.0 * std::sqrt(harmonics) / fund << " %" << std::endl;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef MORGHSPICY_FOURIER_H
+#define MORGHSPICY_FOURIER_H
+
+#pragma once
+#include <complex>
+#include <string>
+#include <vector>
+#include "Controller/SimConfig.h"
+#include "Controller/SimulationRunner.h"
+
+struct FourierResult {
+    double f0 = 0.0;
+    double t_start = 0.0, t_stop = 0.0;
+    std::size_t points = 0;
+    std::vector<std::string> names;                              // "V(out)"
+    std::vector<std::vector<std::complex<double>>> phasors;      // [var][k]: DC, then peak amplitude
+                                                                 // with phase against cos(k w0 t)
+    void print() const;
+};
+
+// Post-processing of sampled waveforms (print TRAN / PSS results, scope files).
+// Samples are linearly interpolated onto a uniform grid and transformed with FFTPlan;
+// two real series share one complex transform.
+class FourierAnalysis {
+public:
+    // .four: harmonics 0..cfg.harmonics of cfg.f0 over the last cfg.periods periods
+    static bool fourier(const PlotData& wave, const FourierConfig& cfg, FourierResult& result);
+
+    // Single-sided amplitude spectrum (peak units, corrected for the window's coherent gain)
+    // from 0 to Nyquist. The returned PlotData has axis Frequency.
+    static PlotData spectrum(const PlotData& wave, const FourierConfig& cfg);
+
+    // Uniform samples t0 + i (t1 - t0) / N, i < N (periodic = true) or i <= N - 1 spanning [t0, t1]
+    static std::vector<double> resample(const std::vector<double>& t, const std::vector<double>& y,
+                                        double t0, double t1, std::size_t N, bool periodic);
+
+    // Multiplies in place; returns the window's coherent gain (mean of the weights)
+    static double applyWindow(std::vector<double>& x, FFTWindow w);
+
+    static bool parseWindow(const std::string& name, FFTWindow& w);
+};
+
+#endif //MORGHSPICY_FOURIER_H
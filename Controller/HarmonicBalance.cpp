@@ -0,0 +1,338 @@
+#include "HarmonicBalance.h"
+#include "Controller/ACAnalysis.h"
+#include "Model/Graph.h"
+#include "Model/MNASolver.h"
+#include "Model/NodeManager.h"
+#include "Model/Elements.h"
+#include "Model/Subcircuit.h"
+#include "Model/FFT.h"
+#include "Model/Krylov.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numbers>
+
+HarmonicBalance::HarmonicBalance(Graph& g, MNASolver& s, NodeManager& n) : graph(g), solver(s), nm(n) {}
+
+void HarmonicBalance::synthesize(const Eigen::VectorXcd& X, int row, std::vector<double>& out) const {
+    out.assign(M, 0.0);
+    if (row == -1) return;
+    std::vector<cd> a(M, 0.0);
+    a[0] = X(row);
+    for (int k = 1; k <= K; ++k) {
+        a[k] = X(k * n + row);
+        a[M - k] = std::conj(a[k]);
+    }
+    fft(a, true);
+    for (int i = 0; i < M; ++i) out[i] = a[i].real();
+}
+
+std::vector<HarmonicBalance::cd> HarmonicBalance::analyze(const std::vector<double>& samples) const {
+    std::vector<cd> a(samples.begin(), samples.end());
+    fft(a);
+    std::vector<cd> s(K + 1);
+    for (int k = 0; k <= K; ++k) s[k] = a[k] / static_cast<double>(M);
+    return s;
+}
+
+bool HarmonicBalance::sourceSpectrum() {
+    U = Eigen::MatrixXcd::Zero(n, K + 1);
+    const auto& idx = solver.getNodeToMatrixIdxMap();
+    const int extra = solver.getExtraVariableStartIndex();
+    auto row = [&](int node) { return (node == 0 || !idx.count(node)) ? -1 : idx.at(node); };
+    const double T = 2.0 * std::numbers::pi / w0;
+
+    std::vector<double> samples(M);
+    for (Element* e : graph.getElements()) {
+        switch (e->type) {
+            case VOLTAGE_SOURCE:
+                U(extra + e->extraVariableIndex, 0) += e->value;
+                break;
+            case CURRENT_SOURCE:
+                if (int r = row(e->node1); r != -1) U(r, 0) -= e->value;
+                if (int r = row(e->node2); r != -1) U(r, 0) += e->value;
+                break;
+            case SINUSOIDAL_SOURCE:
+            case PULSE_SOURCE: {
+                if (auto* s = dynamic_cast<SinusoidalSource*>(e)) {
+                    double m = s->getFrequency() * T;
+                    if (std::abs(m - std::round(m)) > 1e-6) {
+                        std::cerr << "Error: " << e->name << " (" << s->getFrequency()
+                                  << " Hz) is not a harmonic of f0." << std::endl;
+                        return false;
+                    }
+                    if (std::round(m) > K) {
+                        std::cerr << "Warning: " << e->name << " is harmonic " << std::round(m)
+                                  << ", above the " << K << " kept." << std::endl;
+                    }
+                }
+                for (int i = 0; i < M; ++i) {
+                    double t = T * i / M;
+                    if (auto* s = dynamic_cast<SinusoidalSource*>(e)) {
+                        s->updateTime(t);
+                        samples[i] = s->getInstantaneousValue();
+                    } else {
+                        auto* p = static_cast<PulseSource*>(e);
+                        p->updateTime(t);
+                        samples[i] = p->getInstantaneousValue();
+                    }
+                }
+                std::vector<cd> s = analyze(samples);
+                for (int k = 0; k <= K; ++k) U(extra + e->extraVariableIndex, k) += s[k];
+                break;
+            }
+            case FILE_SOURCE:
+                std::cerr << "Error: " << e->name << " plays a file, which is not periodic; "
+                          << "harmonic balance needs periodic sources." << std::endl;
+                return false;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+bool HarmonicBalance::setup(const HBConfig& cfg) {
+    graph.canonicalizeNodes(nm);
+    solver.initializeMatrix(graph);
+    if (!solver.hasUnknowns()) {
+        std::cerr << "Error: Harmonic balance cannot run, the circuit is not correctly defined." << std::endl;
+        return false;
+    }
+    n = solver.getTotalUnknowns();
+    K = cfg.K;
+    M = static_cast<int>(nextPowerOfTwo(std::max(8, 4 * K)));  // 2x oversampled against aliasing
+    w0 = 2.0 * std::numbers::pi * cfg.f0;
+
+    // Linear part: the small-signal stamps of every element but the diodes
+    const auto& idx = solver.getNodeToMatrixIdxMap();
+    auto row = [&](int node) { return (node == 0 || !idx.count(node)) ? -1 : idx.at(node); };
+    SmallSignalSystem sys(n);
+    Eigen::VectorXd zero = Eigen::VectorXd::Zero(n);
+    diodes.clear();
+    for (const Element* e : graph.getElements()) {
+        if (e->type == DIODE) {
+            diodes.push_back({static_cast<const Diode*>(e), row(e->node1), row(e->node2)});
+            continue;
+        }
+        if (e->type == SUBCIRCUIT) {
+            // Only the linear small-signal stamps of an instance are available here
+            const SubcircuitDef& def = *static_cast<const Subcircuit*>(e)->def;
+            if (def.hasDiodes || def.hasSources) {
+                std::cerr << "Error: Harmonic balance does not support diodes or sources inside subcircuit "
+                          << e->name << " (" << def.name << ")." << std::endl;
+                return false;
+            }
+        }
+        e->stampAC(sys, idx, solver.getExtraVariableStartIndex(), zero);
+    }
+    for (int i = 0; i < solver.getNumNonGroundNodes(); ++i) sys.addG(i, i, solver.getGmin());
+    G = sys.sparseG();
+    C = sys.sparseC();
+    gd.assign(diodes.size(), std::vector<double>(M, 0.0));
+
+    return sourceSpectrum();
+}
+
+Eigen::VectorXcd HarmonicBalance::residual(const Eigen::VectorXcd& X) {
+    Eigen::VectorXcd F(n * (K + 1));
+    for (int k = 0; k <= K; ++k) {
+        Eigen::VectorXcd xk = X.segment(k * n, n);
+        F.segment(k * n, n) = G.cast<cd>() * xk + cd(0.0, k * w0) * (C.cast<cd>() * xk) - U.col(k);
+    }
+
+    std::vector<double> v1, v2, id(M);
+    for (size_t d = 0; d < diodes.size(); ++d) {
+        synthesize(X, diodes[d].r1, v1);
+        synthesize(X, diodes[d].r2, v2);
+        for (int i = 0; i < M; ++i) id[i] = diodes[d].d->current(v1[i] - v2[i], gd[d][i]);
+        std::vector<cd> s = analyze(id);
+        for (int k = 0; k <= K; ++k) {
+            if (diodes[d].r1 != -1) F(k * n + diodes[d].r1) += s[k];
+            if (diodes[d].r2 != -1) F(k * n + diodes[d].r2) -= s[k];
+        }
+    }
+    return F;
+}
+
+Eigen::VectorXcd HarmonicBalance::jacobian(const Eigen::VectorXcd& dX) const {
+    Eigen::VectorXcd J(n * (K + 1));
+    for (int k = 0; k <= K; ++k) {
+        Eigen::VectorXcd xk = dX.segment(k * n, n);
+        J.segment(k * n, n) = G.cast<cd>() * xk + cd(0.0, k * w0) * (C.cast<cd>() * xk);
+    }
+
+    // Diodes: conductance waveform times the voltage perturbation, back to harmonics
+    std::vector<double> v1, v2, di(M);
+    for (size_t d = 0; d < diodes.size(); ++d) {
+        synthesize(dX, diodes[d].r1, v1);
+        synthesize(dX, diodes[d].r2, v2);
+        for (int i = 0; i < M; ++i) di[i] = gd[d][i] * (v1[i] - v2[i]);
+        std::vector<cd> s = analyze(di);
+        for (int k = 0; k <= K; ++k) {
+            if (diodes[d].r1 != -1) J(k * n + diodes[d].r1) += s[k];
+            if (diodes[d].r2 != -1) J(k * n + diodes[d].r2) -= s[k];
+        }
+    }
+    return J;
+}
+
+bool HarmonicBalance::factorPreconditioner() {
+    std::vector<Eigen::Triplet<double>> avg;
+    for (size_t d = 0; d < diodes.size(); ++d) {
+        double g = 0.0;
+        for (double v : gd[d]) g += v;
+        g /= M;
+        int a = diodes[d].r1, b = diodes[d].r2;
+        if (a != -1) avg.emplace_back(a, a, g);
+        if (b != -1) avg.emplace_back(b, b, g);
+        if (a != -1 && b != -1) { avg.emplace_back(a, b, -g); avg.emplace_back(b, a, -g); }
+    }
+    Eigen::SparseMatrix<double> Gd(n, n);
+    Gd.setFromTriplets(avg.begin(), avg.end());
+    Eigen::SparseMatrix<double> G0 = G + Gd;
+
+    blocks.resize(K + 1);
+    for (int k = 0; k <= K; ++k) {
+        Eigen::SparseMatrix<cd> P = G0.cast<cd>() + cd(0.0, k * w0) * C.cast<cd>();
+        P.makeCompressed();
+        if (!blocks[k]) blocks[k] = std::make_unique<Eigen::SparseLU<Eigen::SparseMatrix<cd>>>();
+        blocks[k]->compute(P);
+        if (blocks[k]->info() != Eigen::Success) return false;
+    }
+    return true;
+}
+
+Eigen::VectorXcd HarmonicBalance::precondition(const Eigen::VectorXcd& r) const {
+    Eigen::VectorXcd z(r.size());
+    for (int k = 0; k <= K; ++k) z.segment(k * n, n) = blocks[k]->solve(Eigen::VectorXcd(r.segment(k * n, n)));
+    return z;
+}
+
+Eigen::VectorXd HarmonicBalance::pack(const Eigen::VectorXcd& X) const {
+    Eigen::VectorXd z(n * (2 * K + 1));
+    z.head(n) = X.head(n).real();
+    for (int k = 1; k <= K; ++k) {
+        z.segment((2 * k - 1) * n, n) = X.segment(k * n, n).real();
+        z.segment(2 * k * n, n) = X.segment(k * n, n).imag();
+    }
+    return z;
+}
+
+Eigen::VectorXcd HarmonicBalance::unpack(const Eigen::VectorXd& z) const {
+    Eigen::VectorXcd X(n * (K + 1));
+    X.head(n) = z.head(n).cast<cd>();
+    for (int k = 1; k <= K; ++k) {
+        X.segment(k * n, n).real() = z.segment((2 * k - 1) * n, n);
+        X.segment(k * n, n).imag() = z.segment(2 * k * n, n);
+    }
+    return X;
+}
+
+bool HarmonicBalance::run(const HBConfig& cfg, const std::vector<OutputVariable>& vars, HBResult& result) {
+    if (cfg.f0 <= 0.0 || cfg.K < 1) {
+        std::cerr << "Error: Harmonic balance needs f0 > 0 and at least one harmonic." << std::endl;
+        return false;
+    }
+    if (!setup(cfg)) return false;
+
+    result = HBResult{};
+    result.f0 = cfg.f0;
+
+    Eigen::VectorXcd X = Eigen::VectorXcd::Zero(n * (K + 1));
+    Eigen::VectorXcd F = residual(X);
+    bool converged = false;
+    for (; result.newtonSteps < cfg.max_newton; ++result.newtonSteps) {
+        if (F.cwiseAbs().maxCoeff() <= cfg.tol) { converged = true; break; }
+        if (!factorPreconditioner()) {
+            std::cerr << "Error: Harmonic balance preconditioner is singular." << std::endl;
+            return false;
+        }
+
+        std::function<Eigen::VectorXd(const Eigen::VectorXd&)> apply = [&](const Eigen::VectorXd& z) {
+            return pack(jacobian(unpack(z)));
+        };
+        std::function<Eigen::VectorXd(const Eigen::VectorXd&)> prec = [&](const Eigen::VectorXd& z) {
+            return pack(precondition(unpack(z)));
+        };
+        Eigen::VectorXd dz = Eigen::VectorXd::Zero(n * (2 * K + 1));
+        int products = gmres<Eigen::VectorXd>(apply, prec, Eigen::VectorXd(-pack(F)), dz, 1e-6, cfg.max_krylov);
+        result.jacobianProducts += products < 0 ? cfg.max_krylov : products;
+        Eigen::VectorXcd dX = unpack(dz);
+
+        // Halve the step while it makes the residual worse (the diode exponential overshoots)
+        const double f0norm = F.norm();
+        double lambda = 1.0;
+        for (int tries = 0; tries < 8; ++tries, lambda *= 0.5) {
+            Eigen::VectorXcd Xn = X + lambda * dX;
+            Eigen::VectorXcd Fn = residual(Xn);
+            if (Fn.norm() < f0norm || tries == 7) {
+                X = Xn;
+                F = Fn;
+                break;
+            }
+        }
+    }
+    if (!converged) {
+        std::cerr << "Error: Harmonic balance did not converge in " << cfg.max_newton << " Newton steps "
+                  << "(residual " << F.cwiseAbs().maxCoeff() << ")." << std::endl;
+        return false;
+    }
+
+    // Outputs, as DC plus peak phasors
+    for (const auto& var : vars) {
+        result.names.push_back((var.type == OutputVariable::VOLTAGE ? "V(" : "I(") + var.name + ")");
+        std::vector<cd> half(K + 1, 0.0);
+        const Element* e = var.type == OutputVariable::CURRENT ? graph.findElement(var.name) : nullptr;
+        if (e && e->type == DIODE) {
+            auto* d = static_cast<const Diode*>(e);
+            const auto& idx = solver.getNodeToMatrixIdxMap();
+            int r1 = (e->node1 == 0 || !idx.count(e->node1)) ? -1 : idx.at(e->node1);
+            int r2 = (e->node2 == 0 || !idx.count(e->node2)) ? -1 : idx.at(e->node2);
+            std::vector<double> v1, v2, id(M);
+            synthesize(X, r1, v1);
+            synthesize(X, r2, v2);
+            double g;
+            for (int i = 0; i < M; ++i) id[i] = d->current(v1[i] - v2[i], g);
+            half = analyze(id);
+        } else if (e && e->type == CURRENT_SOURCE) {
+            half[0] = e->value;
+        } else {
+            ACAnalysis::Probe probe;
+            if (!ACAnalysis::makeProbe(graph, solver, nm, Eigen::VectorXd::Zero(n), var, probe)) {
+                std::cerr << "Warning: " << result.names.back() << " not found; it will read as 0." << std::endl;
+            } else {
+                probe.src = 0.0;
+                for (int k = 0; k <= K; ++k) half[k] = probe.eval(X.segment(k * n, n), k * w0);
+            }
+        }
+        for (int k = 1; k <= K; ++k) half[k] *= 2.0;
+        result.phasors.push_back(std::move(half));
+    }
+    return true;
+}
+
+void HBResult::print() const {
+    std::cout << "Harmonic balance: f0 = " << f0 << " Hz, " << newtonSteps << " Newton step(s), "
+              << jacobianProducts << " Jacobian products" << std::endl;
+    for (size_t v = 0; v < names.size(); ++v) {
+        const auto& p = phasors[v];
+        std::cout << names[v] << std::endl;
+        std::cout << std::left << std::setw(6) << "k" << std::setw(16) << "Freq(Hz)"
+                  << std::setw(16) << "Amplitude" << std::setw(16) << "Phase(deg)" << std::endl;
+        double harmonics = 0.0;
+        for (size_t k = 0; k < p.size(); ++k) {
+            double amp = (k == 0) ? p[0].real() : std::abs(p[k]);
+            double ph = (k == 0) ? 0.0 : std::arg(p[k]) * 180.0 / std::numbers::pi;
+            if (k >= 2) harmonics += amp * amp;
+            std::cout << std::left << std::setw(6) << k << std::scientific << std::setprecision(6)
+                      << std::setw(16) << k * f0 << std::setw(16) << amp << std::setw(16) << ph
+                      << std::defaultfloat << std::endl;
+        }
+        if (p.size() > 2 && std::abs(p[1]) > 0.0) {
+            std::cout << "THD = " << 100.0 * std::sqrt(harmonics) / std::abs(p[1]) << " %" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef MORGHSPICY_HARMONICBALANCE_H
+#define MORGHSPICY_HARMONICBALANCE_H
+
+#pragma once
+#include <complex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <eigen3/Eigen/Sparse>
+#include <eigen3/Eigen/SparseLU>
+#include "Controller/SimConfig.h"
+#include "Controller/SimulationRunner.h"
+
+class Graph;
+class MNASolver;
+class NodeManager;
+class Diode;
+
+struct HBResult {
+    double f0 = 0.0;
+    int newtonSteps = 0;
+    int jacobianProducts = 0;
+    std::vector<std::string> names;                              // "V(out)"
+    std::vector<std::vector<std::complex<double>>> phasors;      // [var][k], k = 0..K: DC, then peak
+                                                                 // amplitude with phase against cos(k w0 t)
+    void print() const;
+};
+
+// Harmonic balance: every MNA unknown is x(t) = X0 + 2 Re sum_k Xk e^{j k w0 t}, k = 1..K.
+// The linear part (G + j k w0 C) acts on each harmonic separately; diode currents are
+// evaluated on M time samples (inverse FFT of the terminal voltages, FFT of the currents).
+// Newton's linear systems are solved matrix-free with GMRES. The preconditioner is
+// block diagonal: harmonic k uses G + j k w0 C with every diode replaced by its
+// period-average conductance, so each block is one sparse LU.
+class HarmonicBalance {
+public:
+    HarmonicBalance(Graph& g, MNASolver& solver, NodeManager& nm);
+
+    bool run(const HBConfig& cfg, const std::vector<OutputVariable>& vars, HBResult& result);
+
+private:
+    using cd = std::complex<double>;
+    struct DiodeRef { const Diode* d; int r1, r2; };
+
+    Graph& graph;
+    MNASolver& solver;
+    NodeManager& nm;
+
+    int n = 0, K = 0, M = 0;
+    double w0 = 0.0;
+    Eigen::SparseMatrix<double> G, C;
+    Eigen::MatrixXcd U;                        // n x (K+1) source spectrum
+    std::vector<DiodeRef> diodes;
+    std::vector<std::vector<double>> gd;       // per diode: conductance samples at the current iterate
+    std::vector<std::unique_ptr<Eigen::SparseLU<Eigen::SparseMatrix<cd>>>> blocks;
+
+    bool setup(const HBConfig& cfg);
+    bool sourceSpectrum();
+
+    // Time samples of one row of X (row -1 = ground), and the K+1 spectrum of samples
+    void synthesize(const Eigen::VectorXcd& X, int row, std::vector<double>& out) const;
+    std::vector<cd> analyze(const std::vector<double>& samples) const;
+
+    Eigen::VectorXcd residual(const Eigen::VectorXcd& X);       // also refreshes gd
+    Eigen::VectorXcd jacobian(const Eigen::VectorXcd& dX) const;
+    bool factorPreconditioner();
+    Eigen::VectorXcd precondition(const Eigen::VectorXcd& r) const;
+
+    // Real packing for GMRES: Re X0, then Re/Im of every harmonic
+    Eigen::VectorXd pack(const Eigen::VectorXcd& X) const;
+    Eigen::VectorXcd unpack(const Eigen::VectorXd& z) const;
+};
+
+#endif //MORGHSPICY_HARMONICBALANCE_H
@@ -0,0 +1,140 @@
+#include "ModelReduction.h"
+#include "Model/Graph.h"
+#include "Model/NodeManager.h"
+
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+    bool isLinearRLC(const Element* e) {
+        return e->type == RESISTOR || e->type == CAPACITOR || e->type == INDUCTOR;
+    }
+}
+
+ReducedModel* reduceNetwork(Graph& graph, NodeManager& nm, const std::string& name,
+                            const std::vector<std::string>& portNames, const ReductionOptions& opt) {
+    if (graph.findElement(name)) {
+        std::cerr << "Error: " << name << " already exists in the circuit" << std::endl;
+        return nullptr;
+    }
+    graph.canonicalizeNodes(nm);
+
+    // Which elements touch each node; nodes touched by anything but R/L/C cannot be internal
+    std::unordered_map<int, std::vector<Element*>> incident;
+    std::unordered_map<int, const Element*> pinned;
+    for (Element* e : graph.getElements()) {
+        incident[e->node1].push_back(e);
+        incident[e->node2].push_back(e);
+        if (!isLinearRLC(e)) {
+            pinned.emplace(e->node1, e);
+            pinned.emplace(e->node2, e);
+            if (auto* s = dynamic_cast<const vccs*>(e)) {
+                pinned.emplace(nm.canonical(s->controlNode1()), e);
+                pinned.emplace(nm.canonical(s->controlNode2()), e);
+            } else if (auto* s = dynamic_cast<const vcvs*>(e)) {
+                pinned.emplace(nm.canonical(s->controlNode1()), e);
+                pinned.emplace(nm.canonical(s->controlNode2()), e);
+            }
+        }
+    }
+
+    std::vector<int> ports;
+    std::unordered_set<int> portSet;
+    for (const auto& p : portNames) {
+        if (NodeManager::isGroundToken(p)) {
+            std::cerr << "Error: Ground is the reference of the reduced model, not a port." << std::endl;
+            return nullptr;
+        }
+        int id = nm.findId(p);
+        if (id == 0 || !incident.count(id)) {
+            std::cerr << "Error: Port node " << p << " not found in circuit." << std::endl;
+            return nullptr;
+        }
+        if (portSet.insert(id).second) ports.push_back(id);
+    }
+
+    // Split the non-port nodes into R/L/C-connected islands (ports and ground cut them apart).
+    // An island bordered only by ports and ground is part of the network; one that also
+    // reaches a node of a source or nonlinear element stays in the circuit.
+    std::unordered_set<int> internal, seen;
+    size_t kept = 0;
+    std::string keptVia;
+    for (int port : ports) {
+        for (Element* start : incident[port]) {
+            if (!isLinearRLC(start)) continue;
+            int s0 = (start->node1 == port) ? start->node2 : start->node1;
+            if (s0 == 0 || portSet.count(s0) || seen.count(s0)) continue;
+
+            std::vector<int> island{s0}, stack{s0};
+            seen.insert(s0);
+            const Element* pin = nullptr;
+            while (!stack.empty()) {
+                int u = stack.back();
+                stack.pop_back();
+                if (auto it = pinned.find(u); it != pinned.end() && !pin) pin = it->second;
+                for (Element* e : incident[u]) {
+                    if (!isLinearRLC(e)) continue;
+                    int v = (e->node1 == u) ? e->node2 : e->node1;
+                    if (v == 0 || portSet.count(v) || seen.count(v)) continue;
+                    seen.insert(v);
+                    island.push_back(v);
+                    stack.push_back(v);
+                }
+            }
+            if (pin) {
+                ++kept;
+                keptVia = pin->name;
+                continue;
+            }
+            internal.insert(island.begin(), island.end());
+        }
+    }
+    if (internal.empty()) {
+        std::cerr << "Error: No linear R/L/C network behind the given ports";
+        if (kept) std::cerr << " (what lies behind them also connects to " << keptVia << ")";
+        std::cerr << "; nothing to reduce." << std::endl;
+        return nullptr;
+    }
+
+    std::vector<Element*> network;
+    std::unordered_set<Element*> members;
+    for (Element* e : graph.getElements()) {
+        if (isLinearRLC(e) && (internal.count(e->node1) || internal.count(e->node2))) {
+            network.push_back(e);
+            members.insert(e);
+        }
+    }
+
+    // Branch currents of the removed inductors disappear with them
+    for (Element* e : graph.getElements()) {
+        const std::string* ctrl = nullptr;
+        if (auto* f = dynamic_cast<cccs*>(e)) ctrl = &f->controlName();
+        else if (auto* h = dynamic_cast<ccvs*>(e)) ctrl = &h->controlName();
+        if (!ctrl) continue;
+        Element* c = graph.findElement(*ctrl);
+        if (c && members.count(c)) {
+            std::cerr << "Error: " << e->name << " is controlled by " << *ctrl
+                      << ", which would be reduced away." << std::endl;
+            return nullptr;
+        }
+    }
+
+    std::string error;
+    ReducedModel* model = ReducedModel::build(name, network, ports, opt, error);
+    if (!model) {
+        std::cerr << "Error: Cannot reduce the network behind the ports: " << error << "." << std::endl;
+        return nullptr;
+    }
+    if (model->matchError > opt.tol) {
+        std::cerr << "Error: " << name << " reached " << model->order() << " states with relative error "
+                  << model->matchError << " up to " << opt.fmax << " Hz (tolerance " << opt.tol
+                  << "); the network is left as it is." << std::endl;
+        delete model;
+        return nullptr;
+    }
+
+    graph.removeElements(members);
+    graph.addElement(model);
+    return model;
+}
@@ -0,0 +1,21 @@
+#ifndef MORGHSPICY_MODELREDUCTION_H
+#define MORGHSPICY_MODELREDUCTION_H
+
+#pragma once
+#include <string>
+#include <vector>
+#include "Model/ReducedModel.h"
+
+class Graph;
+class NodeManager;
+
+// Replaces the linear R/L/C network behind the given port nodes by one ReducedModel element.
+// With the ports and ground removed, the circuit's R/L/C elements fall apart into islands; every
+// island next to a port that touches nothing but R, L and C is reduced, islands that also reach a
+// source or nonlinear element stay as they are. Returns the new element, or nullptr after
+// reporting why nothing could be reduced, including a model that misses opt.tol within
+// opt.maxOrder states (the circuit is then left untouched).
+ReducedModel* reduceNetwork(Graph& graph, NodeManager& nm, const std::string& name,
+                            const std::vector<std::string>& portNames, const ReductionOptions& opt);
+
+#endif //MORGHSPICY_MODELREDUCTION_H
@@ -0,0 +1,437 @@
+#include "MonteCarlo.h"
+#include "Controller/ThreadPool.h"
+#include "Model/Graph.h"
+#include "Model/MNASolver.h"
+#include "Model/NodeManager.h"
+#include "Model/Elements.h"
+#include "Model/Subcircuit.h"
+#include "Model/BatchedSolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+
+namespace {
+    std::uint64_t splitmix64(std::uint64_t x) {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+}
+
+std::string MCMeasure::label() const {
+    std::string base = (var.type == OutputVariable::VOLTAGE ? "V(" : "I(") + var.name + ")";
+    switch (kind) {
+        case MAX: return "max(" + base + ")";
+        case MIN: return "min(" + base + ")";
+        case AVG: return "avg(" + base + ")";
+        default:  return base;
+    }
+}
+
+// Everything a thread needs to run samples without touching shared state.
+struct MonteCarloAnalysis::Worker {
+    Graph         graph;
+    MNASolver     solver;
+    BatchedSolver batch;
+    bool          batched = false;
+
+    std::vector<Element*> targets;   // perturbed elements, top level or in a private subcircuit definition
+    std::vector<int>    perturbed;   // their indices into graph.elements (batched lanes), -1 inside a subcircuit
+    std::vector<double> nominal;     // nominal value of each perturbed element
+    std::vector<const ToleranceSpec*> specs;
+
+    std::vector<RunningStats> stats;
+    std::vector<Histogram>    histograms;
+    std::vector<double>       values;  // drawn element values for one sample
+    std::vector<double>       scratch; // one group's measures
+    std::vector<char>         ok;      // one group's success flags
+};
+
+namespace {
+    // Folds one transient waveform per measure into a single number as it is produced
+    struct Reduction {
+        std::vector<double> acc, weight;
+        std::vector<char>   seen;
+
+        explicit Reduction(size_t m) : acc(m, 0.0), weight(m, 0.0), seen(m, 0) {}
+
+        void add(MCMeasure::Kind kind, size_t m, double v, double h) {
+            switch (kind) {
+                case MCMeasure::MAX: acc[m] = seen[m] ? std::max(acc[m], v) : v; break;
+                case MCMeasure::MIN: acc[m] = seen[m] ? std::min(acc[m], v) : v; break;
+                case MCMeasure::AVG: acc[m] += v * h; weight[m] += h; break;
+                default:             acc[m] = v; break;
+            }
+            seen[m] = 1;
+        }
+        void finish(const std::vector<MCMeasure>& measures, double* out) const {
+            for (size_t m = 0; m < measures.size(); ++m) {
+                out[m] = acc[m];
+                if (measures[m].kind == MCMeasure::AVG && weight[m] > 0.0) out[m] /= weight[m];
+            }
+        }
+    };
+}
+
+MonteCarloAnalysis::MonteCarloAnalysis(const Graph& g, NodeManager& n, std::vector<ToleranceSpec> tols)
+        : source(g), nm(n), tolerances(std::move(tols)) {}
+
+void MonteCarloAnalysis::drawValues(const Worker& w, const MonteCarloConfig& cfg, std::size_t sample,
+                                    std::vector<double>& values) const {
+    // Per-sample stream: independent of which thread runs the sample or in what order
+    std::mt19937_64 rng(splitmix64(cfg.seed ^ splitmix64(static_cast<std::uint64_t>(sample))));
+    values.resize(w.perturbed.size());
+    for (size_t k = 0; k < w.perturbed.size(); ++k) {
+        const ToleranceSpec& spec = *w.specs[k];
+        double dev;
+        if (spec.dist == ToleranceDistribution::Gaussian) {
+            dev = std::normal_distribution<double>(0.0, spec.relative / 3.0)(rng);
+        } else {
+            dev = std::uniform_real_distribution<double>(-spec.relative, spec.relative)(rng);
+        }
+        values[k] = w.nominal[k] * (1.0 + dev);
+    }
+}
+
+bool MonteCarloAnalysis::evaluate(Worker& w, const MonteCarloConfig& cfg, std::size_t sample,
+                                  const std::vector<MCMeasure>& measures, const std::vector<Probe>& probes,
+                                  double* out) const {
+    drawValues(w, cfg, sample, w.values);
+    for (size_t k = 0; k < w.targets.size(); ++k) w.targets[k]->value = w.values[k];
+
+    auto probe = [&](const Probe& p, const Eigen::VectorXd& x, const Eigen::VectorXd& prev, double h) {
+        if (p.matrix_idx >= 0) return x(p.matrix_idx);
+        if (p.element_idx >= 0)
+            return SimulationRunner::elementCurrent(w.solver, w.graph.elements[p.element_idx], x, prev, h);
+        return 0.0;
+    };
+
+    const int n = w.solver.getTotalUnknowns();
+
+    if (cfg.analysis == MCAnalysisKind::DC) {
+        Eigen::VectorXd x = Eigen::VectorXd::Zero(n);
+        if (!SimulationRunner::solveOperatingPoint(w.graph, w.solver, x)) return false;
+        for (size_t m = 0; m < measures.size(); ++m)
+            out[m] = probe(probes[m], x, x, SimulationRunner::DC_TIMESTEP);
+        return true;
+    }
+
+    // Transient: same stepping as SimulationRunner::runTransient, reduced on the fly
+    const TransientConfig& tc = cfg.tran;
+    Reduction red(measures.size());
+    Eigen::VectorXd prev = Eigen::VectorXd::Zero(n);
+    double time = 0.0;
+    const double nominal_h = std::min(tc.dt_init, tc.dt_max);
+    while (tc.t_stop - time > 1e-9 * tc.dt_init) {
+        double h = nominal_h;
+        if (time + h > tc.t_stop) h = tc.t_stop - time;
+        const double breakpoint = w.graph.nextBreakpoint(time);
+        if (time + h > breakpoint) h = breakpoint - time;
+
+        w.graph.updateTimeDependentSources(time + h);
+        w.solver.constructMNAMatrix(w.graph, h, prev);
+        Eigen::VectorXd x = w.solver.solve();
+        if (!w.solver.lastSolveSucceeded()) return false;
+        time += h;
+
+        if (time >= tc.t_start) {
+            for (size_t m = 0; m < measures.size(); ++m)
+                red.add(measures[m].kind, m, probe(probes[m], x, prev, h), h);
+        }
+        prev = x;
+    }
+    red.finish(measures, out);
+    return true;
+}
+
+void MonteCarloAnalysis::evaluateGroup(Worker& w, const MonteCarloConfig& cfg, std::size_t first, std::size_t count,
+                                       const std::vector<MCMeasure>& measures, const std::vector<Probe>& probes,
+                                       double* out, char* ok) const {
+    const size_t M = measures.size();
+    if (!w.batched) {
+        for (size_t i = 0; i < count; ++i) ok[i] = evaluate(w, cfg, first + i, measures, probes, out + i * M);
+        return;
+    }
+
+    constexpr int L = BatchedSolver::LANES;
+    const size_t K = w.perturbed.size();
+    std::vector<double> laneValues(count * K);
+    BatchedSolver::LaneMask live = 0;
+    for (size_t i = 0; i < count; ++i) {
+        drawValues(w, cfg, first + i, w.values);
+        for (size_t k = 0; k < K; ++k) w.batch.setLaneValue(w.perturbed[k], static_cast<int>(i), w.values[k]);
+        std::copy(w.values.begin(), w.values.end(), laneValues.begin() + static_cast<long>(i * K));
+        live |= 1u << i;
+    }
+
+    // Element-current probes read element values, so point the graph at the lane's values first
+    bool needsValues = std::any_of(probes.begin(), probes.end(), [](const Probe& p) { return p.element_idx >= 0; });
+    Eigen::VectorXd xl, pl;
+    auto probeLane = [&](int lane, const std::vector<double>& x, const std::vector<double>& prev, double h,
+                         const std::function<void(size_t, double)>& sink) {
+        w.batch.extractLane(x, lane, xl);
+        if (needsValues) {
+            w.batch.extractLane(prev, lane, pl);
+            for (size_t k = 0; k < K; ++k)
+                w.targets[k]->value = laneValues[lane * K + k];
+        }
+        for (size_t m = 0; m < M; ++m) {
+            const Probe& p = probes[m];
+            double v = 0.0;
+            if (p.matrix_idx >= 0) v = xl(p.matrix_idx);
+            else if (p.element_idx >= 0)
+                v = SimulationRunner::elementCurrent(w.solver, w.graph.elements[p.element_idx], xl, pl, h);
+            sink(m, v);
+        }
+    };
+
+    const int n = w.batch.unknowns();
+    std::vector<double> x(static_cast<size_t>(n) * L, 0.0);
+
+    if (cfg.analysis == MCAnalysisKind::DC) {
+        live &= w.batch.solveOperatingPoint(x, live);
+        for (size_t i = 0; i < count; ++i) {
+            if (!(live & (1u << i))) continue;
+            probeLane(static_cast<int>(i), x, x, SimulationRunner::DC_TIMESTEP,
+                      [&](size_t m, double v) { out[i * M + m] = v; });
+        }
+    } else {
+        const TransientConfig& tc = cfg.tran;
+        std::vector<Reduction> red(count, Reduction(M));
+        std::vector<double> prev(x.size(), 0.0);
+        double time = 0.0;
+        double h = tc.dt_init;
+        while (tc.t_stop - time > 1e-9 * tc.dt_init && live) {
+            if (time + h > tc.t_stop) h = tc.t_stop - time;
+            if (h > tc.dt_max) h = tc.dt_max;
+
+            w.graph.updateTimeDependentSources(time + h);
+            live &= w.batch.solveStep(h, prev, x, live);
+            time += h;
+
+            if (time >= tc.t_start) {
+                for (size_t i = 0; i < count; ++i) {
+                    if (!(live & (1u << i))) continue;
+                    probeLane(static_cast<int>(i), x, prev, h,
+                              [&](size_t m, double v) { red[i].add(measures[m].kind, m, v, h); });
+                }
+            }
+            prev.swap(x);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (live & (1u << i)) red[i].finish(measures, out + i * M);
+        }
+    }
+
+    // Lanes split out of the batch take the scalar path
+    for (size_t i = 0; i < count; ++i) {
+        ok[i] = (live & (1u << i)) ? 1 : static_cast<char>(evaluate(w, cfg, first + i, measures, probes, out + i * M));
+    }
+    w.batch.resetLaneValues();
+}
+
+MonteCarloResult MonteCarloAnalysis::run(const MonteCarloConfig& cfg, const std::vector<MCMeasure>& measures) {
+    MonteCarloResult result;
+    result.samples = std::max(cfg.N, 0);
+    if (result.samples == 0 || measures.empty()) return result;
+
+    const size_t N = static_cast<size_t>(result.samples);
+    const size_t M = measures.size();
+
+    auto makeWorker = [&]() {
+        auto w = std::make_unique<Worker>();
+        // Last matching spec wins, same as setTolerance overriding by pattern
+        auto specFor = [&](const std::string& name) {
+            const ToleranceSpec* spec = nullptr;
+            for (const auto& t : tolerances) if (t.matches(name)) spec = &t;
+            return spec;
+        };
+        auto perturb = [&](Element* e, int index, const ToleranceSpec* spec) {
+            w->targets.push_back(e);
+            w->perturbed.push_back(index);
+            w->nominal.push_back(e->value);
+            w->specs.push_back(spec);
+        };
+
+        const auto& elems = source.getElements();
+        for (size_t i = 0; i < elems.size(); ++i) {
+            Element* e = elems[i]->clone();
+            w->graph.addElement(e);
+            if (e->type != SUBCIRCUIT) {
+                if (const ToleranceSpec* spec = specFor(e->name)) perturb(e, static_cast<int>(i), spec);
+                continue;
+            }
+
+            // "X1.R1" is R1 inside instance X1; the definition is shared, so the instance
+            // gets its own copy before any of its elements is perturbed
+            auto* sub = static_cast<Subcircuit*>(e);
+            std::shared_ptr<SubcircuitDef> own;
+            for (size_t j = 0; j < sub->def->elements.size(); ++j) {
+                const ToleranceSpec* spec = specFor(sub->name + "." + sub->def->elements[j]->name);
+                if (!spec) continue;
+                if (!own) sub->def = own = sub->def->copy();
+                perturb(own->elements[j].get(), -1, spec);
+            }
+        }
+        w->solver.initializeMatrix(w->graph);
+        w->batched = cfg.batched && w->batch.compile(w->graph, w->solver);
+        return w;
+    };
+
+    auto first = makeWorker();
+    if (!first->solver.hasUnknowns()) {
+        std::cerr << "Error: Monte Carlo cannot run, the circuit is not correctly defined." << std::endl;
+        return result;
+    }
+    if (first->perturbed.empty()) {
+        std::cerr << "Warning: No element matches a tolerance; every sample is the nominal circuit." << std::endl;
+    }
+
+    // Samples are handed out in groups that fill the SIMD lanes
+    const size_t G = first->batched ? static_cast<size_t>(BatchedSolver::LANES) : 1;
+    auto groups = [&](size_t count) { return (count + G - 1) / G; };
+    unsigned nWorkers = cfg.workers ? cfg.workers : defaultWorkerCount();
+    nWorkers = static_cast<unsigned>(std::min<size_t>(nWorkers, groups(N)));
+
+    std::vector<std::unique_ptr<Worker>> workers(nWorkers);
+    workers[0] = std::move(first);
+    std::cout << "Monte Carlo: " << N << " samples on " << nWorkers << " worker(s)"
+              << (workers[0]->batched ? ", " + std::to_string(BatchedSolver::LANES) + " lanes per solve" : "")
+              << std::endl;
+
+    // Resolve outputs once, on this thread (NodeManager is not thread-safe)
+    std::vector<Probe> probes(M);
+    for (size_t m = 0; m < M; ++m) {
+        const OutputVariable& var = measures[m].var;
+        if (var.type == OutputVariable::VOLTAGE) {
+            int row = -1;
+            if (SimulationRunner::voltageRow(workers[0]->graph, workers[0]->solver, nm, var.name, row) && row < 0)
+                continue;   // ground reads as 0 anyway
+            probes[m].matrix_idx = row;
+        } else {
+            probes[m].element_idx = source.indexOf(var.name);
+        }
+        if (probes[m].matrix_idx < 0 && probes[m].element_idx < 0) {
+            std::cerr << "Warning: " << measures[m].label() << " not found; it will read as 0." << std::endl;
+        }
+    }
+
+    std::atomic<int> failed{0};
+
+    // Phase 1: a pilot batch fixes the histogram ranges. Only pilot x M values are stored.
+    const size_t P = std::min<size_t>(static_cast<size_t>(std::max(cfg.pilot, 1)), N);
+    std::vector<double> pilotValues(P * M, 0.0);
+    std::vector<char>   pilotOk(P, 0);
+    parallelFor(groups(P), nWorkers, [&](size_t gi, unsigned wi) {
+        if (!workers[wi]) workers[wi] = makeWorker();
+        size_t begin = gi * G, count = std::min(G, P - begin);
+        evaluateGroup(*workers[wi], cfg, begin, count, measures, probes,
+                      pilotValues.data() + begin * M, pilotOk.data() + begin);
+    });
+
+    std::vector<Histogram> templates;
+    for (size_t m = 0; m < M; ++m) {
+        double lo = std::numeric_limits<double>::infinity(), hi = -lo;
+        for (size_t i = 0; i < P; ++i) {
+            if (!pilotOk[i]) continue;
+            lo = std::min(lo, pilotValues[i * M + m]);
+            hi = std::max(hi, pilotValues[i * M + m]);
+        }
+        if (lo > hi) { lo = 0.0; hi = 1.0; }
+        double pad = (hi - lo) * 0.1;
+        if (pad == 0.0) pad = std::max(std::abs(lo) * 1e-6, 1e-12);
+        templates.emplace_back(lo - pad, hi + pad, cfg.bins);
+    }
+
+    for (auto& w : workers) {
+        if (!w) continue;
+        w->stats.assign(M, RunningStats{});
+        w->histograms = templates;
+    }
+    for (size_t i = 0; i < P; ++i) {
+        if (!pilotOk[i]) { ++failed; continue; }
+        for (size_t m = 0; m < M; ++m) {
+            workers[0]->stats[m].add(pilotValues[i * M + m]);
+            workers[0]->histograms[m].add(pilotValues[i * M + m]);
+        }
+    }
+    pilotValues.clear();
+    pilotValues.shrink_to_fit();
+
+    // Phase 2: everything else goes straight into per-worker accumulators
+    parallelFor(groups(N - P), nWorkers, [&](size_t gi, unsigned wi) {
+        if (!workers[wi]) {
+            workers[wi] = makeWorker();
+            workers[wi]->stats.assign(M, RunningStats{});
+            workers[wi]->histograms = templates;
+        }
+        Worker& w = *workers[wi];
+        size_t begin = P + gi * G, count = std::min(G, N - begin);
+        w.scratch.resize(count * M);
+        w.ok.resize(count);
+        evaluateGroup(w, cfg, begin, count, measures, probes, w.scratch.data(), w.ok.data());
+        for (size_t i = 0; i < count; ++i) {
+            if (!w.ok[i]) { ++failed; continue; }
+            for (size_t m = 0; m < M; ++m) {
+                w.stats[m].add(w.scratch[i * M + m]);
+                w.histograms[m].add(w.scratch[i * M + m]);
+            }
+        }
+    });
+
+    result.failed = failed.load();
+    result.measures.resize(M);
+    for (size_t m = 0; m < M; ++m) {
+        result.measures[m].name = measures[m].label();
+        result.measures[m].histogram = templates[m];
+        for (auto& w : workers) {
+            if (!w) continue;
+            result.measures[m].stats.merge(w->stats[m]);
+            result.measures[m].histogram.merge(w->histograms[m]);
+        }
+    }
+    return result;
+}
+
+void MonteCarloResult::print() const {
+    std::cout << "Monte Carlo: " << samples - failed << " of " << samples << " samples succeeded" << std::endl;
+    std::cout << std::left << std::setw(20) << "Measure"
+              << std::setw(15) << "mean" << std::setw(15) << "std"
+              << std::setw(15) << "min" << std::setw(15) << "max" << std::endl;
+    for (const auto& m : measures) {
+        std::cout << std::left << std::setw(20) << m.name << std::scientific << std::setprecision(6)
+                  << std::setw(15) << m.stats.mean() << std::setw(15) << m.stats.stddev()
+                  << std::setw(15) << m.stats.min() << std::setw(15) << m.stats.max() << std::endl;
+    }
+    std::cout << std::defaultfloat;
+
+    for (const auto& m : measures) {
+        const Histogram& h = m.histogram;
+        std::uint64_t peak = 1;
+        for (auto c : h.binCounts()) peak = std::max(peak, c);
+
+        std::cout << "\nHistogram of " << m.name << std::endl;
+        double width = (h.upper() - h.lower()) / h.bins();
+        // Enough significant digits that neighbouring centres differ, even for a narrow spread around a large mean
+        int digits = 5;
+        const double magnitude = std::max(std::abs(h.lower()), std::abs(h.upper()));
+        if (width > 0 && magnitude > 0)
+            digits = std::clamp(static_cast<int>(std::ceil(std::log10(magnitude / width))) + 2, 5, 17);
+        for (int b = 0; b < h.bins(); ++b) {
+            std::uint64_t c = h.binCounts()[b];
+            std::cout << std::right << std::setw(std::max(14, digits + 8)) << std::setprecision(digits) << (h.lower() + (b + 0.5) * width)
+                      << " | " << std::string(static_cast<size_t>(40 * c / peak), '#') << " " << c << std::endl;
+        }
+        if (h.underflow() || h.overflow()) {
+            std::cout << "  (outside range: " << h.underflow() << " below, " << h.overflow() << " above)" << std::endl;
+        }
+    }
+    std::cout << std::left;
+}
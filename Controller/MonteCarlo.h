@@ -0,0 +1,73 @@
+#ifndef MORGHSPICY_MONTECARLO_H
+#define MORGHSPICY_MONTECARLO_H
+
+#pragma once
+#include <string>
+#include <vector>
+#include "Controller/SimConfig.h"
+#include "Controller/SimulationRunner.h"
+#include "Controller/Statistics.h"
+
+class Graph;
+class NodeManager;
+
+// One scalar extracted from each Monte Carlo sample.
+// DC: the operating-point value. Transient: reduced over the run by `kind`.
+struct MCMeasure {
+    enum Kind { FINAL, MAX, MIN, AVG };
+    Kind           kind = FINAL;
+    OutputVariable var;
+
+    std::string label() const;
+};
+
+struct MCMeasureResult {
+    std::string  name;
+    RunningStats stats;
+    Histogram    histogram;
+};
+
+struct MonteCarloResult {
+    int samples = 0;   // requested
+    int failed  = 0;   // singular matrix or Newton did not converge
+    std::vector<MCMeasureResult> measures;
+
+    void print() const;
+};
+
+// Tolerance study over a snapshot of the circuit. Every worker thread owns a private
+// clone of the graph and its own MNASolver, so the shared circuit is never touched
+// while samples run. Sample i draws its deviations from an RNG stream derived only
+// from (seed, i), so results do not depend on the number of threads or on scheduling.
+// Only streaming statistics are kept: memory is O(workers * measures * bins).
+// When the circuit fits the BatchedSolver kernels, samples are run LANES at a time.
+class MonteCarloAnalysis {
+public:
+    MonteCarloAnalysis(const Graph& g, NodeManager& nm, std::vector<ToleranceSpec> tolerances);
+
+    MonteCarloResult run(const MonteCarloConfig& cfg, const std::vector<MCMeasure>& measures);
+
+private:
+    struct Probe {
+        int matrix_idx  = -1; // voltage: row in the solution vector
+        int element_idx = -1; // current: position in Graph::elements
+    };
+    struct Worker;
+
+    const Graph& source;
+    NodeManager& nm;
+    std::vector<ToleranceSpec> tolerances;
+
+    void drawValues(const Worker& w, const MonteCarloConfig& cfg, std::size_t sample,
+                    std::vector<double>& values) const;
+    bool evaluate(Worker& w, const MonteCarloConfig& cfg, std::size_t sample,
+                  const std::vector<MCMeasure>& measures, const std::vector<Probe>& probes,
+                  double* out) const;
+    // Samples [first, first + count) with count <= BatchedSolver::LANES, one lane each;
+    // lanes the batch drops are redone with evaluate(). out is count x measures.
+    void evaluateGroup(Worker& w, const MonteCarloConfig& cfg, std::size_t first, std::size_t count,
+                       const std::vector<MCMeasure>& measures, const std::vector<Probe>& probes,
+                       double* out, char* ok) const;
+};
+
+#endif //MORGHSPICY_MONTECARLO_H
@@ -0,0 +1,246 @@
+#include "NetlistLoader.h"
+#include "CircuitSnapshot.h"
+#include "ThreadPool.h"
+#include "Model/Graph.h"
+#include "Model/MappedFile.h"
+#include "Model/NodeManager.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <utility>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+namespace {
+    constexpr std::size_t SLICE_BYTES = 1 << 20;   // per task; a window is one slice per worker
+
+    // Scale per suffix letter, 0 = not a suffix
+    constexpr std::array<double, 256> makeScaleTable() {
+        std::array<double, 256> t{};
+        const std::pair<char, double> suffixes[] = {
+            {'k', 1e3}, {'m', 1e-3}, {'u', 1e-6}, {'n', 1e-9},
+            {'p', 1e-12}, {'g', 1e9}, {'h', 1e2}, {'t', 1e12},
+        };
+        for (auto [c, scale] : suffixes) {
+            t[static_cast<unsigned char>(c)] = scale;
+            t[static_cast<unsigned char>(c - 'a' + 'A')] = scale;
+        }
+        return t;
+    }
+    constexpr std::array<double, 256> SCALE = makeScaleTable();
+
+    bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+    std::string_view nextToken(std::string_view& rest) {
+        std::size_t i = 0;
+        while (i < rest.size() && isBlank(rest[i])) ++i;
+        std::size_t j = i;
+        while (j < rest.size() && !isBlank(rest[j])) ++j;
+        std::string_view tok = rest.substr(i, j - i);
+        rest.remove_prefix(j);
+        return tok;
+    }
+
+    enum class LineKind : unsigned char { Element, Delegate, Malformed };
+
+    struct ParsedLine {
+        std::string_view text, name, n1, n2, val;
+        double value = 0.0;
+        bool valueOk = false;
+        LineKind kind = LineKind::Malformed;
+    };
+
+    // Names with a library/<name>.sub file; `add` expands those as subcircuits
+    std::vector<std::string> librarySubcircuits() {
+        std::vector<std::string> names;
+        std::error_code ec;
+        for (std::filesystem::directory_iterator it("library", ec), end; !ec && it != end; it.increment(ec))
+            if (it->path().extension() == ".sub") names.push_back(it->path().stem().string());
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    void parseSlice(std::string_view slice, const std::vector<std::string>& subcircuits, std::vector<ParsedLine>& out) {
+        while (!slice.empty()) {
+            std::size_t nl = slice.find('\n');
+            std::string_view line = slice.substr(0, nl);
+            slice.remove_prefix(nl == std::string_view::npos ? slice.size() : nl + 1);
+            if (line.empty() || line[0] == '*' || line[0] == '#') continue;
+
+            ParsedLine p;
+            p.text = line;
+            std::string_view rest = line;
+            nextToken(rest);   // type column, implied by the name
+            p.name = nextToken(rest);
+            p.n1 = nextToken(rest);
+            p.n2 = nextToken(rest);
+            p.val = nextToken(rest);
+            if (p.val.empty()) { out.push_back(p); continue; }
+
+            const char type = p.name[0];
+            const bool simple = type == 'R' || type == 'C' || type == 'L' || type == 'V' || type == 'I' || type == 'D';
+            if (!simple || p.name == "GND" || p.val == "PULSE" || p.val == "PWL" ||
+                (!subcircuits.empty() && std::binary_search(subcircuits.begin(), subcircuits.end(), p.name))) {
+                p.kind = LineKind::Delegate;
+                // The command gets the whole tail (PULSE(...), PWL file=..., controlled-source args)
+                std::size_t end = static_cast<std::size_t>(line.data() + line.size() - p.val.data());
+                while (end > 0 && isBlank(p.val.data()[end - 1])) --end;
+                p.val = std::string_view(p.val.data(), end);
+            } else {
+                p.kind = LineKind::Element;
+                if (type != 'D') p.valueOk = parseEngineeringValue(p.val, p.value);
+            }
+            out.push_back(p);
+        }
+    }
+
+    void addParsed(const ParsedLine& p, Graph& g, NodeManager& nm,
+                   const std::function<void(const std::string&)>& fallback, NetlistLoadStats& stats,
+                   CircuitSnapshot::Writer* snapshot) {
+        if (p.kind == LineKind::Malformed) {
+            std::cerr << "Error: Malformed line in file: " << p.text << std::endl;
+            ++stats.errors;
+            return;
+        }
+        if (p.kind == LineKind::Delegate) {
+            std::string cmd = "add ";
+            cmd.append(p.name).append(" ").append(p.n1).append(" ").append(p.n2).append(" ").append(p.val);
+            fallback(cmd);
+            if (snapshot) snapshot->command(cmd);
+            ++stats.delegated;
+            return;
+        }
+
+        std::string name(p.name);
+        if (g.findElement(name)) {
+            std::cerr << "Error: " << name << " already exists in the circuit\n";
+            ++stats.errors;
+            return;
+        }
+        const char type = name[0];
+        if (type == 'D') {
+            if (p.val != "D" && p.val != "Z") {
+                std::cerr << "Error: Model " << p.val << " not found in library\n";
+                ++stats.errors;
+                return;
+            }
+            int n1 = nm.resolveId(p.n1);
+            int n2 = nm.resolveId(p.n2);
+            g.addElement(g.make<Diode>(std::move(name), n1, n2, std::string(p.val)));
+            if (snapshot) snapshot->element(type, p.name, n1, n2, 0.0, p.val);
+            ++stats.elements;
+            return;
+        }
+        if (!p.valueOk || (type != 'V' && type != 'I' && p.value <= 0)) {
+            std::string typeName = "Value";
+            if (type == 'R') typeName = "Resistance";
+            else if (type == 'C') typeName = "Capacitance";
+            else if (type == 'L') typeName = "Inductance";
+            std::cerr << "Error: " << typeName << " cannot be zero or negative\n";
+            ++stats.errors;
+            return;
+        }
+        int n1 = nm.resolveId(p.n1);
+        int n2 = nm.resolveId(p.n2);
+        Element* e = nullptr;
+        switch (type) {
+            case 'R': e = g.make<Resistor>(std::move(name), n1, n2, p.value); break;
+            case 'C': e = g.make<Capacitor>(std::move(name), n1, n2, p.value); break;
+            case 'L': e = g.make<Inductor>(std::move(name), n1, n2, p.value); break;
+            case 'V': e = g.make<VoltageSource>(std::move(name), n1, n2, p.value); break;
+            default:  e = g.make<CurrentSource>(std::move(name), n1, n2, p.value); break;
+        }
+        g.addElement(e);
+        if (snapshot) snapshot->element(type, p.name, n1, n2, p.value);
+        ++stats.elements;
+    }
+
+    // Tokenizes the netlist window by window and adds its lines in file order
+    void parseAndAdd(std::string_view netlist, const std::vector<std::string>& subcircuits, Graph& g, NodeManager& nm,
+                     const std::function<void(const std::string&)>& fallback, NetlistLoadStats& stats,
+                     CircuitSnapshot::Writer* snapshot) {
+        const unsigned workers = defaultWorkerCount();
+
+        // ~24 bytes per element line
+        Graph::BulkEdit bulk(g, nm, netlist.size() / 24);
+
+        // Work through the file one window at a time so the parsed lines of only one window
+        // are held at once: slices in parallel, then their lines in order
+        std::string_view rest = netlist;
+        std::vector<std::vector<ParsedLine>> parsed(workers);
+        std::vector<std::string_view> slices;
+        while (!rest.empty()) {
+            slices.clear();
+            for (unsigned w = 0; w < workers && !rest.empty(); ++w) {
+                std::size_t cut = std::min(rest.size(), SLICE_BYTES);
+                if (cut < rest.size()) {
+                    std::size_t nl = rest.find('\n', cut);
+                    cut = nl == std::string_view::npos ? rest.size() : nl + 1;
+                }
+                slices.push_back(rest.substr(0, cut));
+                rest.remove_prefix(cut);
+            }
+
+            auto parse = [&](std::size_t k, unsigned) {
+                parsed[k].clear();
+                parseSlice(slices[k], subcircuits, parsed[k]);
+            };
+            if (slices.size() == 1) parse(0, 0);
+            else parallelFor(slices.size(), workers, parse);
+
+            for (std::size_t k = 0; k < slices.size(); ++k) {
+                stats.lines += parsed[k].size();
+                for (const ParsedLine& p : parsed[k]) addParsed(p, g, nm, fallback, stats, snapshot);
+            }
+        }
+    }
+}
+
+bool parseEngineeringValue(std::string_view s, double& value) {
+    if (s.empty()) return false;
+    double scale = SCALE[static_cast<unsigned char>(s.back())];
+    if (scale != 0.0) s.remove_suffix(1);
+    else scale = 1.0;
+
+    std::size_t i = 0;
+    while (i < s.size() && (isBlank(s[i]) || s[i] == '\n')) ++i;
+    if (i < s.size() && s[i] == '+') ++i;   // from_chars takes '-' but not '+'
+    double v = 0.0;
+    auto [end, ec] = std::from_chars(s.data() + i, s.data() + s.size(), v);
+    if (ec != std::errc()) return false;
+    value = v * scale;
+    return true;
+}
+
+bool loadNetlist(const std::string& path, Graph& g, NodeManager& nm,
+                 const std::function<void(const std::string& command)>& fallback,
+                 NetlistLoadStats* statsOut, bool writeSnapshot) {
+    MappedFile file(path);
+    if (!file.isOpen()) return false;
+
+    NetlistLoadStats stats;
+    const std::vector<std::string> subcircuits = librarySubcircuits();
+
+    // Snapshots record a load into an empty circuit, whose ids they can reproduce
+    const bool useSnapshot = g.getElements().empty() && nm.empty();
+    const std::uint64_t key = useSnapshot ? CircuitSnapshot::key(file.view(), subcircuits) : 0;
+    if (useSnapshot && CircuitSnapshot::restore(key, file.size(), g, nm, fallback, stats)) {
+        stats.fromSnapshot = true;
+        if (statsOut) *statsOut = stats;
+        return true;
+    }
+    CircuitSnapshot::Writer writer;
+    CircuitSnapshot::Writer* snapshot = useSnapshot && writeSnapshot ? &writer : nullptr;
+    const unsigned long revision = nm.revision();
+
+    parseAndAdd(file.view(), subcircuits, g, nm, fallback, stats, snapshot);
+
+    // A merge (a GND line) leaves labels on representatives the records do not use
+    if (snapshot && stats.errors == 0 && nm.revision() == revision)
+        snapshot->write(key, file.size(), nm, stats);
+
+    if (statsOut) *statsOut = stats;
+    return true;
+}
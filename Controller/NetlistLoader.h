@@ -0,0 +1,41 @@
+#ifndef MORGHSPICY_NETLISTLOADER_H
+#define MORGHSPICY_NETLISTLOADER_H
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+class Graph;
+class NodeManager;
+
+// Engineering value: a number with an optional one-letter scale suffix (k m u n p g h t,
+// either case). Like stod, leading blanks are skipped and anything after the number is
+// ignored. False if there is no number.
+bool parseEngineeringValue(std::string_view s, double& value);
+
+struct NetlistLoadStats {
+    std::size_t lines = 0;       // lines that are not blank or comments
+    std::size_t elements = 0;    // elements added directly
+    std::size_t delegated = 0;   // lines passed on as "add ..." commands
+    std::size_t errors = 0;
+    bool fromSnapshot = false;   // restored from snapshots/ instead of parsed
+};
+
+// Loads a file of "<type> <name> <n1> <n2> <value>" lines (the `load` format) into g / nm.
+// The file is memory-mapped and cut at line boundaries into slices that are tokenized in
+// parallel (string_views into the mapping, values via from_chars). The elements are then
+// added serially in file order, so node ids, names and error messages are the same as
+// for lines typed one by one. R, C, L, V, I and D lines are handled here. Other lines go
+// to `fallback` as "add <name> <n1> <n2> <value>": subcircuit instances, GND, controlled
+// and sine/pulse sources. Returns false if the file cannot be opened.
+//
+// A load into an empty circuit is restored from the snapshot cache (see CircuitSnapshot.h)
+// when it holds the same bytes. Only with writeSnapshot does a clean load that merged no
+// nodes write one there.
+bool loadNetlist(const std::string& path, Graph& g, NodeManager& nm,
+                 const std::function<void(const std::string& command)>& fallback,
+                 NetlistLoadStats* stats = nullptr, bool writeSnapshot = false);
+
+#endif //MORGHSPICY_NETLISTLOADER_H
@@ -0,0 +1,102 @@
+#include "PSSAnalysis.h"
+#include "Model/Graph.h"
+#include "Model/MNASolver.h"
+#include "Model/NodeManager.h"
+#include "Model/Elements.h"
+#include "Model/Krylov.h"
+
+#include <cmath>
+#include <iostream>
+
+PSSAnalysis::PSSAnalysis(Graph& g, MNASolver& s, NodeManager& n) : graph(g), solver(s), nm(n) {}
+
+Eigen::VectorXd PSSAnalysis::period(const Eigen::VectorXd& x0, const PSSConfig& cfg,
+                                    std::vector<Eigen::VectorXd>* trace) {
+    const double h = 1.0 / (cfg.f0 * cfg.steps);
+    Eigen::VectorXd x = x0;
+    if (trace) trace->assign(1, x0);
+    for (int k = 1; k <= cfg.steps; ++k) {
+        graph.updateTimeDependentSources(k * h);
+        solver.constructMNAMatrix(graph, h, x);
+        x = solver.solve();
+        if (!solver.lastSolveSucceeded()) {
+            failed = true;
+            break;
+        }
+        if (trace) trace->push_back(x);
+    }
+    ++periods;
+    return x;
+}
+
+PlotData PSSAnalysis::run(const PSSConfig& cfg, const std::vector<OutputVariable>& vars) {
+    PlotData pd;
+    newton = periods = 0;
+    failed = false;
+
+    graph.canonicalizeNodes(nm);
+    solver.initializeMatrix(graph);
+    if (!solver.hasUnknowns()) {
+        std::cerr << "Error: PSS analysis cannot run, the circuit is not correctly defined." << std::endl;
+        return pd;
+    }
+
+    // Start from the operating point at t = 0, then let the fast transients die out
+    Eigen::VectorXd x0 = Eigen::VectorXd::Zero(solver.getTotalUnknowns());
+    graph.updateTimeDependentSources(0.0);
+    if (!SimulationRunner::solveOperatingPoint(graph, solver, x0)) x0.setZero();
+    for (int i = 0; i < cfg.warmup && !failed; ++i) x0 = period(x0, cfg);
+
+    bool converged = false;
+    for (; newton < cfg.max_newton && !failed; ++newton) {
+        Eigen::VectorXd xT = period(x0, cfg);
+        Eigen::VectorXd r = xT - x0;
+        if (r.norm() <= cfg.tol * (1.0 + x0.norm())) { converged = true; break; }
+
+        // (M - I) v, M*v by a forward difference of the period map along v
+        const double scale = 1.0 + x0.norm();
+        std::function<Eigen::VectorXd(const Eigen::VectorXd&)> apply = [&](const Eigen::VectorXd& v) {
+            double nv = v.norm();
+            if (nv == 0.0) return Eigen::VectorXd(Eigen::VectorXd::Zero(v.size()));
+            double eps = 1e-7 * scale / nv;
+            return Eigen::VectorXd((period(x0 + eps * v, cfg) - xT) / eps - v);
+        };
+        std::function<Eigen::VectorXd(const Eigen::VectorXd&)> identity = [](const Eigen::VectorXd& v) { return v; };
+
+        Eigen::VectorXd dx = Eigen::VectorXd::Zero(x0.size());
+        gmres<Eigen::VectorXd>(apply, identity, Eigen::VectorXd(-r), dx, 1e-4, cfg.max_krylov);
+        x0 += dx;
+    }
+    if (failed) {
+        std::cerr << "Error: Solver failed during a PSS period simulation." << std::endl;
+        return pd;
+    }
+    if (!converged) {
+        std::cerr << "Error: PSS shooting did not converge in " << cfg.max_newton << " Newton steps." << std::endl;
+        return pd;
+    }
+
+    // Record the converged period
+    std::vector<Eigen::VectorXd> trace;
+    period(x0, cfg, &trace);
+    const double h = 1.0 / (cfg.f0 * cfg.steps);
+    for (int k = 0; k <= cfg.steps; ++k) pd.time_axis.push_back(k * h);
+
+    for (const auto& var : vars) {
+        pd.series_names.push_back((var.type == OutputVariable::VOLTAGE ? "V(" : "I(") + var.name + ")");
+        std::vector<double> s(cfg.steps + 1, 0.0);
+        int row = -1;
+        if (var.type == OutputVariable::VOLTAGE && SimulationRunner::voltageRow(graph, solver, nm, var.name, row)) {
+            if (row >= 0)
+                for (int k = 0; k <= cfg.steps; ++k) s[k] = trace[k](row);
+        } else if (const Element* e = var.type == OutputVariable::CURRENT ? graph.findElement(var.name) : nullptr) {
+            for (int k = 1; k <= cfg.steps; ++k)
+                s[k] = SimulationRunner::elementCurrent(solver, e, trace[k], trace[k - 1], h);
+            s[0] = s[cfg.steps]; // periodic
+        } else {
+            std::cerr << "Warning: " << pd.series_names.back() << " not found; it will read as 0." << std::endl;
+        }
+        pd.data_series.push_back(std::move(s));
+    }
+    return pd;
+}
@@ -0,0 +1,43 @@
+#ifndef MORGHSPICY_PSSANALYSIS_H
+#define MORGHSPICY_PSSANALYSIS_H
+
+#pragma once
+#include <vector>
+#include "Controller/SimConfig.h"
+#include "Controller/SimulationRunner.h"
+
+class Graph;
+class MNASolver;
+class NodeManager;
+
+// Periodic steady state by the shooting method. Phi(x0) is one period of the same
+// backward-Euler stepping runTransient does; Newton solves Phi(x0) - x0 = 0 and every
+// Newton step solves (M - I) dx = -(Phi(x0) - x0) with GMRES, where the monodromy
+// product M*v is a directional difference of two period simulations (never formed).
+// Slow RC/LC settling that takes thousands of periods in plain transient collapses
+// into a few dozen period simulations.
+class PSSAnalysis {
+public:
+    PSSAnalysis(Graph& g, MNASolver& solver, NodeManager& nm);
+
+    // One steady-state period (time_axis 0..T); empty when shooting did not converge
+    PlotData run(const PSSConfig& cfg, const std::vector<OutputVariable>& vars);
+
+    int newtonSteps() const { return newton; }
+    int periodsSimulated() const { return periods; }
+
+private:
+    Graph& graph;
+    MNASolver& solver;
+    NodeManager& nm;
+
+    int newton = 0;
+    int periods = 0;
+    bool failed = false;
+
+    // x(T) from x(0); `trace` (if given) receives x at every step including x(0)
+    Eigen::VectorXd period(const Eigen::VectorXd& x0, const PSSConfig& cfg,
+                           std::vector<Eigen::VectorXd>* trace = nullptr);
+};
+
+#endif //MORGHSPICY_PSSANALYSIS_H
@@ -0,0 +1,198 @@
+#include "Sensitivity.h"
+#include "Controller/ACAnalysis.h"
+#include "Model/Graph.h"
+#include "Model/MNASolver.h"
+#include "Model/NodeManager.h"
+#include "Model/Elements.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+SensitivityAnalysis::SensitivityAnalysis(Graph& g, MNASolver& s, NodeManager& n) : graph(g), solver(s), nm(n) {}
+
+int SensitivityAnalysis::row(int node) const {
+    if (node == 0) return -1;
+    auto it = solver.getNodeToMatrixIdxMap().find(node);
+    return it == solver.getNodeToMatrixIdxMap().end() ? -1 : it->second;
+}
+
+double SensitivityAnalysis::rowValue(const Eigen::VectorXd& v, int node) const {
+    int r = row(node);
+    return r == -1 ? 0.0 : v(r);
+}
+
+bool SensitivityAnalysis::prepare(const OutputVariable& out) {
+    graph.canonicalizeNodes(nm);
+    solver.initializeMatrix(graph);
+    if (!solver.hasUnknowns()) {
+        std::cerr << "Error: Sensitivity analysis cannot run, the circuit is not correctly defined." << std::endl;
+        return false;
+    }
+
+    op = Eigen::VectorXd::Zero(solver.getTotalUnknowns());
+    if (!SimulationRunner::solveOperatingPoint(graph, solver, op)) {
+        std::cerr << "Error: DC operating point did not converge." << std::endl;
+        return false;
+    }
+
+    // Output functional c = d(output)/dx; the small-signal probe at w = 0 is exactly that
+    ACAnalysis::Probe probe;
+    if (!ACAnalysis::makeProbe(graph, solver, nm, op, out, probe)) {
+        std::cerr << "Error: Output " << (out.type == OutputVariable::VOLTAGE ? "V(" : "I(") << out.name
+                  << ") not found in circuit." << std::endl;
+        return false;
+    }
+    c = Eigen::VectorXd::Zero(solver.getTotalUnknowns());
+    if (probe.row >= 0) c(probe.row) = 1.0;
+    for (const auto& t : probe.terms) c(t.col) += probe.sign * t.g;
+
+    if (out.type == OutputVariable::VOLTAGE) {
+        outputValue = probe.row >= 0 ? op(probe.row) : 0.0;
+    } else {
+        outputValue = SimulationRunner::elementCurrent(solver, graph.findElement(out.name), op, op,
+                                                       SimulationRunner::DC_TIMESTEP);
+    }
+
+    // The Newton loop left J factored at the converged point: one transposed solve
+    lambda = solver.solveTransposed(c);
+    return true;
+}
+
+double SensitivityAnalysis::derivative(const Element* e, const OutputVariable& out) {
+    auto lam = [&](int r) { return r == -1 ? 0.0 : lambda(r); };
+    const int r1 = row(e->node1), r2 = row(e->node2);
+    const int k = e->introducesExtraVariable ? solver.getExtraVariableStartIndex() + e->extraVariableIndex : -1;
+    const double v12 = rowValue(op, e->node1) - rowValue(op, e->node2);
+
+    auto controlCurrent = [&](const std::string& name) {
+        const Element* ctrl = graph.findElement(name);
+        if (!ctrl || !ctrl->introducesExtraVariable) return 0.0;
+        return op(solver.getExtraVariableStartIndex() + ctrl->extraVariableIndex);
+    };
+
+    // -lambda^T dF/dp, with F = A(p) x - b(p) as stamped in Elements.cpp
+    double d;
+    switch (e->type) {
+        case RESISTOR:
+            d = (lam(r1) - lam(r2)) * v12 / (e->value * e->value);
+            break;
+        case VOLTAGE_SOURCE:
+            d = lam(k);
+            break;
+        case CURRENT_SOURCE:
+            d = -(lam(r1) - lam(r2));
+            break;
+        case VCCS: {
+            auto* g = static_cast<const vccs*>(e);
+            d = -(lam(r1) - lam(r2)) * (rowValue(op, g->controlNode1()) - rowValue(op, g->controlNode2()));
+            break;
+        }
+        case VCVS: {
+            auto* g = static_cast<const vcvs*>(e);
+            d = lam(k) * (rowValue(op, g->controlNode1()) - rowValue(op, g->controlNode2()));
+            break;
+        }
+        case CCCS:
+            d = -(lam(r1) - lam(r2)) * controlCurrent(static_cast<const cccs*>(e)->controlName());
+            break;
+        case CCVS:
+            d = lam(k) * controlCurrent(static_cast<const ccvs*>(e)->controlName());
+            break;
+        default:
+            // C and L drop out at DC; diodes and time-dependent sources have no DC `value`
+            return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // I(R1) w.r.t. R1 also depends on R1 directly, not only through x
+    if (out.type == OutputVariable::CURRENT && out.name == e->name && !e->introducesExtraVariable) {
+        auto* self = const_cast<Element*>(e);
+        const double p = self->value;
+        const double dp = (p != 0.0) ? std::abs(p) * 1e-6 : 1e-9;
+        self->value = p + dp;
+        double hi = SimulationRunner::elementCurrent(solver, self, op, op, SimulationRunner::DC_TIMESTEP);
+        self->value = p;
+        double lo = SimulationRunner::elementCurrent(solver, self, op, op, SimulationRunner::DC_TIMESTEP);
+        d += (hi - lo) / dp;
+    }
+    return d;
+}
+
+bool SensitivityAnalysis::run(const OutputVariable& out, SensitivityResult& result) {
+    if (!prepare(out)) return false;
+
+    result = SensitivityResult{};
+    result.output = (out.type == OutputVariable::VOLTAGE ? "V(" : "I(") + out.name + ")";
+    result.outputValue = outputValue;
+    for (const Element* e : graph.getElements()) {
+        double d = derivative(e, out);
+        if (std::isnan(d)) continue;
+        result.entries.push_back({e->name, e->value, d});
+    }
+    std::sort(result.entries.begin(), result.entries.end(), [](const SensitivityEntry& a, const SensitivityEntry& b) {
+        return std::abs(a.value * a.derivative) > std::abs(b.value * b.derivative);
+    });
+    return true;
+}
+
+bool SensitivityAnalysis::transferFunction(const OutputVariable& out, const std::string& inputSource,
+                                           TransferFunctionResult& result) {
+    Element* in = graph.findElement(inputSource);
+    if (!in || (in->type != VOLTAGE_SOURCE && in->type != CURRENT_SOURCE)) {
+        std::cerr << "Error: '" << inputSource << "' is not a DC voltage or current source." << std::endl;
+        return false;
+    }
+    if (!prepare(out)) return false;
+
+    result = TransferFunctionResult{};
+    result.output = (out.type == OutputVariable::VOLTAGE ? "V(" : "I(") + out.name + ")";
+    result.input = inputSource;
+    result.gain = derivative(in, out);
+
+    // Input resistance needs dx/d(input): one forward solve with the same factorization
+    const int n = solver.getTotalUnknowns();
+    Eigen::VectorXd dF = Eigen::VectorXd::Zero(n);
+    if (in->type == VOLTAGE_SOURCE) {
+        int k = solver.getExtraVariableStartIndex() + in->extraVariableIndex;
+        dF(k) = -1.0;
+        Eigen::VectorXd dx = solver.solveWith(-dF);
+        // The branch unknown is the current entering node1 through the source
+        result.inputResistance = (dx(k) != 0.0) ? -1.0 / dx(k) : std::numeric_limits<double>::infinity();
+    } else {
+        int r1 = row(in->node1), r2 = row(in->node2);
+        if (r1 != -1) dF(r1) += 1.0;
+        if (r2 != -1) dF(r2) -= 1.0;
+        Eigen::VectorXd dx = solver.solveWith(-dF);
+        // The source pushes its current out of node2 into the circuit
+        result.inputResistance = rowValue(dx, in->node2) - rowValue(dx, in->node1);
+    }
+
+    // (J^-1)_oo = (J^-T)_oo: the adjoint solution already holds the output resistance
+    if (out.type == OutputVariable::VOLTAGE) {
+        int o = -1;
+        SimulationRunner::voltageRow(graph, solver, nm, out.name, o);
+        result.outputResistance = (o == -1) ? 0.0 : lambda(o);
+        result.hasOutputResistance = true;
+    }
+    return true;
+}
+
+void SensitivityResult::print() const {
+    std::cout << "DC sensitivity of " << output << " = " << outputValue << std::endl;
+    std::cout << std::left << std::setw(15) << "Element" << std::setw(16) << "Value"
+              << std::setw(16) << "d/dValue" << std::setw(16) << "per 1%" << std::endl;
+    for (const auto& e : entries) {
+        std::cout << std::left << std::scientific << std::setprecision(6)
+                  << std::setw(15) << e.element << std::setw(16) << e.value
+                  << std::setw(16) << e.derivative << std::setw(16) << e.value * e.derivative / 100.0 << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+void TransferFunctionResult::print() const {
+    std::cout << "Transfer function " << output << "/" << input << " = " << gain << std::endl;
+    std::cout << "Input resistance at " << input << " = " << inputResistance << std::endl;
+    if (hasOutputResistance) std::cout << "Output resistance at " << output << " = " << outputResistance << std::endl;
+}
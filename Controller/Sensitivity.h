@@ -0,0 +1,66 @@
+#ifndef MORGHSPICY_SENSITIVITY_H
+#define MORGHSPICY_SENSITIVITY_H
+
+#pragma once
+#include <string>
+#include <vector>
+#include "Controller/SimulationRunner.h"
+
+class Graph;
+class MNASolver;
+class NodeManager;
+
+struct SensitivityEntry {
+    std::string element;
+    double value = 0.0;       // parameter (element value)
+    double derivative = 0.0;  // d(output)/d(value)
+};
+
+struct SensitivityResult {
+    std::string output;       // "V(out)"
+    double outputValue = 0.0; // at the operating point
+    std::vector<SensitivityEntry> entries; // sorted by |value * derivative|, largest first
+
+    void print() const;
+};
+
+// .tf: small-signal DC gain from one independent source to an output
+struct TransferFunctionResult {
+    std::string output, input;
+    double gain = 0.0;        // d(output)/d(input)
+    double inputResistance = 0.0;
+    double outputResistance = 0.0;
+    bool   hasOutputResistance = false; // only for voltage outputs
+
+    void print() const;
+};
+
+// Adjoint DC sensitivities. After one Newton operating point the Jacobian J is already
+// factored; one transposed solve J^T lambda = c (c = output functional) gives
+//   d(output)/dp = explicit term - lambda^T dF/dp
+// for every element value p, where dF/dp is a handful of entries per element.
+class SensitivityAnalysis {
+public:
+    SensitivityAnalysis(Graph& g, MNASolver& solver, NodeManager& nm);
+
+    bool run(const OutputVariable& out, SensitivityResult& result);
+    bool transferFunction(const OutputVariable& out, const std::string& inputSource, TransferFunctionResult& result);
+
+private:
+    Graph& graph;
+    MNASolver& solver;
+    NodeManager& nm;
+
+    Eigen::VectorXd op;
+    Eigen::VectorXd c;       // d(output)/dx at op
+    Eigen::VectorXd lambda;  // J^-T c
+    double outputValue = 0.0;
+
+    bool prepare(const OutputVariable& out);
+    double rowValue(const Eigen::VectorXd& v, int node) const; // 0 for ground
+    int row(int node) const;
+    // -lambda^T dF/dp plus the explicit dependence of the output on p
+    double derivative(const Element* e, const OutputVariable& out);
+};
+
+#endif //MORGHSPICY_SENSITIVITY_H
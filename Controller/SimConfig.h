@@ -7,6 +7,7 @@
 
 
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -23,9 +24,10 @@ struct ACSweepConfig {
     SweepType type  = SweepType::Decade;  // Octave/Decade/Linear
     double w_start  = 2.0 * 3.141592653589793 * 1.0;   // rad/s
     double w_stop   = 2.0 * 3.141592653589793 * 1e3;   // rad/s
-    int    N        = 101;   // number of points (inclusive)
+    int    N        = 101;   // points per decade/octave, or total points (inclusive) for Linear
     bool   out_in_dB   = true;   // |H| in dB
     bool   phase_in_deg = true;
+    unsigned workers = 0;        // 0 => every hardware thread
 };
 
 struct PhaseSweepConfig {
@@ -36,11 +38,64 @@ struct PhaseSweepConfig {
     std::string source_name = "V1"; // which source’s phase to sweep
 };
 
-// What to plot
-enum class OutputKind { Voltage, Current };
-struct OutputVariable {
-    OutputKind kind;
-    std::string id; // "N2" for V, "R1" for I(element)
+// Periodic steady state by shooting: find x(0) with x(T) = x(0), T = 1/f0
+struct PSSConfig {
+    double f0         = 60.0;   // Hz; every time-dependent source must repeat within 1/f0
+    int    steps      = 200;    // backward-Euler steps per period
+    int    warmup     = 2;      // plain transient periods before shooting starts
+    double tol        = 1e-6;   // |x(T) - x(0)| <= tol * (1 + |x(0)|)
+    int    max_newton = 20;
+    int    max_krylov = 60;     // period simulations per Newton step
+};
+
+// Harmonic balance: every unknown is K harmonics of f0 (plus DC)
+struct HBConfig {
+    double f0         = 1e3;    // Hz; every source frequency must be a multiple of it
+    int    K          = 8;      // harmonics kept per unknown
+    double tol        = 1e-9;   // largest KCL/KVL residual accepted (A or V)
+    int    max_newton = 50;
+    int    max_krylov = 200;    // Jacobian products per Newton step
+};
+
+// Fourier analysis of a stored waveform: .four harmonics and windowed spectra
+enum class FFTWindow { Rectangular, Hann, Hamming, Blackman, FlatTop };
+
+struct FourierConfig {
+    double f0        = 0.0;     // Hz; fundamental for .four
+    int    harmonics = 9;       // .four: harmonics reported besides DC
+    int    periods   = 1;       // .four: whole periods analysed, ending at the last sample
+    double t_start   = -1.0;    // spectrum: start of the span (s); < 0 => whole record
+    std::size_t points = 0;     // uniform resampling points; 0 => automatic
+    FFTWindow window = FFTWindow::Hann;  // spectrum only; .four uses whole periods, no window
+    bool   out_in_dB = false;
+};
+
+// Monte Carlo tolerances: "R1 5%" or "R* 1% gauss"
+enum class ToleranceDistribution { Uniform, Gaussian };
+
+struct ToleranceSpec {
+    std::string pattern;           // element name, or a name prefix ending in '*'
+    double relative = 0.05;        // uniform: +/-relative, gaussian: relative = 3 sigma
+    ToleranceDistribution dist = ToleranceDistribution::Uniform;
+
+    bool matches(const std::string& elemName) const {
+        if (!pattern.empty() && pattern.back() == '*')
+            return elemName.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1) == 0;
+        return elemName == pattern;
+    }
+};
+
+enum class MCAnalysisKind { DC, Transient };
+
+struct MonteCarloConfig {
+    int            N       = 1000;      // number of samples
+    std::uint64_t  seed    = 1;         // sample i always draws from stream (seed, i)
+    unsigned       workers = 0;         // 0 => every hardware thread
+    int            bins    = 20;        // histogram bins per measure
+    int            pilot   = 200;       // samples used to pick histogram ranges
+    bool           batched = true;      // run lane-batched (SIMD) groups when the circuit allows it
+    MCAnalysisKind analysis = MCAnalysisKind::DC;
+    TransientConfig tran;               // used when analysis == Transient
 };
 
 
@@ -2,6 +2,13 @@
 #include "Model/MNASolver.h"
 #include "Model/NodeManager.h"
 #include "Model/Elements.h"
+#include "Model/Subcircuit.h"
+#include "Model/Topology.h"
+#include "Controller/MonteCarlo.h"
+#include "Controller/ACAnalysis.h"
+#include "Controller/Sensitivity.h"
+#include "Controller/PSSAnalysis.h"
+#include "Controller/HarmonicBalance.h"
 #include <iostream>
 #include <iomanip>
 #include <cmath>
@@ -12,12 +19,13 @@ const int MAX_NR_ITERATIONS = 100;
 const double NR_TOLERANCE = 1e-6;
 
 SimulationRunner::SimulationRunner(Graph* g, MNASolver* solver, NodeManager* n)
-        : graph(g), mnaSolver(solver), nm(n) {}
+        : graph(g), mnaSolver(solver), nm(n) {
+    // Singular-matrix diagnostics name nodes by their labels
+    if (mnaSolver && nm) mnaSolver->setNodeNamer([n](int id) { return n->nameOf(id); });
+}
 
 PlotData SimulationRunner::runTransient(double tstep_initial, double tstop, double tmaxstep, const std::vector<OutputVariable>& requested_vars) {
     PlotData plotData;
-    mnaSolver->initializeMatrix(*graph);
-
     graph->canonicalizeNodes(*nm);
 
     nm->displayNodes();
@@ -27,10 +35,12 @@ PlotData SimulationRunner::runTransient(double tstep_initial, double tstop, doub
     }
 
 
-    mnaSolver->initializeMatrix(*graph);
+    mnaSolver->initializeMatrix(*graph, true);
 
     // Initial sanity checks
-    if (mnaSolver->getTotalUnknowns() == 0 || !graph->isConnected()) {
+    const TopologyReport topology = checkTopology(*graph);
+    if (mnaSolver->getTotalUnknowns() == 0 || !topology.dcSolvable()) {
+        topology.print(*graph, std::cerr);
         std::cerr << "[WARN] Pre-check failed; attempting transient-only with gmin.\n";
         // DO NOT return; let the code proceed to build the transient MNA and step
     }
@@ -43,8 +53,16 @@ PlotData SimulationRunner::runTransient(double tstep_initial, double tstop, doub
         plotData.series_names.push_back((var.type == OutputVariable::VOLTAGE ? "V(" : "I(") + var.name + ")");
         plotData.data_series.emplace_back();
 
+        int local = -1;
         if (var.type == OutputVariable::VOLTAGE) {
-            int node_id = nm->resolveId(var.name);
+            if (const Subcircuit* sub = findInternalNode(*graph, var.name, local)) {
+                value_getters.push_back([this, sub, local](const Eigen::VectorXd& sol, const Eigen::VectorXd&, double) {
+                    return sub->internalVoltage(local, sol, mnaSolver->getNodeToMatrixIdxMap(),
+                                                mnaSolver->getExtraVariableStartIndex());
+                });
+                continue;
+            }
+            int node_id = nm->findId(var.name);
             if (node_id != -1 && mnaSolver->getNodeToMatrixIdxMap().count(node_id)) {
                 int matrix_idx = mnaSolver->getNodeToMatrixIdxMap().at(node_id);
                 value_getters.push_back([matrix_idx](const Eigen::VectorXd& sol, const Eigen::VectorXd&, double) {
@@ -77,6 +95,8 @@ PlotData SimulationRunner::runTransient(double tstep_initial, double tstop, doub
 
     double time = 0.0;
     double h = tstep_initial;
+    if (h > tmaxstep) { h = tmaxstep; }
+    const double nominal_h = h;
 
     // Store initial conditions at t=0
     plotData.time_axis.push_back(time);
@@ -85,9 +105,13 @@ PlotData SimulationRunner::runTransient(double tstep_initial, double tstop, doub
     }
 
     // --- Main simulation loop ---
-    while (time < tstop) {
+    // Accumulated rounding can leave a sliver before tstop; a step that small makes L/h blow up
+    while (tstop - time > 1e-9 * tstep_initial) {
+        h = nominal_h;
         if (time + h > tstop) { h = tstop - time; }
-        if (h > tmaxstep) { h = tmaxstep; }
+        // Steps end on breakpoints (samples of file sources) instead of stepping across them
+        const double breakpoint = graph->nextBreakpoint(time);
+        if (time + h > breakpoint) { h = breakpoint - time; }
 
         // Update time-dependent sources
         graph->updateTimeDependentSources(time + h);
@@ -117,17 +141,17 @@ PlotData SimulationRunner::runTransient(double tstep_initial, double tstop, doub
     return plotData;
 }
 void SimulationRunner::runDCSweep(const std::string& sourceName, double start, double stop, double increment, const std::vector<OutputVariable>& requested_vars) {
-    mnaSolver->initializeMatrix(*graph);
-
     graph->canonicalizeNodes(*nm);
-    mnaSolver->initializeMatrix(*graph);
+    mnaSolver->initializeMatrix(*graph, true);
 
 
     if (mnaSolver->getTotalUnknowns() == 0) {
         std::cerr << "Error: Simulation cannot run, the circuit is not correctly defined." << std::endl;
         return;
     }
-    if (!graph->isConnected()) {
+    const TopologyReport topology = checkTopology(*graph);
+    topology.print(*graph, std::cerr);
+    if (!topology.dcSolvable()) {
         std::cerr << "Error: Circuit is disconnected or contains floating nodes." << std::endl;
         return;
     }
@@ -149,28 +173,13 @@ void SimulationRunner::runDCSweep(const std::string& sourceName, double start, d
 
     Eigen::VectorXd current_guess(mnaSolver->getTotalUnknowns());
     current_guess.setZero();
-    double large_timestep_for_dc = 1e12; // To simulate DC conditions
+    double large_timestep_for_dc = DC_TIMESTEP; // To simulate DC conditions
 
     // Main DC sweep loop
     for (double current_val = start; current_val <= stop; current_val += increment) {
         swept_element->setValue(current_val);
-        Eigen::VectorXd final_solution;
-        bool converged = false;
-
-        // Newton-Raphson inner loop for each sweep step
-        for (int nr_iter = 0; nr_iter < MAX_NR_ITERATIONS; ++nr_iter) {
-            mnaSolver->constructMNAMatrix(*graph, large_timestep_for_dc, current_guess);
-            final_solution = mnaSolver->solve();
-
-            if (final_solution.size() == 0) break; // Solver failed
-
-            Eigen::VectorXd diff = final_solution - current_guess;
-            if (diff.norm() < NR_TOLERANCE) {
-                converged = true;
-                break;
-            }
-            current_guess = final_solution;
-        }
+        bool converged = solveOperatingPoint(*graph, *mnaSolver, current_guess);
+        Eigen::VectorXd final_solution = current_guess;
 
         if (!converged) {
             std::cerr << "Warning: Newton-Raphson failed to converge for " << sourceName << " = " << current_val << "." << std::endl;
@@ -181,9 +190,15 @@ void SimulationRunner::runDCSweep(const std::string& sourceName, double start, d
         std::cout << std::setw(15) << current_val;
         for (const auto& var : requested_vars) {
             double result = 0.0;
+            int local = -1;
             if (var.type == OutputVariable::VOLTAGE) {
-                int node_id = -1;
-                for(const auto& node : graph->getNodes()){ if(node->getName() == var.name){ node_id = node->getId(); break; } }
+                if (const Subcircuit* sub = findInternalNode(*graph, var.name, local)) {
+                    result = sub->internalVoltage(local, final_solution, mnaSolver->getNodeToMatrixIdxMap(),
+                                                  mnaSolver->getExtraVariableStartIndex());
+                    std::cout << std::setw(15) << result;
+                    continue;
+                }
+                int node_id = nm->findId(var.name);
                 if (node_id != -1 && mnaSolver->getNodeToMatrixIdxMap().count(node_id)) {
                     result = final_solution(mnaSolver->getNodeToMatrixIdxMap().at(node_id));
                 }
@@ -201,16 +216,115 @@ void SimulationRunner::runDCSweep(const std::string& sourceName, double start, d
     }
 }
 
+bool SimulationRunner::solveOperatingPoint(Graph& g, MNASolver& solver, Eigen::VectorXd& guess) {
+    for (int nr_iter = 0; nr_iter < MAX_NR_ITERATIONS; ++nr_iter) {
+        solver.constructMNAMatrix(g, DC_TIMESTEP, guess);
+        Eigen::VectorXd next = solver.solve();
+        if (!solver.lastSolveSucceeded()) return false;
+
+        double step = (next - guess).norm();
+        guess = next;
+        if (step < NR_TOLERANCE) return true;
+    }
+    return false;
+}
+
+void SimulationRunner::setTolerance(const ToleranceSpec& spec) {
+    for (auto& t : tolerances) {
+        if (t.pattern == spec.pattern) { t = spec; return; }
+    }
+    tolerances.push_back(spec);
+}
+
+PlotData SimulationRunner::runAC(const ACSweepConfig& cfg, const std::vector<OutputVariable>& vars) {
+    ACAnalysis ac(*graph, *mnaSolver, *nm);
+    return ac.run(cfg, vars);
+}
+
+PlotData SimulationRunner::runPhaseSweep(const PhaseSweepConfig& cfg, const std::vector<OutputVariable>& vars) {
+    ACAnalysis ac(*graph, *mnaSolver, *nm);
+    return ac.runPhaseSweep(cfg, vars);
+}
+
+PlotData SimulationRunner::runPSS(const PSSConfig& cfg, const std::vector<OutputVariable>& vars) {
+    PSSAnalysis pss(*graph, *mnaSolver, *nm);
+    PlotData pd = pss.run(cfg, vars);
+    if (!pd.time_axis.empty()) {
+        std::cout << "PSS converged: " << pss.newtonSteps() << " Newton step(s), "
+                  << pss.periodsSimulated() << " period simulations" << std::endl;
+    }
+    return pd;
+}
+
+bool SimulationRunner::runHarmonicBalance(const HBConfig& cfg, const std::vector<OutputVariable>& vars,
+                                          HBResult& result) {
+    HarmonicBalance hb(*graph, *mnaSolver, *nm);
+    return hb.run(cfg, vars, result);
+}
+
+bool SimulationRunner::runSensitivity(const OutputVariable& out, SensitivityResult& result) {
+    SensitivityAnalysis sens(*graph, *mnaSolver, *nm);
+    return sens.run(out, result);
+}
+
+bool SimulationRunner::runTransferFunction(const OutputVariable& out, const std::string& inputSource,
+                                           TransferFunctionResult& result) {
+    SensitivityAnalysis sens(*graph, *mnaSolver, *nm);
+    return sens.transferFunction(out, inputSource, result);
+}
+
+MonteCarloResult SimulationRunner::runMonteCarlo(const MonteCarloConfig& cfg,
+                                                 const std::vector<MCMeasure>& measures) {
+    graph->canonicalizeNodes(*nm);
+    MonteCarloAnalysis mc(*graph, *nm, tolerances);
+    return mc.run(cfg, measures);
+}
+
+const Subcircuit* SimulationRunner::findInternalNode(const Graph& g, const std::string& name, int& local) {
+    const size_t dot = name.find('.');
+    if (dot == std::string::npos) return nullptr;
+    const Element* e = g.findElement(name.substr(0, dot));
+    if (!e || e->type != SUBCIRCUIT) return nullptr;
+    const auto* sub = static_cast<const Subcircuit*>(e);
+    local = sub->def->internalNode(std::string_view(name).substr(dot + 1));
+    return local == -1 ? nullptr : sub;
+}
+
+bool SimulationRunner::voltageRow(const Graph& g, const MNASolver& solver, const NodeManager& nm,
+                                  const std::string& name, int& row) {
+    row = -1;
+    int local = -1;
+    if (const Subcircuit* sub = findInternalNode(g, name, local)) {
+        if (sub->condensed) return false;
+        // Internal nodes come first among the instance's unknowns
+        row = solver.getExtraVariableStartIndex() + sub->extraVariableIndex + (local - 1 - SubcircuitDef::PORTS);
+        return true;
+    }
+    int node_id = nm.findId(name);
+    if (node_id == 0) return true;
+    if (node_id < 0) return false;
+    auto it = solver.getNodeToMatrixIdxMap().find(node_id);
+    if (it == solver.getNodeToMatrixIdxMap().end()) return false;
+    row = it->second;
+    return true;
+}
+
 // This helper function calculates element currents based on the final solution
 double SimulationRunner::calculate_element_current(Element* elem, const Eigen::VectorXd& solution_vector, const Eigen::VectorXd& prev_solution, double h) {
+    return elementCurrent(*mnaSolver, elem, solution_vector, prev_solution, h);
+}
+
+double SimulationRunner::elementCurrent(const MNASolver& solver, const Element* elem,
+                                        const Eigen::VectorXd& solution_vector,
+                                        const Eigen::VectorXd& prev_solution, double h) {
     if (!elem) return 0.0;
 
     if (elem->introducesExtraVariable) {
-        int extra_var_idx = mnaSolver->getExtraVariableStartIndex() + elem->extraVariableIndex;
+        int extra_var_idx = solver.getExtraVariableStartIndex() + elem->extraVariableIndex;
         return solution_vector(extra_var_idx);
     }
 
-    const auto& node_map = mnaSolver->getNodeToMatrixIdxMap();
+    const auto& node_map = solver.getNodeToMatrixIdxMap();
     int n1_id = elem->node1;
     int n2_id = elem->node2;
 
@@ -230,10 +344,13 @@ double SimulationRunner::calculate_element_current(Element* elem, const Eigen::V
             return elem->value;
         case DIODE: {
             // For a diode, we re-calculate the current using the final converged voltage
-            auto* diode = static_cast<Diode*>(elem);
+            auto* diode = static_cast<const Diode*>(elem);
             double vd = v1 - v2;
             if (diode->model == "Z" && vd < -diode->Vz) {
                 return (vd - (-diode->Vz)) / 1.0; // Current in Zener breakdown
+            } else if (diode->table) {
+                double g;
+                return diode->table->current(vd, g); // the curve the fast model solved with
             } else {
                 return diode->Is * (std::exp(vd / (diode->n * diode->Vt)) - 1.0);
             }
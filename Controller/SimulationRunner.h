@@ -10,6 +10,7 @@
 #include "Model/Graph.h"
 #include "Model/MNASolver.h"
 #include "Model/NodeManager.h"
+#include "Controller/SimConfig.h"
 #include <string>
 #include <vector>
 #include <Eigen/Dense>
@@ -23,18 +24,31 @@ struct OutputVariable {
     std::string name;   // node label or element name
 };
 
+// What PlotData::time_axis holds
+enum class PlotAxis { Time, Frequency, Phase };
+
 struct PlotData {
-    std::vector<double>              time_axis;    // t
+    PlotAxis                         axis = PlotAxis::Time;
+    std::vector<double>              time_axis;    // t (s), f (Hz) or phase (deg), see axis
     std::vector<std::vector<double>> data_series;  // one vector per requested variable
     std::vector<std::string>         series_names; // "V(n1)", "I(R1)", ...
 };
 
+class Subcircuit;
+struct MCMeasure;
+struct MonteCarloResult;
+struct SensitivityResult;
+struct TransferFunctionResult;
+struct HBResult;
+
 class SimulationRunner {
 private:
     Graph*       graph{};
     MNASolver*   mnaSolver{};
     NodeManager* nm{};     // keep this name: .cpp mostly uses nm
 
+    std::vector<ToleranceSpec> tolerances; // consumed by runMonteCarlo
+
     double calculate_element_current(
             Element* elem,
             const Eigen::VectorXd& solution_vector,
@@ -43,14 +57,60 @@ private:
     );
 
 public:
+    // Timestep used for DC analyses: capacitors open, inductors short
+    static constexpr double DC_TIMESTEP = 1e12;
+
     SimulationRunner(Graph* g, MNASolver* s, NodeManager* n);
 
+    // Diagonal the solver adds to every node row
+    double getGmin() const { return mnaSolver->getGmin(); }
+
     PlotData runTransient(double t0, double tstop, double h,
                           const std::vector<OutputVariable>& vars);
 
     void runDCSweep(const std::string& elemName,
                     double start, double stop, double step,
                     const std::vector<OutputVariable>& vars);
+
+    // Small-signal sweep around the DC operating point (see ACAnalysis.h)
+    PlotData runAC(const ACSweepConfig& cfg, const std::vector<OutputVariable>& vars);
+    PlotData runPhaseSweep(const PhaseSweepConfig& cfg, const std::vector<OutputVariable>& vars);
+
+    // Periodic steady state by shooting Newton (see PSSAnalysis.h); one period from t = 0
+    PlotData runPSS(const PSSConfig& cfg, const std::vector<OutputVariable>& vars);
+
+    // Multi-tone sinusoidal steady state as per-harmonic phasors (see HarmonicBalance.h)
+    bool runHarmonicBalance(const HBConfig& cfg, const std::vector<OutputVariable>& vars, HBResult& result);
+
+    // Adjoint DC sensitivity of one output to every element value (see Sensitivity.h)
+    bool runSensitivity(const OutputVariable& out, SensitivityResult& result);
+    // .tf: DC small-signal gain from inputSource to out, plus input/output resistance
+    bool runTransferFunction(const OutputVariable& out, const std::string& inputSource,
+                             TransferFunctionResult& result);
+
+    // Monte Carlo over the tolerances registered with setTolerance (see MonteCarlo.h)
+    MonteCarloResult runMonteCarlo(const MonteCarloConfig& cfg,
+                                   const std::vector<MCMeasure>& measures);
+
+    // A later spec for the same pattern replaces the earlier one
+    void setTolerance(const ToleranceSpec& spec);
+    void clearTolerances() { tolerances.clear(); }
+    const std::vector<ToleranceSpec>& getTolerances() const { return tolerances; }
+
+    // Newton-Raphson DC operating point; guess holds the result on return.
+    // Works on any graph/solver pair so parallel analyses can call it on private copies.
+    static bool solveOperatingPoint(Graph& g, MNASolver& solver, Eigen::VectorXd& guess);
+
+    static double elementCurrent(const MNASolver& solver, const Element* elem,
+                                 const Eigen::VectorXd& solution_vector,
+                                 const Eigen::VectorXd& prev_solution, double h);
+
+    // "X1.mid": internal node `local` of subcircuit instance X1, nullptr if the name is not one
+    static const Subcircuit* findInternalNode(const Graph& g, const std::string& name, int& local);
+    // Solution row of the voltage `name` ("out", "3" or "X1.mid"), -1 for ground. False if the
+    // circuit has no such node, or it is inside a condensed instance (not in the solution).
+    static bool voltageRow(const Graph& g, const MNASolver& solver, const NodeManager& nm,
+                           const std::string& name, int& row);
 };
 
 
@@ -0,0 +1,51 @@
+#include "Statistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+void RunningStats::add(double x) {
+    ++n;
+    double delta = x - mu;
+    mu += delta / static_cast<double>(n);
+    m2 += delta * (x - mu);
+    lo = std::min(lo, x);
+    hi = std::max(hi, x);
+}
+
+void RunningStats::merge(const RunningStats& other) {
+    if (other.n == 0) return;
+    if (n == 0) { *this = other; return; }
+
+    // Chan et al. pairwise combination
+    double na = static_cast<double>(n), nb = static_cast<double>(other.n);
+    double delta = other.mu - mu;
+    double total = na + nb;
+    mu += delta * nb / total;
+    m2 += other.m2 + delta * delta * na * nb / total;
+    n  += other.n;
+    lo = std::min(lo, other.lo);
+    hi = std::max(hi, other.hi);
+}
+
+double RunningStats::stddev() const { return std::sqrt(variance()); }
+
+Histogram::Histogram(double lo_, double hi_, int bins)
+        : lo(lo_), hi(hi_), counts(static_cast<size_t>(std::max(bins, 1)), 0) {
+    if (!(hi > lo)) hi = lo + 1.0;
+}
+
+void Histogram::add(double x) {
+    if (counts.empty()) return;
+    if (x < lo) { ++under; return; }
+    if (x > hi) { ++over; return; }
+    auto bin = static_cast<size_t>((x - lo) / (hi - lo) * static_cast<double>(counts.size()));
+    if (bin >= counts.size()) bin = counts.size() - 1; // x == hi lands in the last bin
+    ++counts[bin];
+}
+
+void Histogram::merge(const Histogram& other) {
+    if (counts.empty()) { *this = other; return; }
+    for (size_t i = 0; i < counts.size() && i < other.counts.size(); ++i) counts[i] += other.counts[i];
+    under += other.under;
+    over  += other.over;
+}
@@ -0,0 +1,54 @@
+#ifndef MORGHSPICY_STATISTICS_H
+#define MORGHSPICY_STATISTICS_H
+
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Streaming mean / variance / extrema (Welford). Two partial results can be merged,
+// so every worker accumulates privately and the totals are combined at the end.
+class RunningStats {
+public:
+    void add(double x);
+    void merge(const RunningStats& other);
+
+    std::uint64_t count() const { return n; }
+    double mean() const { return n ? mu : 0.0; }
+    double variance() const { return n > 1 ? m2 / static_cast<double>(n - 1) : 0.0; }
+    double stddev() const;
+    double min() const { return lo; }
+    double max() const { return hi; }
+
+private:
+    std::uint64_t n = 0;
+    double mu = 0.0;
+    double m2 = 0.0;
+    double lo = std::numeric_limits<double>::infinity();
+    double hi = -std::numeric_limits<double>::infinity();
+};
+
+// Fixed-range histogram with explicit under/overflow counters; memory is O(bins)
+// no matter how many samples are added.
+class Histogram {
+public:
+    Histogram() = default;
+    Histogram(double lo, double hi, int bins);
+
+    void add(double x);
+    void merge(const Histogram& other); // both sides must share the same range and bin count
+
+    double lower() const { return lo; }
+    double upper() const { return hi; }
+    int bins() const { return static_cast<int>(counts.size()); }
+    const std::vector<std::uint64_t>& binCounts() const { return counts; }
+    std::uint64_t underflow() const { return under; }
+    std::uint64_t overflow() const { return over; }
+
+private:
+    double lo = 0.0, hi = 1.0;
+    std::vector<std::uint64_t> counts;
+    std::uint64_t under = 0, over = 0;
+};
+
+#endif //MORGHSPICY_STATISTICS_H
@@ -0,0 +1,75 @@
+#include "SubcircuitLibrary.h"
+#include "NetlistLoader.h"
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    // "ports <a> <b>" on the first line, then "add <name> <n1> <n2> <value|model>" per element
+    std::shared_ptr<SubcircuitDef> parseDefinition(const std::string& name, std::ifstream& in, std::string& error) {
+        std::string line, keyword, port1, port2;
+        std::getline(in, line);
+        std::istringstream port_iss(line);
+        if (!(port_iss >> keyword >> port1 >> port2) || keyword != "ports") {
+            error = "Invalid subcircuit file. First line must be 'ports <name1> <name2>'.";
+            return nullptr;
+        }
+
+        auto def = std::make_shared<SubcircuitDef>();
+        def->name = name;
+        def->nodeNames = {port1, port2};
+        std::unordered_map<std::string, int> local{{port1, 1}, {port2, 2}};
+        auto localId = [&](const std::string& node) {
+            auto [it, fresh] = local.try_emplace(node, static_cast<int>(def->nodeNames.size()) + 1);
+            if (fresh) def->nodeNames.push_back(node);
+            return it->second;
+        };
+
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+
+            std::istringstream elem_iss(line);
+            std::string add_cmd, elem_name, n1_str, n2_str, val_str_or_model;
+            if (!(elem_iss >> add_cmd >> elem_name >> n1_str >> n2_str >> val_str_or_model)) continue;
+
+            double value;
+            if (!parseEngineeringValue(val_str_or_model, value)) value = -1e99;
+
+            std::unique_ptr<Element> e;
+            char type = static_cast<char>(std::toupper(static_cast<unsigned char>(elem_name[0])));
+            switch (type) {
+                case 'R': e = std::make_unique<Resistor>(elem_name, 0, 0, value); break;
+                case 'C': e = std::make_unique<Capacitor>(elem_name, 0, 0, value); break;
+                case 'L': e = std::make_unique<Inductor>(elem_name, 0, 0, value); break;
+                case 'V': e = std::make_unique<VoltageSource>(elem_name, 0, 0, value); break;
+                case 'I': e = std::make_unique<CurrentSource>(elem_name, 0, 0, value); break;
+                case 'D': e = std::make_unique<Diode>(elem_name, 0, 0, val_str_or_model); break;
+                default:
+                    std::cerr << "Warning: Skipping unknown element type '" << type << "' inside subcircuit." << std::endl;
+                    continue;
+            }
+            e->node1 = localId(n1_str);
+            e->node2 = localId(n2_str);
+            def->addElement(std::move(e));
+        }
+        def->finish();
+        return def;
+    }
+}
+
+std::shared_ptr<const SubcircuitDef> SubcircuitLibrary::get(const std::string& name, std::string& error) {
+    auto it = defs.find(name);
+    if (it != defs.end()) return it->second;
+
+    std::string path = pathOf(name);
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error = "Cannot open subcircuit file: " + path;
+        return nullptr;
+    }
+    std::shared_ptr<const SubcircuitDef> def = parseDefinition(name, in, error);
+    if (def) defs.emplace(name, def);
+    return def;
+}
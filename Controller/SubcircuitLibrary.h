@@ -0,0 +1,26 @@
+#ifndef MORGHSPICY_SUBCIRCUITLIBRARY_H
+#define MORGHSPICY_SUBCIRCUITLIBRARY_H
+
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "Model/Subcircuit.h"
+
+// Parsed library/<name>.sub definitions by name, so a file is read once however many
+// instances use it
+class SubcircuitLibrary {
+public:
+    // nullptr (with `error` filled in) when the file is missing or malformed
+    std::shared_ptr<const SubcircuitDef> get(const std::string& name, std::string& error);
+
+    // Drop a cached definition whose file was rewritten
+    void forget(const std::string& name) { defs.erase(name); }
+
+    static std::string pathOf(const std::string& name) { return "library/" + name + ".sub"; }
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<const SubcircuitDef>> defs;
+};
+
+#endif //MORGHSPICY_SUBCIRCUITLIBRARY_H
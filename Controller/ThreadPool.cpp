@@ -0,0 +1,94 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    // One slice of the index range; padded so neighbouring workers don't share a cache line.
+    struct alignas(64) Slice {
+        std::mutex  m;
+        std::size_t begin = 0;
+        std::size_t end   = 0;
+    };
+
+    bool popFront(Slice& s, std::size_t& out) {
+        std::lock_guard<std::mutex> lock(s.m);
+        if (s.begin >= s.end) return false;
+        out = s.begin++;
+        return true;
+    }
+
+    // Move the upper half of victim's remaining work into thief.
+    bool stealHalf(Slice& victim, Slice& thief) {
+        std::size_t b, e;
+        {
+            std::lock_guard<std::mutex> lock(victim.m);
+            if (victim.begin >= victim.end) return false;
+            std::size_t take = (victim.end - victim.begin + 1) / 2;
+            e = victim.end;
+            b = e - take;
+            victim.end = b;
+        }
+        std::lock_guard<std::mutex> lock(thief.m);
+        thief.begin = b;
+        thief.end   = e;
+        return true;
+    }
+}
+
+unsigned defaultWorkerCount() {
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : hw;
+}
+
+void parallelFor(std::size_t n, unsigned workers,
+                 const std::function<void(std::size_t, unsigned)>& body) {
+    if (n == 0) return;
+    if (workers == 0) workers = defaultWorkerCount();
+    workers = static_cast<unsigned>(std::min<std::size_t>(workers, n));
+
+    if (workers == 1) {
+        for (std::size_t i = 0; i < n; ++i) body(i, 0);
+        return;
+    }
+
+    std::vector<Slice> slices(workers);
+    for (unsigned w = 0; w < workers; ++w) {
+        slices[w].begin = n * w / workers;
+        slices[w].end   = n * (w + 1) / workers;
+    }
+
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+
+    auto run = [&](unsigned self) {
+        std::size_t idx;
+        while (true) {
+            while (popFront(slices[self], idx)) {
+                try {
+                    body(idx, self);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!firstError) firstError = std::current_exception();
+                }
+            }
+            // Out of local work: scan the other workers once, take half of the first non-empty slice.
+            bool stole = false;
+            for (unsigned k = 1; k < workers && !stole; ++k) {
+                stole = stealHalf(slices[(self + k) % workers], slices[self]);
+            }
+            if (!stole) return;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned w = 1; w < workers; ++w) threads.emplace_back(run, w);
+    run(0);
+    for (auto& t : threads) t.join();
+
+    if (firstError) std::rethrow_exception(firstError);
+}
@@ -0,0 +1,20 @@
+#ifndef MORGHSPICY_THREADPOOL_H
+#define MORGHSPICY_THREADPOOL_H
+
+#pragma once
+#include <cstddef>
+#include <functional>
+
+// Number of workers used when a caller passes 0 (all hardware threads).
+unsigned defaultWorkerCount();
+
+// Runs body(index, worker) for every index in [0, n) on up to `workers` threads.
+// Each worker starts on its own contiguous slice of the range; when it runs dry it
+// steals the upper half of another worker's remaining slice, so uneven work
+// (e.g. Newton iterations that take longer for some samples) still keeps every core busy.
+// `worker` is stable for the lifetime of the call, so callers can keep per-thread scratch
+// state indexed by it. The first exception thrown by body is rethrown after all threads join.
+void parallelFor(std::size_t n, unsigned workers,
+                 const std::function<void(std::size_t index, unsigned worker)>& body);
+
+#endif //MORGHSPICY_THREADPOOL_H
@@ -0,0 +1,339 @@
+#include "BatchedSolver.h"
+#include "Graph.h"
+#include "MNASolver.h"
+#include "Elements.h"
+
+#include <cmath>
+
+// Same Newton settings as the scalar DC analysis in SimulationRunner
+const int    BATCH_MAX_NR_ITERATIONS = 100;
+const double BATCH_NR_TOLERANCE      = 1e-6;
+const double BATCH_DC_TIMESTEP       = 1e12;
+// A lane keeps the shared pivot only if it is at least this fraction of that lane's
+// own column maximum (threshold partial pivoting); otherwise the lane is split out.
+const double PIVOT_THRESHOLD = 1e-3;
+
+namespace {
+    constexpr int W = BatchedSolver::LANES;
+
+    int rowOf(int node_id, const std::map<int, int>& idx) {
+        if (node_id == 0) return -1;
+        auto it = idx.find(node_id);
+        return it == idx.end() ? -1 : it->second;
+    }
+}
+
+bool BatchedSolver::compile(Graph& g, const MNASolver& layout) {
+    n = layout.getTotalUnknowns();
+    numNodes = layout.getNumNonGroundNodes();
+    gmin = layout.getGmin();
+    const auto& idx = layout.getNodeToMatrixIdxMap();
+    const int extra = layout.getExtraVariableStartIndex();
+
+    elements = g.getElements();
+    nominal.clear();
+    resistors.clear(); capacitors.clear(); currentSources.clear();
+    inductors.clear(); voltageSources.clear(); timeSources.clear();
+    vccsList.clear(); vcvsList.clear(); cccsList.clear(); ccvsList.clear();
+    diodes.clear();
+
+    auto branchRow = [&](const std::string& name) {
+        for (Element* e : elements) {
+            if (e->name == name && e->introducesExtraVariable) return extra + e->extraVariableIndex;
+        }
+        return -1;
+    };
+
+    for (int i = 0; i < static_cast<int>(elements.size()); ++i) {
+        Element* e = elements[i];
+        nominal.push_back(e->value);
+        int r1 = rowOf(e->node1, idx), r2 = rowOf(e->node2, idx);
+        int k  = e->introducesExtraVariable ? extra + e->extraVariableIndex : -1;
+
+        switch (e->type) {
+            case RESISTOR:       resistors.push_back({i, r1, r2}); break;
+            case CAPACITOR:      capacitors.push_back({i, r1, r2}); break;
+            case CURRENT_SOURCE: currentSources.push_back({i, r1, r2}); break;
+            case INDUCTOR:       inductors.push_back({i, r1, r2, k}); break;
+            case VOLTAGE_SOURCE: voltageSources.push_back({i, r1, r2, k}); break;
+            case SINUSOIDAL_SOURCE:
+            case PULSE_SOURCE:   timeSources.push_back({i, r1, r2, k}); break;
+            case DIODE: {
+                auto* d = static_cast<Diode*>(e);
+                diodes.push_back({i, r1, r2, d->Is, d->n * d->Vt, d->Vz, d->model == "Z", d->table.get()});
+                break;
+            }
+            case VCCS: {
+                auto* s = static_cast<vccs*>(e);
+                vccsList.push_back({i, r1, r2, rowOf(s->controlNode1(), idx), rowOf(s->controlNode2(), idx), -1});
+                break;
+            }
+            case VCVS: {
+                auto* s = static_cast<vcvs*>(e);
+                vcvsList.push_back({i, r1, r2, rowOf(s->controlNode1(), idx), rowOf(s->controlNode2(), idx), k});
+                break;
+            }
+            case CCCS: cccsList.push_back({i, r1, r2, branchRow(static_cast<cccs*>(e)->controlName()), -1, -1}); break;
+            case CCVS: ccvsList.push_back({i, r1, r2, branchRow(static_cast<ccvs*>(e)->controlName()), -1, k}); break;
+            default: return false;
+        }
+    }
+
+    resetLaneValues();
+    A.assign(static_cast<size_t>(n) * n * W, 0.0);
+    b.assign(static_cast<size_t>(n) * W, 0.0);
+    return n > 0;
+}
+
+void BatchedSolver::resetLaneValues() {
+    values.resize(nominal.size() * W);
+    for (size_t e = 0; e < nominal.size(); ++e)
+        for (int l = 0; l < W; ++l) values[e * W + l] = nominal[e];
+}
+
+void BatchedSolver::extractLane(const std::vector<double>& x, int lane, Eigen::VectorXd& out) const {
+    out.resize(n);
+    for (int r = 0; r < n; ++r) out(r) = x[static_cast<size_t>(r) * W + lane];
+}
+
+void BatchedSolver::stamp(double h, const std::vector<double>& prev) {
+    std::fill(A.begin(), A.end(), 0.0);
+    std::fill(b.begin(), b.end(), 0.0);
+
+    auto a = [&](int r, int c) { return A.data() + (static_cast<size_t>(r) * n + c) * W; };
+    auto rhs = [&](int r) { return b.data() + static_cast<size_t>(r) * W; };
+    auto val = [&](int elem) { return values.data() + static_cast<size_t>(elem) * W; };
+    auto pv = [&](int r, int l) { return r < 0 ? 0.0 : prev[static_cast<size_t>(r) * W + l]; };
+
+    // Symmetric conductance pattern shared by R, C and the linearized diode
+    auto conductance = [&](int r1, int r2, const double* gv) {
+        if (r1 >= 0) { double* p = a(r1, r1); for (int l = 0; l < W; ++l) p[l] += gv[l]; }
+        if (r2 >= 0) { double* p = a(r2, r2); for (int l = 0; l < W; ++l) p[l] += gv[l]; }
+        if (r1 >= 0 && r2 >= 0) {
+            double* p = a(r1, r2); double* q = a(r2, r1);
+            for (int l = 0; l < W; ++l) { p[l] -= gv[l]; q[l] -= gv[l]; }
+        }
+    };
+    // Branch incidence of V-like elements: KCL columns and the branch equation row
+    auto incidence = [&](int r1, int r2, int k) {
+        if (r1 >= 0) { double* p = a(r1, k); double* q = a(k, r1); for (int l = 0; l < W; ++l) { p[l] += 1.0; q[l] += 1.0; } }
+        if (r2 >= 0) { double* p = a(r2, k); double* q = a(k, r2); for (int l = 0; l < W; ++l) { p[l] -= 1.0; q[l] -= 1.0; } }
+    };
+
+    alignas(64) double g[W];
+
+    for (const auto& e : resistors) {
+        const double* v = val(e.elem);
+        for (int l = 0; l < W; ++l) g[l] = v[l] > 0 ? 1.0 / v[l] : 0.0;
+        conductance(e.r1, e.r2, g);
+    }
+
+    for (const auto& e : capacitors) {
+        const double* v = val(e.elem);
+        for (int l = 0; l < W; ++l) g[l] = (v[l] > 0 && h > 0) ? v[l] / h : 0.0;
+        conductance(e.r1, e.r2, g);
+        for (int l = 0; l < W; ++l) {
+            double hist = g[l] * (pv(e.r1, l) - pv(e.r2, l));
+            if (e.r1 >= 0) rhs(e.r1)[l] += hist;
+            if (e.r2 >= 0) rhs(e.r2)[l] -= hist;
+        }
+    }
+
+    for (const auto& e : inductors) {
+        const double* v = val(e.elem);
+        incidence(e.r1, e.r2, e.k);
+        double* kk = a(e.k, e.k);
+        double* bk = rhs(e.k);
+        for (int l = 0; l < W; ++l) {
+            double z = (v[l] > 0 && h > 0) ? v[l] / h : 0.0;
+            kk[l] -= z;
+            bk[l] -= z * pv(e.k, l);
+        }
+    }
+
+    for (const auto& e : voltageSources) {
+        const double* v = val(e.elem);
+        incidence(e.r1, e.r2, e.k);
+        double* bk = rhs(e.k);
+        for (int l = 0; l < W; ++l) bk[l] += v[l];
+    }
+
+    for (const auto& e : timeSources) {
+        incidence(e.r1, e.r2, e.k);
+        Element* src = elements[e.elem];
+        double v = src->type == PULSE_SOURCE ? static_cast<PulseSource*>(src)->getInstantaneousValue()
+                                             : static_cast<SinusoidalSource*>(src)->getInstantaneousValue();
+        double* bk = rhs(e.k);
+        for (int l = 0; l < W; ++l) bk[l] += v;
+    }
+
+    for (const auto& e : currentSources) {
+        const double* v = val(e.elem);
+        if (e.r1 >= 0) { double* p = rhs(e.r1); for (int l = 0; l < W; ++l) p[l] -= v[l]; }
+        if (e.r2 >= 0) { double* p = rhs(e.r2); for (int l = 0; l < W; ++l) p[l] += v[l]; }
+    }
+
+    alignas(64) double ieq[W];
+    for (const auto& d : diodes) {
+        for (int l = 0; l < W; ++l) {
+            double vd = pv(d.r1, l) - pv(d.r2, l);
+            if (vd > 0.85) vd = 0.85; // same limiting as Diode::stampMNA
+            if (d.zener && vd < -d.Vz) {
+                g[l] = 1.0;
+                ieq[l] = d.Vz;
+            } else if (d.table) {
+                ieq[l] = d.table->current(vd, g[l]) - g[l] * vd;
+            } else {
+                double ex = std::exp(vd / d.nVt);
+                g[l] = d.Is / d.nVt * ex;
+                ieq[l] = d.Is * (ex - 1.0) - g[l] * vd;
+            }
+        }
+        conductance(d.r1, d.r2, g);
+        if (d.r1 >= 0) { double* p = rhs(d.r1); for (int l = 0; l < W; ++l) p[l] -= ieq[l]; }
+        if (d.r2 >= 0) { double* p = rhs(d.r2); for (int l = 0; l < W; ++l) p[l] += ieq[l]; }
+    }
+
+    auto addScaled = [&](int r, int c, const double* v, double sign) {
+        if (r < 0 || c < 0) return;
+        double* p = a(r, c);
+        for (int l = 0; l < W; ++l) p[l] += sign * v[l];
+    };
+
+    for (const auto& e : vccsList) {
+        const double* v = val(e.elem);
+        addScaled(e.r1, e.c1, v, 1.0);  addScaled(e.r1, e.c2, v, -1.0);
+        addScaled(e.r2, e.c1, v, -1.0); addScaled(e.r2, e.c2, v, 1.0);
+    }
+    for (const auto& e : vcvsList) {
+        const double* v = val(e.elem);
+        incidence(e.r1, e.r2, e.k);
+        addScaled(e.k, e.c1, v, -1.0); addScaled(e.k, e.c2, v, 1.0);
+    }
+    for (const auto& e : cccsList) {
+        if (e.c1 < 0) continue; // unresolved control, scalar stamp skips it too
+        const double* v = val(e.elem);
+        addScaled(e.r1, e.c1, v, 1.0); addScaled(e.r2, e.c1, v, -1.0);
+    }
+    for (const auto& e : ccvsList) {
+        if (e.c1 < 0) continue;
+        const double* v = val(e.elem);
+        incidence(e.r1, e.r2, e.k);
+        addScaled(e.k, e.c1, v, -1.0);
+    }
+
+    for (int i = 0; i < numNodes; ++i) {
+        double* p = a(i, i);
+        for (int l = 0; l < W; ++l) p[l] += gmin;
+    }
+}
+
+BatchedSolver::LaneMask BatchedSolver::factorAndSolve(std::vector<double>& x, LaneMask active) {
+    auto a = [&](int r, int c) { return A.data() + (static_cast<size_t>(r) * n + c) * W; };
+    auto rhs = [&](int r) { return b.data() + static_cast<size_t>(r) * W; };
+
+    std::vector<double> invPivot(static_cast<size_t>(n) * W, 0.0);
+    alignas(64) double f[W];
+
+    for (int k = 0; k < n && active; ++k) {
+        int ref = 0;
+        while (!(active & (1u << ref))) ++ref;
+
+        // Shared pivot order: partial pivoting on the reference lane
+        int p = k;
+        double best = std::abs(a(k, k)[ref]);
+        for (int i = k + 1; i < n; ++i) {
+            double m = std::abs(a(i, k)[ref]);
+            if (m > best) { best = m; p = i; }
+        }
+        if (p != k) {
+            std::swap_ranges(a(k, 0), a(k, 0) + static_cast<size_t>(n) * W, a(p, 0));
+            std::swap_ranges(rhs(k), rhs(k) + W, rhs(p));
+        }
+
+        // Every other lane must tolerate that pivot
+        for (int l = 0; l < W; ++l) {
+            if (!(active & (1u << l))) continue;
+            double colmax = 0.0;
+            for (int i = k; i < n; ++i) colmax = std::max(colmax, std::abs(a(i, k)[l]));
+            double piv = a(k, k)[l];
+            if (!(colmax > 0.0) || std::abs(piv) < PIVOT_THRESHOLD * colmax) active &= ~(1u << l);
+        }
+        double* pk = a(k, k);
+        double* inv = invPivot.data() + static_cast<size_t>(k) * W;
+        for (int l = 0; l < W; ++l) inv[l] = (active & (1u << l)) ? 1.0 / pk[l] : 0.0;
+
+        const double* rowK = a(k, 0);
+        const double* bK = rhs(k);
+        for (int i = k + 1; i < n; ++i) {
+            double* rowI = a(i, 0);
+            bool any = false;
+            for (int l = 0; l < W; ++l) { f[l] = rowI[static_cast<size_t>(k) * W + l] * inv[l]; any |= f[l] != 0.0; }
+            if (!any) continue; // MNA rows are sparse: most eliminations are no-ops
+            for (int j = k + 1; j < n; ++j) {
+                double* dst = rowI + static_cast<size_t>(j) * W;
+                const double* src = rowK + static_cast<size_t>(j) * W;
+                for (int l = 0; l < W; ++l) dst[l] -= f[l] * src[l];
+            }
+            double* bI = rhs(i);
+            for (int l = 0; l < W; ++l) bI[l] -= f[l] * bK[l];
+        }
+    }
+
+    x.assign(static_cast<size_t>(n) * W, 0.0);
+    alignas(64) double s[W];
+    for (int i = n - 1; i >= 0; --i) {
+        const double* rowI = a(i, 0);
+        for (int l = 0; l < W; ++l) s[l] = rhs(i)[l];
+        for (int j = i + 1; j < n; ++j) {
+            const double* aij = rowI + static_cast<size_t>(j) * W;
+            const double* xj = x.data() + static_cast<size_t>(j) * W;
+            for (int l = 0; l < W; ++l) s[l] -= aij[l] * xj[l];
+        }
+        double* xi = x.data() + static_cast<size_t>(i) * W;
+        const double* inv = invPivot.data() + static_cast<size_t>(i) * W;
+        for (int l = 0; l < W; ++l) xi[l] = s[l] * inv[l];
+    }
+
+    for (int l = 0; l < W; ++l) {
+        if (!(active & (1u << l))) continue;
+        for (int r = 0; r < n; ++r) {
+            if (!std::isfinite(x[static_cast<size_t>(r) * W + l])) { active &= ~(1u << l); break; }
+        }
+    }
+    return active;
+}
+
+BatchedSolver::LaneMask BatchedSolver::solveStep(double h, const std::vector<double>& prev,
+                                                 std::vector<double>& x, LaneMask active) {
+    stamp(h, prev);
+    return factorAndSolve(x, active);
+}
+
+BatchedSolver::LaneMask BatchedSolver::solveOperatingPoint(std::vector<double>& x, LaneMask active) {
+    x.resize(static_cast<size_t>(n) * W, 0.0);
+    std::vector<double> next;
+    LaneMask converged = 0;
+
+    for (int iter = 0; iter < BATCH_MAX_NR_ITERATIONS; ++iter) {
+        LaneMask running = active & ~converged;
+        if (!running) break;
+
+        stamp(BATCH_DC_TIMESTEP, x);
+        LaneMask ok = factorAndSolve(next, running);
+        active &= ok | converged; // lanes whose factorization failed leave the batch
+
+        for (int l = 0; l < W; ++l) {
+            if (!(active & ~converged & (1u << l))) continue;
+            double step = 0.0;
+            for (int r = 0; r < n; ++r) {
+                size_t i = static_cast<size_t>(r) * W + l;
+                double d = next[i] - x[i];
+                step += d * d;
+                x[i] = next[i];
+            }
+            if (std::sqrt(step) < BATCH_NR_TOLERANCE) converged |= 1u << l;
+        }
+    }
+    return converged & active;
+}
@@ -0,0 +1,77 @@
+#ifndef MORGHSPICY_BATCHEDSOLVER_H
+#define MORGHSPICY_BATCHEDSOLVER_H
+
+#pragma once
+#include <eigen3/Eigen/Dense>
+#include <vector>
+
+// AVX-512 holds 8 doubles, AVX2 4. Without either the same width still lets the
+// compiler unroll the lane loops into SSE pairs.
+#if defined(__AVX512F__)
+#define MORGHSPICY_SIMD_LANES 8
+#else
+#define MORGHSPICY_SIMD_LANES 4
+#endif
+
+class Graph;
+class MNASolver;
+class Element;
+class DiodeTable;
+
+// Solves LANES instances of one circuit topology at once (Monte Carlo / corners).
+// Every per-instance quantity is stored lane-innermost (struct of arrays):
+//   A[(row * n + col) * LANES + lane],  x[row * LANES + lane],  value[elem * LANES + lane]
+// so stamping, elimination and substitution are LANES-wide loops the compiler vectorizes.
+// All lanes share one pivot order, picked on the first active lane; a lane whose pivot
+// is poor or zero under that order, or whose Newton loop does not converge, is dropped
+// from the returned mask so the caller can redo that instance on the scalar MNASolver.
+class BatchedSolver {
+public:
+    static constexpr int LANES = MORGHSPICY_SIMD_LANES;
+    using LaneMask = unsigned;
+    static constexpr LaneMask ALL_LANES = (1u << LANES) - 1u;
+
+    // Builds the per-type kernels from a graph already laid out by layout.initializeMatrix().
+    // Returns false when the graph holds an element these kernels do not model.
+    bool compile(Graph& g, const MNASolver& layout);
+
+    int unknowns() const { return n; }
+
+    // Per-lane `value` of graph element elemIdx; compile() starts every lane at the nominal value
+    void setLaneValue(int elemIdx, int lane, double v) { values[static_cast<size_t>(elemIdx) * LANES + lane] = v; }
+    void resetLaneValues();
+
+    // One stamp + factor + solve at timestep h. prev and x are n * LANES, lane-innermost.
+    // Time-dependent sources take their current value from the graph (same waveform in every lane).
+    LaneMask solveStep(double h, const std::vector<double>& prev, std::vector<double>& x, LaneMask active = ALL_LANES);
+
+    // Newton DC operating point, x is the initial guess on entry. Returns the converged lanes.
+    LaneMask solveOperatingPoint(std::vector<double>& x, LaneMask active = ALL_LANES);
+
+    void extractLane(const std::vector<double>& x, int lane, Eigen::VectorXd& out) const;
+
+private:
+    struct TwoTerminal { int elem; int r1, r2; };            // rows, -1 = ground
+    struct Branch      { int elem; int r1, r2, k; };         // k = row of the branch current
+    struct Controlled  { int elem; int r1, r2, c1, c2, k; }; // c1/c2 controlling rows (or branch row in c1)
+    struct DiodeDev    { int elem; int r1, r2; double Is, nVt, Vz; bool zener; const DiodeTable* table; };
+
+    int n = 0;
+    int numNodes = 0;               // leading rows that get gmin, as in MNASolver
+    double gmin = 1e-12;
+    std::vector<Element*> elements;  // the compiled graph's elements (for time-dependent sources)
+    std::vector<double> nominal;     // element value, one per element
+    std::vector<double> values;      // element value per lane
+
+    std::vector<TwoTerminal> resistors, capacitors, currentSources;
+    std::vector<Branch> inductors, voltageSources, timeSources;
+    std::vector<Controlled> vccsList, vcvsList, cccsList, ccvsList;
+    std::vector<DiodeDev> diodes;
+
+    std::vector<double> A, b;        // scratch system, lane-innermost
+
+    void stamp(double h, const std::vector<double>& prev);
+    LaneMask factorAndSolve(std::vector<double>& x, LaneMask active);
+};
+
+#endif //MORGHSPICY_BATCHEDSOLVER_H
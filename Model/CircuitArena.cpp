@@ -0,0 +1,36 @@
+#include "CircuitArena.h"
+
+#include <algorithm>
+#include <functional>
+
+CircuitArena::~CircuitArena() {
+    for (const Chunk& c : chunks) ::operator delete(c.begin, std::align_val_t(c.align));
+}
+
+void* CircuitArena::allocate(Pool& pool, std::size_t size, std::size_t align) {
+    // Objects of one type are laid out back to back, so only the chunk start needs aligning
+    const std::size_t stride = (size + align - 1) / align * align;
+    if (pool.cur == nullptr || static_cast<std::size_t>(pool.end - pool.cur) < stride) {
+        const std::size_t bytes = stride * pool.nextCount;
+        auto* begin = static_cast<char*>(::operator new(bytes, std::align_val_t(align)));
+        Chunk c{begin, begin + bytes, align};
+        chunks.insert(std::upper_bound(chunks.begin(), chunks.end(), c,
+                                       [](const Chunk& a, const Chunk& b) { return std::less<>()(a.begin, b.begin); }), c);
+        reserved += bytes;
+        pool.cur = begin;
+        pool.end = begin + bytes;
+        pool.nextCount = std::min(pool.nextCount * 2, MAX_CHUNK_COUNT);
+    }
+    void* slot = pool.cur;
+    pool.cur += stride;
+    return slot;
+}
+
+bool CircuitArena::owns(const void* p) const {
+    auto* q = static_cast<const char*>(p);
+    auto it = std::upper_bound(chunks.begin(), chunks.end(), q,
+                               [](const char* v, const Chunk& c) { return std::less<const char*>()(v, c.begin); });
+    if (it == chunks.begin()) return false;
+    --it;
+    return std::less<const char*>()(q, it->end);
+}
@@ -0,0 +1,54 @@
+#ifndef MORGHSPICY_CIRCUITARENA_H
+#define MORGHSPICY_CIRCUITARENA_H
+
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Monotonic storage for the objects of one circuit, with one pool per type so elements
+// of a kind sit next to each other. Chunks grow geometrically and are only released
+// together when the arena goes away, so freeing a million-element circuit is a handful
+// of deallocations instead of one per element.
+// The arena never runs destructors: the owner destroys live objects in place (it already
+// walks its element list) and a removed object's slot is simply not reused.
+class CircuitArena {
+public:
+    CircuitArena() = default;
+    CircuitArena(const CircuitArena&) = delete;
+    CircuitArena& operator=(const CircuitArena&) = delete;
+    ~CircuitArena();
+
+    template <class T, class... Args>
+    T* make(Args&&... args) {
+        static const std::size_t id = nextTypeId++;
+        if (id >= pools.size()) pools.resize(id + 1);
+        void* slot = allocate(pools[id], sizeof(T), alignof(T));
+        return new (slot) T(std::forward<Args>(args)...);
+    }
+
+    // True for pointers handed out by make() (binary search over the chunk ranges)
+    bool owns(const void* p) const;
+
+    std::size_t bytesReserved() const { return reserved; }
+
+private:
+    struct Pool {
+        char* cur = nullptr;
+        char* end = nullptr;
+        std::size_t nextCount = 64;     // objects in the next chunk
+    };
+    struct Chunk { char* begin; char* end; std::size_t align; };
+
+    static inline std::size_t nextTypeId = 0;
+    static constexpr std::size_t MAX_CHUNK_COUNT = 1u << 16;
+
+    std::vector<Pool> pools;
+    std::vector<Chunk> chunks;          // sorted by address
+    std::size_t reserved = 0;
+
+    void* allocate(Pool& pool, std::size_t size, std::size_t align);
+};
+
+#endif //MORGHSPICY_CIRCUITARENA_H
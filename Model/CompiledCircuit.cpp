@@ -0,0 +1,313 @@
+#include "CompiledCircuit.h"
+#include "Graph.h"
+#include "Elements.h"
+#include "VecMath.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+int CompiledCircuit::row(int node_id) const {
+    auto it = nodeIdx.find(node_id);
+    return it == nodeIdx.end() ? -1 : it->second;
+}
+
+void CompiledCircuit::clear() {
+    graph = nullptr;
+    snapshot.clear();
+    for (Pair* p : {&resistors, &capacitors}) *p = Pair{};
+    incRow.clear(); incK.clear(); incSign.clear();
+    voltageSources = Branch{};
+    inductors = Branch{};
+    sinK.clear(); pulseK.clear(); sines.clear(); pulses.clear();
+    isR1.clear(); isR2.clear(); currentSources.clear();
+    diodes = DiodeBank{};
+    vccsList.clear(); vcvsList.clear(); cccsList.clear(); ccvsList.clear();
+    generic.clear();
+}
+
+bool CompiledCircuit::isCompiledFor(const Graph& g) const {
+    return graph == &g && snapshot == g.getElements();
+}
+
+void CompiledCircuit::addPair(Pair& p, const Element* e) {
+    int r1 = row(e->node1), r2 = row(e->node2);
+    if (r1 < 0) std::swap(r1, r2);
+    if (r1 < 0) return;                     // both ends grounded: stamps nothing
+    p.r1.push_back(r1);
+    p.r2.push_back(r2);
+    p.elem.push_back(e);
+}
+
+void CompiledCircuit::groundedLast(Pair& p) {
+    std::vector<size_t> order(p.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    auto mid = std::stable_partition(order.begin(), order.end(), [&](size_t i) { return p.r2[i] >= 0; });
+    Pair q;
+    for (size_t i : order) {
+        q.r1.push_back(p.r1[i]);
+        q.r2.push_back(p.r2[i]);
+        q.elem.push_back(p.elem[i]);
+    }
+    q.both = static_cast<size_t>(mid - order.begin());
+    q.g.resize(q.size());
+    p = std::move(q);
+}
+
+void CompiledCircuit::addIncidence(int r1, int r2, int k) {
+    if (r1 >= 0) { incRow.push_back(r1); incK.push_back(k); incSign.push_back(1.0); }
+    if (r2 >= 0) { incRow.push_back(r2); incK.push_back(k); incSign.push_back(-1.0); }
+}
+
+void CompiledCircuit::compile(const Graph& g, const std::map<int, int>& node_id_to_matrix_idx,
+                              int extra_var_start_idx) {
+    clear();
+    graph = &g;
+    snapshot = g.getElements();
+    nodeIdx = node_id_to_matrix_idx;
+    extraStart = extra_var_start_idx;
+
+    // Same lookup as cccs/ccvs::linkControlSource: first element with that name
+    auto controlRow = [&](const std::string& name) {
+        for (Element* e : snapshot)
+            if (e->name == name) return extraStart + e->extraVariableIndex;
+        return -1;
+    };
+
+    std::vector<const Diode*> diodeList;
+    for (Element* e : snapshot) {
+        int r1 = row(e->node1), r2 = row(e->node2);
+        int k = e->introducesExtraVariable ? extraStart + e->extraVariableIndex : -1;
+        switch (e->type) {
+            case RESISTOR:  addPair(resistors, e); break;
+            case CAPACITOR: addPair(capacitors, e); break;
+            case CURRENT_SOURCE:
+                isR1.push_back(r1); isR2.push_back(r2); currentSources.push_back(e);
+                break;
+            case DIODE: diodeList.push_back(static_cast<const Diode*>(e)); break;
+            case VOLTAGE_SOURCE:
+                addIncidence(r1, r2, k);
+                voltageSources.k.push_back(k); voltageSources.elem.push_back(e);
+                break;
+            case INDUCTOR:
+                addIncidence(r1, r2, k);
+                inductors.k.push_back(k); inductors.elem.push_back(e);
+                break;
+            case SINUSOIDAL_SOURCE:
+                addIncidence(r1, r2, k);
+                sinK.push_back(k); sines.push_back(static_cast<const SinusoidalSource*>(e));
+                break;
+            case PULSE_SOURCE:
+                addIncidence(r1, r2, k);
+                pulseK.push_back(k); pulses.push_back(static_cast<const PulseSource*>(e));
+                break;
+            case VCCS: {
+                auto* s = static_cast<const vccs*>(e);
+                vccsList.push_back({r1, r2, row(s->controlNode1()), row(s->controlNode2()), -1, e});
+                break;
+            }
+            case VCVS: {
+                auto* s = static_cast<const vcvs*>(e);
+                addIncidence(r1, r2, k);
+                vcvsList.push_back({r1, r2, row(s->controlNode1()), row(s->controlNode2()), k, e});
+                break;
+            }
+            case CCCS: {
+                int c = controlRow(static_cast<const cccs*>(e)->controlName());
+                if (c < 0) { generic.push_back(e); break; }
+                cccsList.push_back({r1, r2, c, -1, -1, e});
+                break;
+            }
+            case CCVS: {
+                int c = controlRow(static_cast<const ccvs*>(e)->controlName());
+                if (c < 0) { generic.push_back(e); break; }
+                addIncidence(r1, r2, k);
+                ccvsList.push_back({r1, r2, c, -1, k, e});
+                break;
+            }
+            default: generic.push_back(e); break;
+        }
+    }
+    groundedLast(resistors);
+    groundedLast(capacitors);
+
+    // Exact-model diodes first: the batched exp covers [0, exact)
+    auto split = std::stable_partition(diodeList.begin(), diodeList.end(),
+                                       [](const Diode* d) { return !d->table; });
+    diodes.exact = static_cast<size_t>(split - diodeList.begin());
+    for (const Diode* d : diodeList) {
+        int r1 = row(d->node1), r2 = row(d->node2);
+        diodes.r1.push_back(r1);
+        diodes.r2.push_back(r2);
+        diodes.s1.push_back(r1 < 0 ? extraStart : r1);
+        diodes.s2.push_back(r2 < 0 ? extraStart : r2);
+        diodes.Is.push_back(d->Is);
+        diodes.invNVt.push_back(1.0 / (d->n * d->Vt));
+        diodes.Vz.push_back(d->Vz);
+        diodes.zener.push_back(d->model == "Z" ? 1.0 : 0.0);
+        diodes.table.push_back(d->table.get());
+    }
+    for (auto* v : {&diodes.vd, &diodes.x, &diodes.e, &diodes.geq, &diodes.ieq}) v->resize(diodes.size());
+    diodes.volt.assign(static_cast<size_t>(extraStart) + 1, 0.0);
+}
+
+void CompiledCircuit::evaluateDiodes(const Eigen::VectorXd& prev) {
+    DiodeBank& d = diodes;
+    const size_t n = d.size();
+    const Eigen::Index rows = std::min<Eigen::Index>(extraStart, prev.size());
+    for (Eigen::Index r = 0; r < rows; ++r) d.volt[r] = prev(r);
+    // Rows a short prev does not cover read as 0, like pv() in stamp(); the ground slot stays 0
+    std::fill(d.volt.begin() + rows, d.volt.end(), 0.0);
+
+    // Same curve as Diode::current with vd already limited to 0.85 V
+    for (size_t i = 0; i < n; ++i) {
+        d.vd[i] = std::min(d.volt[d.s1[i]] - d.volt[d.s2[i]], 0.85);
+        d.x[i] = d.vd[i] * d.invNVt[i];
+    }
+    vecmath::exp(d.x.data(), d.e.data(), d.exact);
+    for (size_t i = 0; i < d.exact; ++i) {
+        d.geq[i] = d.Is[i] * d.invNVt[i] * d.e[i];
+        d.ieq[i] = d.Is[i] * (d.e[i] - 1.0) - d.geq[i] * d.vd[i];
+    }
+    for (size_t i = d.exact; i < n; ++i)
+        d.ieq[i] = d.table[i]->current(d.vd[i], d.geq[i]) - d.geq[i] * d.vd[i];
+    // Zener breakdown: unit-slope line through -Vz, i.e. g = 1 and Ieq = Vz
+    for (size_t i = 0; i < n; ++i) {
+        bool breakdown = d.zener[i] != 0.0 && d.vd[i] < -d.Vz[i];
+        d.geq[i] = breakdown ? 1.0 : d.geq[i];
+        d.ieq[i] = breakdown ? d.Vz[i] : d.ieq[i];
+    }
+}
+
+void CompiledCircuit::stamp(Eigen::MatrixXd& A, Eigen::VectorXd& b, const Eigen::VectorXd& prev, double h) {
+    auto pv = [&](int r) { return (r >= 0 && r < prev.size()) ? prev(r) : 0.0; };
+
+    // Conductance of each pair, then the symmetric scatter; R and C share the kernel
+    auto scatter = [&](const Pair& p) {
+        const double* g = p.g.data();
+        for (size_t i = 0; i < p.both; ++i) {
+            const int a = p.r1[i], c = p.r2[i];
+            A(a, a) += g[i];
+            A(c, c) += g[i];
+            A(a, c) -= g[i];
+            A(c, a) -= g[i];
+        }
+        for (size_t i = p.both; i < p.size(); ++i) A(p.r1[i], p.r1[i]) += g[i];
+    };
+
+    // Resistors
+    {
+        const size_t n = resistors.size();
+        double* g = resistors.g.data();
+        size_t bad = 0;
+        for (size_t i = 0; i < n; ++i) g[i] = resistors.elem[i]->value;
+        for (size_t i = 0; i < n; ++i) {
+            bad += g[i] <= 0.0;
+            g[i] = g[i] > 0.0 ? 1.0 / g[i] : 0.0;
+        }
+        if (bad) {
+            for (size_t i = 0; i < n; ++i) {
+                const Element* e = resistors.elem[i];
+                if (e->value <= 0)
+                    std::cerr << "Error: Resistor '" << e->name << "' has a non-positive value (" << e->value << "). Skipping stamp." << std::endl;
+            }
+        }
+        scatter(resistors);
+    }
+
+    // Capacitors (backward Euler companion: C/h in parallel with a history current)
+    if (capacitors.size()) {
+        const size_t n = capacitors.size();
+        double* g = capacitors.g.data();
+        if (h <= 0) {
+            std::cerr << "Error: Invalid timestep h (" << h << ") for capacitors. Skipping stamp." << std::endl;
+        } else {
+            const double invh = 1.0 / h;
+            size_t bad = 0;
+            for (size_t i = 0; i < n; ++i) g[i] = capacitors.elem[i]->value;
+            for (size_t i = 0; i < n; ++i) {
+                bad += g[i] <= 0.0;
+                g[i] = g[i] > 0.0 ? g[i] * invh : 0.0;
+            }
+            if (bad) {
+                for (size_t i = 0; i < n; ++i) {
+                    const Element* e = capacitors.elem[i];
+                    if (e->value <= 0)
+                        std::cerr << "Error: Capacitor '" << e->name << "' has a non-positive value (" << e->value << "). Skipping stamp." << std::endl;
+                }
+            }
+            scatter(capacitors);
+            for (size_t i = 0; i < capacitors.both; ++i) {
+                double hist = g[i] * (pv(capacitors.r1[i]) - pv(capacitors.r2[i]));
+                b(capacitors.r1[i]) += hist;
+                b(capacitors.r2[i]) -= hist;
+            }
+            for (size_t i = capacitors.both; i < n; ++i) b(capacitors.r1[i]) += g[i] * pv(capacitors.r1[i]);
+        }
+    }
+
+    // Branch incidence of V, L, sources and VCVS/CCVS outputs
+    for (size_t i = 0; i < incRow.size(); ++i) {
+        A(incRow[i], incK[i]) += incSign[i];
+        A(incK[i], incRow[i]) += incSign[i];
+    }
+
+    for (size_t i = 0; i < voltageSources.k.size(); ++i)
+        b(voltageSources.k[i]) += voltageSources.elem[i]->value;
+
+    if (!inductors.k.empty()) {
+        if (h <= 0) {
+            std::cerr << "Error: Invalid timestep h (" << h << ") for inductors. Skipping stamp." << std::endl;
+        } else {
+            for (size_t i = 0; i < inductors.k.size(); ++i) {
+                const Element* e = inductors.elem[i];
+                const int k = inductors.k[i];
+                if (e->value <= 0) {
+                    std::cerr << "Error: Inductor '" << e->name << "' has a non-positive value (" << e->value << "). Skipping stamp." << std::endl;
+                    continue;
+                }
+                const double z = e->value / h;
+                A(k, k) -= z;
+                b(k) -= z * pv(k);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < sines.size(); ++i) b(sinK[i]) += sines[i]->getInstantaneousValue();
+    for (size_t i = 0; i < pulses.size(); ++i) b(pulseK[i]) += pulses[i]->getInstantaneousValue();
+
+    for (size_t i = 0; i < currentSources.size(); ++i) {
+        const double I = currentSources[i]->value;
+        if (isR1[i] >= 0) b(isR1[i]) -= I;
+        if (isR2[i] >= 0) b(isR2[i]) += I;
+    }
+
+    // Diodes, linearized at prev (the Newton iterate)
+    if (diodes.size()) evaluateDiodes(prev);
+    for (size_t i = 0; i < diodes.size(); ++i) {
+        const int a = diodes.r1[i], c = diodes.r2[i];
+        const double geq = diodes.geq[i], ieq = diodes.ieq[i];
+        if (a >= 0) { A(a, a) += geq; b(a) -= ieq; }
+        if (c >= 0) { A(c, c) += geq; b(c) += ieq; }
+        if (a >= 0 && c >= 0) { A(a, c) -= geq; A(c, a) -= geq; }
+    }
+
+    for (const auto& s : vccsList) {
+        const double gm = s.elem->value;
+        if (s.r1 >= 0 && s.c1 >= 0) A(s.r1, s.c1) += gm;
+        if (s.r1 >= 0 && s.c2 >= 0) A(s.r1, s.c2) -= gm;
+        if (s.r2 >= 0 && s.c1 >= 0) A(s.r2, s.c1) -= gm;
+        if (s.r2 >= 0 && s.c2 >= 0) A(s.r2, s.c2) += gm;
+    }
+    for (const auto& s : vcvsList) {
+        if (s.c1 >= 0) A(s.k, s.c1) -= s.elem->value;
+        if (s.c2 >= 0) A(s.k, s.c2) += s.elem->value;
+    }
+    for (const auto& s : cccsList) {
+        if (s.r1 >= 0) A(s.r1, s.c1) += s.elem->value;
+        if (s.r2 >= 0) A(s.r2, s.c1) -= s.elem->value;
+    }
+    for (const auto& s : ccvsList) A(s.k, s.c1) -= s.elem->value;
+
+    for (Element* e : generic) e->stampMNA(A, b, nodeIdx, extraStart, prev, h);
+}
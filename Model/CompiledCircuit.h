@@ -0,0 +1,94 @@
+#ifndef MORGHSPICY_COMPILEDCIRCUIT_H
+#define MORGHSPICY_COMPILEDCIRCUIT_H
+
+#pragma once
+#include <eigen3/Eigen/Dense>
+#include <map>
+#include <vector>
+
+class Graph;
+class Element;
+class SinusoidalSource;
+class PulseSource;
+class DiodeTable;
+
+// Struct-of-arrays view of a Graph laid out by MNASolver::initializeMatrix().
+// Element rows are resolved once (no std::map lookups while stamping) and every element
+// type is stamped by its own non-virtual loop over contiguous arrays. Values are re-read
+// from the elements on every stamp, since sweeps and Monte Carlo edit them in place.
+// Types without a kernel here (subcircuits, reduced models) keep their virtual stampMNA.
+class CompiledCircuit {
+public:
+    void compile(const Graph& g, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx);
+    void clear();
+
+    // Same graph and element list as the last compile()
+    bool isCompiledFor(const Graph& g) const;
+
+    // Adds every element's contribution at timestep h (A and b are not cleared)
+    void stamp(Eigen::MatrixXd& A, Eigen::VectorXd& b, const Eigen::VectorXd& prev_solution, double h);
+
+private:
+    // Two-terminal group. Symmetric stamps (R, C) are oriented so a grounded terminal is
+    // always r2, and the grounded ones come last: [0, both) has two live rows, [both, size)
+    // only r1. The kernels then run without per-element ground checks.
+    struct Pair {
+        std::vector<int> r1, r2;
+        std::vector<const Element*> elem;
+        std::vector<double> g;              // per-stamp conductance scratch
+        size_t both = 0;
+        size_t size() const { return r1.size(); }
+    };
+    // Element owning a branch current row k
+    struct Branch {
+        std::vector<int> k;
+        std::vector<const Element*> elem;
+    };
+
+    const Graph* graph = nullptr;
+    std::vector<Element*> snapshot;         // element list at compile time
+    std::map<int, int> nodeIdx;
+    int extraStart = 0;
+
+    Pair resistors, capacitors;
+
+    // KCL/branch-equation incidence of every V-like element: A(row, k) += sign, A(k, row) += sign
+    std::vector<int> incRow, incK;
+    std::vector<double> incSign;
+
+    Branch voltageSources, inductors;
+    std::vector<int> sinK, pulseK;
+    std::vector<const SinusoidalSource*> sines;
+    std::vector<const PulseSource*> pulses;
+
+    // Orientation matters for these; rows may be -1 (ground)
+    std::vector<int> isR1, isR2;
+    std::vector<const Element*> currentSources;
+
+    // Diodes are evaluated together: gather vd, one batched exp (VecMath.h), the Zener
+    // branch blended in per lane, then the scatter. Model parameters are read at compile time.
+    // Fast-mode diodes (Diode::table) sit after the exact ones and use their table instead of exp.
+    struct DiodeBank {
+        size_t exact = 0;
+        std::vector<const DiodeTable*> table;
+        std::vector<int> r1, r2;                     // -1 = ground
+        std::vector<int> s1, s2;                     // slots in `volt`, ground = the trailing zero
+        std::vector<double> Is, invNVt, Vz, zener;   // zener: 1 for model "Z"
+        std::vector<double> vd, x, e, geq, ieq;      // per-stamp scratch
+        std::vector<double> volt;                    // node voltages of prev plus a ground slot
+        size_t size() const { return r1.size(); }
+    } diodes;
+    // Controlled sources: output rows, control rows (or control branch row in c1), own branch k
+    struct Controlled { int r1, r2, c1, c2, k; const Element* elem; };
+    std::vector<Controlled> vccsList, vcvsList, cccsList, ccvsList;
+
+    std::vector<Element*> generic;
+
+    int row(int node_id) const;
+    void addPair(Pair& p, const Element* e);
+    static void groundedLast(Pair& p);
+    void addIncidence(int r1, int r2, int k);
+    void evaluateDiodes(const Eigen::VectorXd& prev);
+};
+
+#endif //MORGHSPICY_COMPILEDCIRCUIT_H
@@ -0,0 +1,64 @@
+#include "DiodeTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace {
+    constexpr double FORWARD_LIMIT = 0.85;   // same clamp as Diode::current
+    constexpr double REVERSE_SPAN = 40.0;    // in units of nVt; exp(-40) ~ 4e-18
+    constexpr std::size_t MAX_SEGMENTS = 1u << 20;
+}
+
+std::shared_ptr<const DiodeTable> DiodeTable::get(double Is, double nVt, double tol) {
+    static std::mutex mutex;
+    static std::map<std::tuple<double, double, double>, std::shared_ptr<const DiodeTable>> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = cache[{Is, nVt, tol}];
+    if (!slot) slot = std::make_shared<DiodeTable>(Is, nVt, tol);
+    return slot;
+}
+
+DiodeTable::DiodeTable(double Is_, double nVt_, double tol_) : Is(Is_), nVt(nVt_), tol(tol_) {
+    vmin = -REVERSE_SPAN * nVt;
+    vmax = FORWARD_LIMIT;
+    // Hermite slope error is ~ (h / nVt)^3 / 125 relative, which gives the starting spacing
+    double h = nVt * std::cbrt(125.0 * std::max(tol, 1e-12));
+    auto segments = static_cast<std::size_t>(std::ceil((vmax - vmin) / h));
+    segments = std::clamp<std::size_t>(segments, 8, MAX_SEGMENTS);
+    build(segments);
+    while (worstError() > tol && segments < MAX_SEGMENTS) {
+        segments *= 2;
+        build(segments);
+    }
+}
+
+void DiodeTable::build(std::size_t segments) {
+    step = (vmax - vmin) / static_cast<double>(segments);
+    invStep = 1.0 / step;
+    slope = step / nVt;
+    last = segments;
+    E.resize(segments + 1);
+    for (std::size_t k = 0; k <= segments; ++k) {
+        double v = (k == segments) ? vmax : vmin + step * static_cast<double>(k);
+        E[k] = std::exp(v / nVt);
+    }
+}
+
+double DiodeTable::worstError() const {
+    // The error peaks inside each segment; a few probes per segment are enough for a cubic
+    double worst = 0.0;
+    for (std::size_t k = 0; k < last; ++k) {
+        for (double t : {0.21, 0.5, 0.79}) {
+            double v = vmin + step * (static_cast<double>(k) + t);
+            double e = std::exp(v / nVt);
+            double dE;
+            double p = interpolate(v, dE);
+            worst = std::max(worst, std::abs(p - e) / e);
+            worst = std::max(worst, std::abs(dE * nVt - e) / e);
+        }
+    }
+    return worst;
+}
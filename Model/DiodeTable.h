@@ -0,0 +1,60 @@
+#ifndef MORGHSPICY_DIODETABLE_H
+#define MORGHSPICY_DIODETABLE_H
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Fast approximate diode curve for exploratory runs: I(v) = Is (exp(v / nVt) - 1) tabulated
+// on a uniform grid from -40 nVt to the 0.85 V forward limit and evaluated by cubic Hermite
+// interpolation (node values and exact slopes), so I and dI/dV stay continuous and monotone.
+// The exponential itself is tabulated, so the reverse region keeps full relative accuracy;
+// the grid is refined at build time until exp and its slope stay within `tol` between
+// nodes. Outside the grid the curve continues linearly, like the exact model past 0.85 V.
+// The Zener branch is not tabulated (it is already linear).
+class DiodeTable {
+public:
+    // Tables are shared between diodes with the same parameters and tolerance
+    static std::shared_ptr<const DiodeTable> get(double Is, double nVt, double tol);
+
+    DiodeTable(double Is, double nVt, double tol);
+
+    // Branch-free: vd is clamped onto the grid and the end slope carries the rest
+    double current(double vd, double& g) const {
+        const double vc = std::clamp(vd, vmin, vmax);
+        double dE;
+        const double e = interpolate(vc, dE);
+        g = Is * dE;
+        return Is * (e - 1.0) + g * (vd - vc);
+    }
+
+    std::size_t points() const { return E.size(); }
+    double tolerance() const { return tol; }
+
+private:
+    double Is, nVt, tol;
+    double vmin = 0.0, vmax = 0.0, step = 0.0, invStep = 0.0;
+    double slope = 0.0;                   // step / nVt: dE/dt = E * slope on the unit segment
+    std::size_t last = 0;                 // index of the last node
+    std::vector<double> E;                // exp(v / nVt) at the nodes
+
+    // Hermite on E = exp(v / nVt) for vmin <= vd <= vmax; dE is dE/dv
+    double interpolate(double vd, double& dE) const {
+        double s = (vd - vmin) * invStep;
+        auto k = static_cast<std::size_t>(s);
+        k = std::min(k, last - 1);
+        const double t = s - static_cast<double>(k);
+        // p(t) = e0 + m0 t + (3d - 2m0 - m1) t^2 + (m0 + m1 - 2d) t^3, slopes per unit t
+        const double e0 = E[k], m0 = E[k] * slope, m1 = E[k + 1] * slope, d = E[k + 1] - e0;
+        const double c2 = 3.0 * d - 2.0 * m0 - m1, c3 = m0 + m1 - 2.0 * d;
+        dE = (m0 + t * (2.0 * c2 + 3.0 * t * c3)) * invStep;
+        return e0 + t * (m0 + t * (c2 + t * c3));
+    }
+
+    void build(std::size_t segments);
+    double worstError() const;
+};
+
+#endif //MORGHSPICY_DIODETABLE_H
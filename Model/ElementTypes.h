@@ -17,6 +17,8 @@ enum ElementType {
     CCVS,
     SINUSOIDAL_SOURCE,
     PULSE_SOURCE,
-    SUBCIRCUIT
+    FILE_SOURCE,
+    SUBCIRCUIT,
+    REDUCED_MODEL
 };
 #endif //MORGHSPICY_ELEMENTTYPES_H
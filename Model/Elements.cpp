@@ -3,6 +3,7 @@
 //
 
 #include "Elements.h"
+#include "Signal.h"
 #include <cmath> // Required for std::exp used in Diode model
 #include <iostream>
 
@@ -159,17 +160,8 @@ void Diode::stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
     }
     // --- End of Limiting Logic ---
 
-    double Geq, Ieq;
-
-    if (model == "Z" && vd_guess < -Vz) {
-        Geq = 1.0;
-        Ieq = Geq * Vz;
-    } else {
-        double exp_val = std::exp(vd_guess / (n * Vt));
-        double id_val = Is * (exp_val - 1.0);
-        Geq = (Is / (n * Vt)) * exp_val;
-        Ieq = id_val - Geq * vd_guess;
-    }
+    double Geq;
+    double Ieq = current(vd_guess, Geq) - Geq * vd_guess;
 
     // Stamping the equivalent circuit
     if (n1_idx != -1) A(n1_idx, n1_idx) += Geq;
@@ -182,6 +174,19 @@ void Diode::stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
     if (n1_idx != -1) b(n1_idx) -= Ieq;
     if (n2_idx != -1) b(n2_idx) += Ieq;
 }
+double Diode::current(double vd, double& g) const {
+    if (model == "Z" && vd < -Vz) {
+        g = 1.0;
+        return vd + Vz;
+    }
+    if (table) return table->current(vd, g);
+    // Past the forward limit the companion model is frozen at 0.85 V: a straight line
+    const double vc = std::min(vd, 0.85);
+    double exp_val = std::exp(vc / (n * Vt));
+    g = (Is / (n * Vt)) * exp_val;
+    return Is * (exp_val - 1.0) + g * (vd - vc);
+}
+
 void vccs::stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
                     const std::map<int, int>& node_id_to_matrix_idx,
                     int extra_var_start_idx,
@@ -285,6 +290,107 @@ void ccvs::linkControlSource(const std::vector<Element*>& all) {
 
 
 
+// --- Small-signal (AC) stamps: G holds conductances, C the coefficients of s = jw ---
+
+void Resistor::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                       int /*extra_var_start_idx*/, const Eigen::VectorXd& /*op*/) const {
+    if (value <= 0) return;
+    sys.conductance(get_matrix_idx(node1, node_id_to_matrix_idx),
+                    get_matrix_idx(node2, node_id_to_matrix_idx), 1.0 / value);
+}
+
+void Capacitor::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                        int /*extra_var_start_idx*/, const Eigen::VectorXd& /*op*/) const {
+    sys.capacitance(get_matrix_idx(node1, node_id_to_matrix_idx),
+                    get_matrix_idx(node2, node_id_to_matrix_idx), value);
+}
+
+void Inductor::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                       int extra_var_start_idx, const Eigen::VectorXd& /*op*/) const {
+    // V(n1) - V(n2) - jwL * I = 0
+    int k = extra_var_start_idx + extraVariableIndex;
+    sys.branch(get_matrix_idx(node1, node_id_to_matrix_idx), get_matrix_idx(node2, node_id_to_matrix_idx), k);
+    sys.addC(k, k, -value);
+}
+
+void VoltageSource::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                            int extra_var_start_idx, const Eigen::VectorXd& /*op*/) const {
+    int k = extra_var_start_idx + extraVariableIndex;
+    sys.branch(get_matrix_idx(node1, node_id_to_matrix_idx), get_matrix_idx(node2, node_id_to_matrix_idx), k);
+    sys.addU(k, acPhasor());
+}
+
+void CurrentSource::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                            int /*extra_var_start_idx*/, const Eigen::VectorXd& /*op*/) const {
+    sys.addU(get_matrix_idx(node1, node_id_to_matrix_idx), -acPhasor());
+    sys.addU(get_matrix_idx(node2, node_id_to_matrix_idx), acPhasor());
+}
+
+void Diode::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                    int /*extra_var_start_idx*/, const Eigen::VectorXd& op) const {
+    int n1_idx = get_matrix_idx(node1, node_id_to_matrix_idx);
+    int n2_idx = get_matrix_idx(node2, node_id_to_matrix_idx);
+    double vd = ((n1_idx == -1) ? 0.0 : op(n1_idx)) - ((n2_idx == -1) ? 0.0 : op(n2_idx));
+    vd = std::min(vd, 0.85); // same limiting as stampMNA
+
+    // Conductance of the companion model at the operating point, from the same curve
+    // (table or exact) that stampMNA used to find it
+    double gd;
+    current(vd, gd);
+    sys.conductance(n1_idx, n2_idx, gd);
+}
+
+void vccs::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                   int /*extra_var_start_idx*/, const Eigen::VectorXd& /*op*/) const {
+    int n1 = get_matrix_idx(node1, node_id_to_matrix_idx);
+    int n2 = get_matrix_idx(node2, node_id_to_matrix_idx);
+    int c1 = get_matrix_idx(ctrl_node1, node_id_to_matrix_idx);
+    int c2 = get_matrix_idx(ctrl_node2, node_id_to_matrix_idx);
+    sys.addG(n1, c1, value);
+    sys.addG(n1, c2, -value);
+    sys.addG(n2, c1, -value);
+    sys.addG(n2, c2, value);
+}
+
+void vcvs::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                   int extra_var_start_idx, const Eigen::VectorXd& /*op*/) const {
+    int k = extra_var_start_idx + extraVariableIndex;
+    sys.branch(get_matrix_idx(node1, node_id_to_matrix_idx), get_matrix_idx(node2, node_id_to_matrix_idx), k);
+    sys.addG(k, get_matrix_idx(ctrl_node1, node_id_to_matrix_idx), -value);
+    sys.addG(k, get_matrix_idx(ctrl_node2, node_id_to_matrix_idx), value);
+}
+
+void cccs::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                   int extra_var_start_idx, const Eigen::VectorXd& /*op*/) const {
+    if (!controlling_elem) return;
+    int ctrl_idx = extra_var_start_idx + controlling_elem->extraVariableIndex;
+    sys.addG(get_matrix_idx(node1, node_id_to_matrix_idx), ctrl_idx, value);
+    sys.addG(get_matrix_idx(node2, node_id_to_matrix_idx), ctrl_idx, -value);
+}
+
+void ccvs::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                   int extra_var_start_idx, const Eigen::VectorXd& /*op*/) const {
+    if (!controlling_elem) return;
+    int k = extra_var_start_idx + extraVariableIndex;
+    sys.branch(get_matrix_idx(node1, node_id_to_matrix_idx), get_matrix_idx(node2, node_id_to_matrix_idx), k);
+    sys.addG(k, extra_var_start_idx + controlling_elem->extraVariableIndex, -value);
+}
+
+// Time-domain waveforms do not enter the AC solution; only acMagnitude/acPhase do
+void SinusoidalSource::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                               int extra_var_start_idx, const Eigen::VectorXd& /*op*/) const {
+    int k = extra_var_start_idx + extraVariableIndex;
+    sys.branch(get_matrix_idx(node1, node_id_to_matrix_idx), get_matrix_idx(node2, node_id_to_matrix_idx), k);
+    sys.addU(k, acPhasor());
+}
+
+void PulseSource::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                          int extra_var_start_idx, const Eigen::VectorXd& /*op*/) const {
+    int k = extra_var_start_idx + extraVariableIndex;
+    sys.branch(get_matrix_idx(node1, node_id_to_matrix_idx), get_matrix_idx(node2, node_id_to_matrix_idx), k);
+    sys.addU(k, acPhasor());
+}
+
 void Resistor::display() {
     std::cout << "Resistor " << name << ": " << value << " Ohms, Nodes: " << node1 << " - " << node2 << std::endl;
 }
@@ -334,14 +440,14 @@ void PulseSource::stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
     b(extra_index) += getInstantaneousValue();
 }
 
-double PulseSource::getInstantaneousValue() const {
+double PulseSource::evaluate(double t) const {
     // Before the delay time, the voltage is at its initial value
-    if (time <= td) {
+    if (t <= td) {
         return v1;
     }
 
     // After the delay, calculate time within the current period
-    double time_in_period = fmod(time - td, per);
+    double time_in_period = fmod(t - td, per);
 
     // During the rise time
     if (time_in_period < tr) {
@@ -359,4 +465,107 @@ double PulseSource::getInstantaneousValue() const {
     else {
         return v1;
     }
-}
\ No newline at end of file
+}
+
+FileSource::FileSource(std::string n, int n1, int n2, std::string path, double fs, int chunk)
+        : Element(std::move(n), n1, n2, 0.0, FILE_SOURCE), file(std::move(path)), Fs(fs), chunkSize(chunk) {
+    introducesExtraVariable = true;
+}
+
+FileSource::FileSource(const FileSource& other)
+        : Element(other), file(other.file), Fs(other.Fs), chunkSize(other.chunkSize) {
+    if (other.signal) open();
+}
+
+FileSource::~FileSource() = default;
+
+bool FileSource::open() {
+    signal = std::make_unique<Signal>(file, Fs, std::numeric_limits<double>::infinity(), chunkSize);
+    if (!signal->open() || signal->sampleRate() <= 0) {
+        signal.reset();
+        ended = true;
+        level = yk = yk1 = 0.0;
+        return false;
+    }
+    Fs = signal->sampleRate();
+    return rewind();
+}
+
+bool FileSource::rewind() {
+    // Signal::open() starts the stream over (and, for text, forgets the parse position)
+    if (!signal->open()) return false;
+    k = 0;
+    chunk = {};
+    chunkPos = 0;
+    ended = !pull(yk);
+    if (ended) yk = 0.0;
+    else if (!pull(yk1)) ended = true;
+    if (ended) yk1 = yk;
+    level = yk;
+    return true;
+}
+
+bool FileSource::pull(double& y) {
+    if (chunkPos == chunk.size()) {
+        if (!signal->readNextChunk()) return false;
+        chunk = signal->currentChunk().samples;
+        chunkPos = 0;
+    }
+    y = chunk[chunkPos++];
+    return true;
+}
+
+void FileSource::updateTime(double newTime) {
+    if (!signal) return;
+    const double pos = newTime * Fs;   // in samples
+    if (pos < static_cast<double>(k) && k > 0 && !rewind()) return;
+    // Transient time only grows, so the cursor walks each sample once: no search per step
+    while (!ended && pos >= static_cast<double>(k + 1)) {
+        ++k;
+        yk = yk1;
+        if (!pull(yk1)) {
+            ended = true;
+            yk1 = yk;
+        }
+    }
+    const double frac = std::clamp(pos - static_cast<double>(k), 0.0, 1.0);
+    level = yk + (yk1 - yk) * frac;
+}
+
+double FileSource::nextBreakpoint(double t) const {
+    if (!signal) return std::numeric_limits<double>::infinity();
+    // A time that landed on a sample up to rounding counts as that sample
+    const double next = std::floor(std::max(t, 0.0) * Fs + 1e-6) + 1.0;
+    if (ended && next > static_cast<double>(k)) return std::numeric_limits<double>::infinity();
+    return next / Fs;
+}
+
+void FileSource::display() {
+    std::cout << "File Source " << name << ": " << file << ", Fs=" << Fs << "Hz, "
+              << "Nodes: " << node1 << "-" << node2 << std::endl;
+}
+
+void FileSource::stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
+                          const std::map<int, int>& node_id_to_matrix_idx,
+                          int extra_var_start_idx,
+                          const Eigen::VectorXd& prev_solution,
+                          double h) {
+    int extra_index = extra_var_start_idx + extraVariableIndex;
+    int idx1 = get_matrix_idx(node1, node_id_to_matrix_idx);
+    int idx2 = get_matrix_idx(node2, node_id_to_matrix_idx);
+
+    if (idx1 != -1) A(idx1, extra_index) += 1.0;
+    if (idx2 != -1) A(idx2, extra_index) -= 1.0;
+
+    if (idx1 != -1) A(extra_index, idx1) += 1.0;
+    if (idx2 != -1) A(extra_index, idx2) -= 1.0;
+
+    b(extra_index) += level;
+}
+
+void FileSource::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                         int extra_var_start_idx, const Eigen::VectorXd& /*op*/) const {
+    int extra_index = extra_var_start_idx + extraVariableIndex;
+    sys.branch(get_matrix_idx(node1, node_id_to_matrix_idx), get_matrix_idx(node2, node_id_to_matrix_idx), extra_index);
+    sys.addU(extra_index, acPhasor());
+}
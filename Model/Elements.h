@@ -4,9 +4,13 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <span>
 #include <iostream>
 #include <eigen3/Eigen/Dense>
 #include "ElementTypes.h"
+#include "SmallSignal.h"
+#include "DiodeTable.h"
 #include <bits/stdc++.h>
 #include <cmath>
 #include<bits/stdc++.h>
@@ -21,8 +25,11 @@ public:
 
     // Flag for elements that add a new unknown (current) to the MNA system
     bool introducesExtraVariable = false;
-    // The index of this element's extra variable in the MNA matrix
+    // The index of this element's (first) extra variable in the MNA matrix
     int extraVariableIndex = -1;
+    // AC small-signal excitation (independent sources): magnitude and phase in degrees
+    double acMagnitude = 0.0;
+    double acPhase = 0.0;
     float x = 0.0f; // Position for graphical representation
     float y = 0.0f;
 
@@ -40,21 +47,40 @@ public:
                           const Eigen::VectorXd& prev_solution,
                           double h) = 0;
 
+    // Small-signal contribution linearized at the operating point op: G, C and the AC excitation.
+    // Elements that add nothing keep the default.
+    virtual void stampAC(SmallSignalSystem& /*sys*/,
+                         const std::map<int, int>& /*node_id_to_matrix_idx*/,
+                         int /*extra_var_start_idx*/,
+                         const Eigen::VectorXd& /*op*/) const {}
+
+    // Number of consecutive extra variables starting at extraVariableIndex
+    virtual int extraVariableCount() const { return introducesExtraVariable ? 1 : 0; }
+
+    std::complex<double> acPhasor() const { return std::polar(acMagnitude, acPhase * std::numbers::pi / 180.0); }
+
     virtual void display() = 0;
+
+    // Deep copy, used to give each parallel worker its own circuit instance
+    virtual Element* clone() const = 0;
 };
 
 class Resistor : public Element {
 public:
     Resistor(std::string n, int n1, int n2, double v) : Element(n, n1, n2, v, RESISTOR) {}
     void display() override;
+    Element* clone() const override { return new Resistor(*this); }
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx, const Eigen::VectorXd& prev_solution, double h) override;
+    void stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx, const Eigen::VectorXd& op) const override;
 };
 
 class Capacitor : public Element {
 public:
     Capacitor(std::string n, int n1, int n2, double v) : Element(n, n1, n2, v, CAPACITOR) {}
     void display() override;
+    Element* clone() const override { return new Capacitor(*this); }
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx, const Eigen::VectorXd& prev_solution, double h) override;
+    void stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx, const Eigen::VectorXd& op) const override;
 };
 
 class Inductor : public Element {
@@ -63,7 +89,9 @@ public:
         introducesExtraVariable = true;
     }
     void display() override;
+    Element* clone() const override { return new Inductor(*this); }
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx, const Eigen::VectorXd& prev_solution, double h) override;
+    void stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx, const Eigen::VectorXd& op) const override;
 };
 
 class VoltageSource : public Element {
@@ -72,14 +100,18 @@ public:
         introducesExtraVariable = true;
     }
     void display() override;
+    Element* clone() const override { return new VoltageSource(*this); }
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx, const Eigen::VectorXd& prev_solution, double h) override;
+    void stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx, const Eigen::VectorXd& op) const override;
 };
 
 class CurrentSource : public Element {
 public:
     CurrentSource(std::string n, int n1, int n2, double v) : Element(n, n1, n2, v, CURRENT_SOURCE) {}
     void display() override;
+    Element* clone() const override { return new CurrentSource(*this); }
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx, const Eigen::VectorXd& prev_solution, double h) override;
+    void stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx, const Eigen::VectorXd& op) const override;
 };
 
 class Diode : public Element {
@@ -95,6 +127,9 @@ public:
     double Vz; // Zener Breakdown Voltage
     double Iz; // Zener Current at Vz
 
+    // Fast mode: tabulated forward/reverse curve instead of exp (null = exact model)
+    std::shared_ptr<const DiodeTable> table;
+
     Diode(std::string name, int n1, int n2, std::string m)
             : Element(name, n1, n2, 0.0, DIODE), model(m) {
         // Initialize model parameters with common default values
@@ -107,12 +142,20 @@ public:
         Iz = 0.0;
     }
 
+    // Large-signal current at vd and its slope g, the same curve stampMNA linearizes
+    double current(double vd, double& g) const;
+
     void display() override;
+    Element* clone() const override { return new Diode(*this); }
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
                   const std::map<int, int>& node_id_to_matrix_idx,
                   int extra_var_start_idx,
                   const Eigen::VectorXd& prev_solution,
                   double h) override;
+    void stampAC(SmallSignalSystem& sys,
+                 const std::map<int, int>& node_id_to_matrix_idx,
+                 int extra_var_start_idx,
+                 const Eigen::VectorXd& op) const override;
 };
 
 // dependent sources // بخدا خودم کامنت گذاشتم
@@ -128,11 +171,20 @@ public:
                   << ", Control: " << ctrl_node1 << "-" << ctrl_node2 << std::endl;
     }
 
+    Element* clone() const override { return new vccs(*this); }
+
+    int controlNode1() const { return ctrl_node1; }
+    int controlNode2() const { return ctrl_node2; }
+
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
                   const std::map<int, int>& node_id_to_matrix_idx,
                   int extra_var_start_idx,
                   const Eigen::VectorXd& prev_solution,
                   double h) override;
+    void stampAC(SmallSignalSystem& sys,
+                 const std::map<int, int>& node_id_to_matrix_idx,
+                 int extra_var_start_idx,
+                 const Eigen::VectorXd& op) const override;
 };
 
 class vcvs : public Element {
@@ -149,11 +201,20 @@ public:
                   << ", Control: " << ctrl_node1 << "-" << ctrl_node2 << std::endl;
     }
 
+    Element* clone() const override { return new vcvs(*this); }
+
+    int controlNode1() const { return ctrl_node1; }
+    int controlNode2() const { return ctrl_node2; }
+
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
                   const std::map<int, int>& node_id_to_matrix_idx,
                   int extra_var_start_idx,
                   const Eigen::VectorXd& prev_solution,
                   double h) override;
+    void stampAC(SmallSignalSystem& sys,
+                 const std::map<int, int>& node_id_to_matrix_idx,
+                 int extra_var_start_idx,
+                 const Eigen::VectorXd& op) const override;
 };
 
 class cccs : public Element {
@@ -169,11 +230,19 @@ public:
                   << ", Control source: " << controlling_name << std::endl;
     }
 
+    Element* clone() const override { return new cccs(*this); }
+
+    const std::string& controlName() const { return controlling_name; }
+
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
                   const std::map<int, int>& node_id_to_matrix_idx,
                   int extra_var_start_idx,
                   const Eigen::VectorXd& prev_solution,
                   double h) override;
+    void stampAC(SmallSignalSystem& sys,
+                 const std::map<int, int>& node_id_to_matrix_idx,
+                 int extra_var_start_idx,
+                 const Eigen::VectorXd& op) const override;
 
     void linkControlSource(const std::vector<Element*>& all_elements);
 };
@@ -193,47 +262,22 @@ public:
                   << ", Control source: " << controlling_name << std::endl;
     }
 
-    void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
-                  const std::map<int, int>& node_id_to_matrix_idx,
-                  int extra_var_start_idx,
-                  const Eigen::VectorXd& prev_solution,
-                  double h) override;
-
-    void linkControlSource(const std::vector<Element*>& all_elements);
-};
-class Subcircuit : public Element {
-public:
-    std::vector<Element*> internalElements;
+    Element* clone() const override { return new ccvs(*this); }
 
-    int internalPortNode1;
-    int internalPortNode2;
-
-    Subcircuit(std::string n, int n1, int n2)
-            : Element(n, n1, n2, 0.0, SUBCIRCUIT) {
-        introducesExtraVariable = false;
-    }
-
-    ~Subcircuit() {
-        for (Element* elem : internalElements) {
-            delete elem;
-        }
-        internalElements.clear();
-    }
-
-    void display() override {
-        std::cout << "Subcircuit " << name << ": connected to nodes " << node1 << " - " << node2
-                  << ", contains " << internalElements.size() << " internal elements." << std::endl;
-    }
+    const std::string& controlName() const { return controlling_name; }
 
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
                   const std::map<int, int>& node_id_to_matrix_idx,
                   int extra_var_start_idx,
                   const Eigen::VectorXd& prev_solution,
-                  double h) override {
+                  double h) override;
+    void stampAC(SmallSignalSystem& sys,
+                 const std::map<int, int>& node_id_to_matrix_idx,
+                 int extra_var_start_idx,
+                 const Eigen::VectorXd& op) const override;
 
-    }
+    void linkControlSource(const std::vector<Element*>& all_elements);
 };
-
 class SinusoidalSource : public Element {
 private:
     double Voffset;
@@ -241,19 +285,29 @@ private:
     double frequency;
     double phase;
     double time;
+    double level;   // waveform value at `time`
 
 public:
     SinusoidalSource(std::string n, int n1, int n2, double voffset, double vamplitude, double freq, double ph = 0.0)
         : Element(n, n1, n2, 0.0, SINUSOIDAL_SOURCE),
           Voffset(voffset), Vamplitude(vamplitude), frequency(freq), phase(ph), time(0.0) {
         introducesExtraVariable = true;
+        level = evaluate(0.0);
     }
 
-    void updateTime(double newTime) { time = newTime; }
+    void updateTime(double newTime) { time = newTime; level = evaluate(newTime); }
+    // For batched updates (SourceRegistry) that computed the value themselves
+    void setWaveform(double newTime, double value) { time = newTime; level = value; }
 
-    double getInstantaneousValue() const {
-        return Voffset + Vamplitude * sin(2 * std::numbers::pi * frequency * time + phase);
+    double getFrequency() const { return frequency; }
+    double getOffset() const { return Voffset; }
+    double getAmplitude() const { return Vamplitude; }
+    double getPhase() const { return phase; }
+
+    double evaluate(double t) const {
+        return Voffset + Vamplitude * sin(2 * std::numbers::pi * frequency * t + phase);
     }
+    double getInstantaneousValue() const { return level; }
 
     void display() override {
         std::cout << "Sinusoidal Source " << name << ": "
@@ -263,6 +317,13 @@ public:
                   << "Nodes: " << node1 << "-" << node2 << std::endl;
     }
 
+    Element* clone() const override { return new SinusoidalSource(*this); }
+
+    void stampAC(SmallSignalSystem& sys,
+                 const std::map<int, int>& node_id_to_matrix_idx,
+                 int extra_var_start_idx,
+                 const Eigen::VectorXd& op) const override;
+
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
                   const std::map<int, int>& node_id_to_matrix_idx,
                   int extra_var_start_idx,
@@ -289,6 +350,7 @@ public:
     double v1, v2, td, tr, tf, pw, per;
 private:
     double time;
+    double level;   // waveform value at `time`
 
 public:
     PulseSource(std::string n, int n1, int n2, double v_initial, double v_pulsed,
@@ -296,17 +358,78 @@ public:
             : Element(n, n1, n2, v_initial, PULSE_SOURCE),
               v1(v_initial), v2(v_pulsed), td(t_delay), tr(t_rise), tf(t_fall), pw(p_width), per(period), time(0.0) {
         introducesExtraVariable = true;
+        level = evaluate(0.0);
     }
 
-    void updateTime(double newTime) { time = newTime; }
-    double getInstantaneousValue() const;
+    void updateTime(double newTime) { time = newTime; level = evaluate(newTime); }
+    void setWaveform(double newTime, double value) { time = newTime; level = value; }
+
+    double evaluate(double t) const;
+    double getInstantaneousValue() const { return level; }
+
+    void display() override;
+    Element* clone() const override { return new PulseSource(*this); }
+    void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
+                  const std::map<int, int>& node_id_to_matrix_idx,
+                  int extra_var_start_idx,
+                  const Eigen::VectorXd& prev_solution,
+                  double h) override;
+    void stampAC(SmallSignalSystem& sys,
+                 const std::map<int, int>& node_id_to_matrix_idx,
+                 int extra_var_start_idx,
+                 const Eigen::VectorXd& op) const override;
+};
+
+class Signal;
+
+// Voltage source that plays a sampled waveform from a Signal file (text, .f32/.f64, .wav),
+// interpolated linearly between samples and held after the last one. The file is streamed
+// one chunk at a time behind a cursor that only moves forward, so memory does not grow with
+// the file; going back in time (a new run) reopens it. Each sample instant is a breakpoint.
+class FileSource : public Element {
+public:
+    FileSource(std::string n, int n1, int n2, std::string path, double Fs, int chunk = 4096);
+    FileSource(const FileSource& other);   // the copy streams the file on its own
+    ~FileSource() override;
+
+    // False if the file cannot be read; the source then stays at 0 V
+    bool open();
+    void updateTime(double newTime);
+    double getInstantaneousValue() const { return level; }
+    // The first sample instant after `t`, or infinity past the last sample
+    double nextBreakpoint(double t) const;
+
+    const std::string& path() const { return file; }
+    double sampleRate() const { return Fs; }
 
     void display() override;
+    Element* clone() const override { return new FileSource(*this); }
     void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
                   const std::map<int, int>& node_id_to_matrix_idx,
                   int extra_var_start_idx,
                   const Eigen::VectorXd& prev_solution,
                   double h) override;
+    void stampAC(SmallSignalSystem& sys,
+                 const std::map<int, int>& node_id_to_matrix_idx,
+                 int extra_var_start_idx,
+                 const Eigen::VectorXd& op) const override;
+
+private:
+    std::string file;
+    double Fs;                  // a WAV file's own rate once opened
+    int chunkSize;
+    std::unique_ptr<Signal> signal;
+
+    // Cursor: samples k and k+1 (yk, yk1) bracket the last time; ended means k is the last one
+    size_t k = 0;
+    double yk = 0.0, yk1 = 0.0;
+    bool ended = true;
+    std::span<const double> chunk;
+    size_t chunkPos = 0;
+    double level = 0.0;
+
+    bool rewind();
+    bool pull(double& y);
 };
 
 #endif //MORGHSPICY_ELEMENTS_H
\ No newline at end of file
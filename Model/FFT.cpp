@@ -0,0 +1,267 @@
+#include "FFT.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+size_t nextPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+namespace {
+    constexpr size_t maxDirectRadix = 64;   // larger prime factors go through Bluestein
+
+    bool isPowerOfTwo(size_t n) { return n && !(n & (n - 1)); }
+
+    // Plain complex product; operator* goes through the NaN/Inf-checking library routine
+    inline std::complex<double> mul(std::complex<double> a, std::complex<double> b) {
+        return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+    }
+}
+
+FFTPlan::FFTPlan(size_t n_) : n(n_), kind(Kind::Radix2) {
+    using std::numbers::pi;
+    if (n < 2) return;
+
+    if (isPowerOfTwo(n)) {
+        int bits = 0;
+        while ((size_t(1) << bits) < n) ++bits;
+        bitrev.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t r = 0;
+            for (int b = 0; b < bits; ++b) if (i & (size_t(1) << b)) r |= uint32_t(1) << (bits - 1 - b);
+            bitrev[i] = r;
+        }
+        // Each stage gets its own contiguous table, computed directly (no recurrence drift)
+        stageRe.resize(n - 1);
+        stageIm.resize(n - 1);
+        for (size_t len = 2; len <= n; len <<= 1) {
+            const size_t half = len / 2;
+            for (size_t k = 0; k < half; ++k) {
+                double ang = -2.0 * pi * static_cast<double>(k) / static_cast<double>(len);
+                stageRe[half - 1 + k] = std::cos(ang);
+                stageIm[half - 1 + k] = std::sin(ang);
+            }
+        }
+        return;
+    }
+
+    size_t rest = n;
+    while (rest % 4 == 0) { factors.push_back(4); rest /= 4; }
+    for (size_t p = 2; p * p <= rest; ++p)
+        while (rest % p == 0) { factors.push_back(p); rest /= p; }
+    if (rest > 1) factors.push_back(rest);
+
+    size_t largest = 0;
+    for (size_t p : factors) largest = std::max(largest, p);
+    if (largest <= maxDirectRadix) {
+        kind = Kind::Mixed;
+        twiddle.resize(n);
+        for (size_t i = 0; i < n; ++i)
+            twiddle[i] = std::polar(1.0, -2.0 * pi * static_cast<double>(i) / static_cast<double>(n));
+        return;
+    }
+
+    kind = Kind::Bluestein;
+    factors.clear();
+    const size_t m = nextPowerOfTwo(2 * n - 1);
+    conv = std::make_unique<FFTPlan>(m);
+    chirp.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        // i^2 mod 2n keeps the angle small for large n
+        size_t sq = (i * i) % (2 * n);
+        chirp[i] = std::polar(1.0, -pi * static_cast<double>(sq) / static_cast<double>(n));
+    }
+    kernelRe.assign(m, 0.0);
+    kernelIm.assign(m, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        kernelRe[i] = chirp[i].real();
+        kernelIm[i] = -chirp[i].imag();
+        if (i > 0) { kernelRe[m - i] = kernelRe[i]; kernelIm[m - i] = kernelIm[i]; }
+    }
+    conv->transform(kernelRe.data(), kernelIm.data());
+}
+
+void FFTPlan::radix2(double* re, double* im) const {
+    for (size_t i = 0; i < n; ++i) {
+        size_t j = bitrev[i];
+        if (i < j) { std::swap(re[i], re[j]); std::swap(im[i], im[j]); }
+    }
+
+    // len = 2 needs no multiplies
+    for (size_t i = 0; i < n; i += 2) {
+        double ur = re[i], ui = im[i];
+        re[i] = ur + re[i + 1]; im[i] = ui + im[i + 1];
+        re[i + 1] = ur - re[i + 1]; im[i + 1] = ui - im[i + 1];
+    }
+
+    for (size_t len = 4; len <= n; len <<= 1) {
+        const size_t half = len / 2;
+        const double* wr = stageRe.data() + half - 1;
+        const double* wi = stageIm.data() + half - 1;
+        for (size_t i = 0; i < n; i += len) {
+            double* ar = re + i;
+            double* ai = im + i;
+            double* br = re + i + half;
+            double* bi = im + i + half;
+            for (size_t k = 0; k < half; ++k) {
+                double vr = br[k] * wr[k] - bi[k] * wi[k];
+                double vi = br[k] * wi[k] + bi[k] * wr[k];
+                br[k] = ar[k] - vr;
+                bi[k] = ai[k] - vi;
+                ar[k] += vr;
+                ai[k] += vi;
+            }
+        }
+    }
+}
+
+// Decimation in time: out[s*m .. s*m+m) holds the DFT of in[s], in[s+p], ... (length m = len/p),
+// then the p-point butterflies combine them in place.
+void FFTPlan::mixed(const std::complex<double>* in, std::complex<double>* out, size_t len,
+                    size_t stride, size_t f) const {
+    using cd = std::complex<double>;
+    if (len == 1) { out[0] = in[0]; return; }
+    const size_t p = factors[f], m = len / p;
+    for (size_t s = 0; s < p; ++s) mixed(in + s * stride, out + s * m, m, stride * p, f + 1);
+
+    const size_t step = n / len;    // twiddle[step * j] = e^{-j 2 pi j / len}
+    if (p == 2) {
+        for (size_t k = 0; k < m; ++k) {
+            cd t = mul(out[k + m], twiddle[step * k]);
+            out[k + m] = out[k] - t;
+            out[k] += t;
+        }
+        return;
+    }
+    if (p == 4) {
+        for (size_t k = 0; k < m; ++k) {
+            cd t0 = out[k];
+            cd t1 = mul(out[k + m], twiddle[step * k]);
+            cd t2 = mul(out[k + 2 * m], twiddle[step * 2 * k]);
+            cd t3 = mul(out[k + 3 * m], twiddle[step * 3 * k]);
+            cd a = t0 + t2, b = t0 - t2, c = t1 + t3;
+            cd e = t1 - t3, d(e.imag(), -e.real());        // -j (t1 - t3)
+            out[k] = a + c;
+            out[k + m] = b + d;
+            out[k + 2 * m] = a - c;
+            out[k + 3 * m] = b - d;
+        }
+        return;
+    }
+    if (p == 3) {
+        const double h = -std::sqrt(3.0) / 2.0;     // Im e^{-j 2 pi / 3}
+        for (size_t k = 0; k < m; ++k) {
+            cd t0 = out[k];
+            cd t1 = mul(out[k + m], twiddle[step * k]);
+            cd t2 = mul(out[k + 2 * m], twiddle[step * 2 * k]);
+            cd s = t1 + t2, e = t1 - t2, d(-h * e.imag(), h * e.real());   // j h (t1 - t2)
+            cd a = t0 - 0.5 * s;
+            out[k] = t0 + s;
+            out[k + m] = a + d;
+            out[k + 2 * m] = a - d;
+        }
+        return;
+    }
+    if (p == 5) {
+        const double c1 = std::cos(2.0 * std::numbers::pi / 5.0), c2 = std::cos(4.0 * std::numbers::pi / 5.0);
+        const double s1 = std::sin(2.0 * std::numbers::pi / 5.0), s2 = std::sin(4.0 * std::numbers::pi / 5.0);
+        for (size_t k = 0; k < m; ++k) {
+            cd t0 = out[k];
+            cd t1 = mul(out[k + m], twiddle[step * k]);
+            cd t2 = mul(out[k + 2 * m], twiddle[step * 2 * k]);
+            cd t3 = mul(out[k + 3 * m], twiddle[step * 3 * k]);
+            cd t4 = mul(out[k + 4 * m], twiddle[step * 4 * k]);
+            cd sa = t1 + t4, sb = t2 + t3, da = t1 - t4, db = t2 - t3;
+            cd a1 = t0 + c1 * sa + c2 * sb, a2 = t0 + c2 * sa + c1 * sb;
+            cd e1 = s1 * da + s2 * db, e2 = s2 * da - s1 * db;
+            cd b1(e1.imag(), -e1.real()), b2(e2.imag(), -e2.real());   // -j e1, -j e2
+            out[k] = t0 + sa + sb;
+            out[k + m] = a1 + b1;
+            out[k + 4 * m] = a1 - b1;
+            out[k + 2 * m] = a2 + b2;
+            out[k + 3 * m] = a2 - b2;
+        }
+        return;
+    }
+
+    cd t[maxDirectRadix];
+    const size_t pstep = n / p;     // twiddle[pstep * j] = e^{-j 2 pi j / p}
+    for (size_t k = 0; k < m; ++k) {
+        for (size_t s = 0; s < p; ++s) t[s] = mul(out[k + s * m], twiddle[step * s * k]);
+        for (size_t q = 0; q < p; ++q) {
+            cd acc = t[0];
+            for (size_t s = 1; s < p; ++s) acc += mul(t[s], twiddle[pstep * ((s * q) % p)]);
+            out[k + q * m] = acc;
+        }
+    }
+}
+
+void FFTPlan::bluestein(double* re, double* im) const {
+    const size_t m = conv->size();
+    std::vector<double> ar(m, 0.0), ai(m, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        std::complex<double> v = mul(std::complex<double>(re[i], im[i]), chirp[i]);
+        ar[i] = v.real();
+        ai[i] = v.imag();
+    }
+    conv->transform(ar.data(), ai.data());
+    for (size_t i = 0; i < m; ++i) {
+        double r = ar[i] * kernelRe[i] - ai[i] * kernelIm[i];
+        double q = ar[i] * kernelIm[i] + ai[i] * kernelRe[i];
+        ar[i] = r;
+        ai[i] = q;
+    }
+    conv->transform(ar.data(), ai.data(), true);
+    const double scale = 1.0 / static_cast<double>(m);
+    for (size_t i = 0; i < n; ++i) {
+        std::complex<double> v = mul(std::complex<double>(ar[i], ai[i]) * scale, chirp[i]);
+        re[i] = v.real();
+        im[i] = v.imag();
+    }
+}
+
+void FFTPlan::transform(double* re, double* im, bool inverse) const {
+    if (n < 2) return;
+    // Inverse through conjugation: IDFT(x) = conj(DFT(conj(x)))
+    if (inverse) for (size_t i = 0; i < n; ++i) im[i] = -im[i];
+
+    switch (kind) {
+        case Kind::Radix2: radix2(re, im); break;
+        case Kind::Bluestein: bluestein(re, im); break;
+        case Kind::Mixed: {
+            std::vector<std::complex<double>> in(n), out(n);
+            for (size_t i = 0; i < n; ++i) in[i] = {re[i], im[i]};
+            mixed(in.data(), out.data(), n, 1, 0);
+            for (size_t i = 0; i < n; ++i) { re[i] = out[i].real(); im[i] = out[i].imag(); }
+            break;
+        }
+    }
+
+    if (inverse) for (size_t i = 0; i < n; ++i) im[i] = -im[i];
+}
+
+void FFTPlan::transform(std::vector<std::complex<double>>& a, bool inverse) const {
+    if (n < 2) return;
+    if (kind == Kind::Mixed) {
+        std::vector<std::complex<double>> in(a);
+        if (inverse) for (auto& v : in) v = std::conj(v);
+        mixed(in.data(), a.data(), n, 1, 0);
+        if (inverse) for (auto& v : a) v = std::conj(v);
+        return;
+    }
+    std::vector<double> re(n), im(n);
+    for (size_t i = 0; i < n; ++i) { re[i] = a[i].real(); im[i] = a[i].imag(); }
+    transform(re.data(), im.data(), inverse);
+    for (size_t i = 0; i < n; ++i) a[i] = {re[i], im[i]};
+}
+
+void fft(std::vector<std::complex<double>>& a, bool inverse) {
+    thread_local std::unique_ptr<FFTPlan> plan;
+    if (a.size() < 2) return;
+    if (!plan || plan->size() != a.size()) plan = std::make_unique<FFTPlan>(a.size());
+    plan->transform(a, inverse);
+}
@@ -0,0 +1,56 @@
+#ifndef MORGHSPICY_FFT_H
+#define MORGHSPICY_FFT_H
+
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// X[k] = sum x[i] e^{-j 2 pi k i / N} for any N. Twiddles and permutations are computed once
+// per plan, so build one plan and reuse it for every transform of that size.
+//  - powers of two: iterative radix-2 on split re/im arrays with one contiguous twiddle
+//    table per stage, so every butterfly loop is unit-stride and vectorizes;
+//  - sizes made of small factors (2, 3, 4, 5, ...): mixed-radix Cooley-Tukey;
+//  - sizes with a large prime factor: Bluestein's chirp-z on a power-of-two plan.
+// inverse = true uses e^{+j...} and is not scaled (divide by N yourself).
+class FFTPlan {
+public:
+    explicit FFTPlan(size_t n);
+
+    size_t size() const { return n; }
+
+    void transform(double* re, double* im, bool inverse = false) const;
+    void transform(std::vector<std::complex<double>>& a, bool inverse = false) const;
+
+private:
+    enum class Kind { Radix2, Mixed, Bluestein };
+    size_t n;
+    Kind kind;
+
+    // Radix2
+    std::vector<uint32_t> bitrev;
+    std::vector<double> stageRe, stageIm;      // stage len: entries [len/2 - 1, len - 1)
+
+    // Mixed
+    std::vector<size_t> factors;
+    std::vector<std::complex<double>> twiddle; // e^{-j 2 pi i / n}, i < n
+
+    // Bluestein
+    std::unique_ptr<FFTPlan> conv;             // power of two >= 2n - 1
+    std::vector<std::complex<double>> chirp;   // e^{-j pi i^2 / n}
+    std::vector<double> kernelRe, kernelIm;    // FFT of the conjugate chirp
+
+    void radix2(double* re, double* im) const;
+    void mixed(const std::complex<double>* in, std::complex<double>* out, size_t len,
+               size_t stride, size_t f) const;
+    void bluestein(double* re, double* im) const;
+};
+
+// Convenience for one-off transforms; keeps the last plan per thread
+void fft(std::vector<std::complex<double>>& a, bool inverse = false);
+
+size_t nextPowerOfTwo(size_t n);
+
+#endif //MORGHSPICY_FFT_H
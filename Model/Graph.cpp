@@ -4,8 +4,13 @@
 
 #include "Graph.h"
 #include "NodeManager.h"
+#include "Topology.h"
 
 void Graph::canonicalizeNodes(const NodeManager& nm) {
+    if (!nodesDirty && canonicalRevision == nm.revision()) return;
+    nodesDirty = false;
+    canonicalRevision = nm.revision();
+
     // Update all element node indices to their canonical reps in NodeManager
     for (auto& e : elements) {                 // adjust if your container is different
         if (!e) continue;
@@ -21,3 +26,74 @@ void Graph::canonicalizeNodes(const NodeManager& nm) {
 //        if (el->c2 != -1) el->c2 = nm.canonical(el->c2);
     }
 }
+
+size_t Graph::findName(std::string_view name) const {
+    if (nameSlots.empty()) return NO_POS;
+    const size_t hash = nameHash(name);
+    const size_t mask = nameSlots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const NameSlot& s = nameSlots[i];
+        if (s.pos == NO_POS) return NO_POS;
+        if (s.hash == hash && elements[s.pos]->name == name) return i;
+    }
+}
+
+void Graph::indexName(size_t pos) {
+    if (2 * (indexedNames + 1) > nameSlots.size()) reserveNames(indexedNames + 1);
+    const std::string& name = elements[pos]->name;
+    const size_t hash = nameHash(name);
+    const size_t mask = nameSlots.size() - 1;
+    size_t i = hash & mask;
+    for (; nameSlots[i].pos != NO_POS; i = (i + 1) & mask) {
+        if (nameSlots[i].hash == hash && elements[nameSlots[i].pos]->name == name) {
+            ++sharedNames;
+            return;
+        }
+    }
+    nameSlots[i] = NameSlot{hash, pos};
+    ++indexedNames;
+}
+
+void Graph::unindexSlot(size_t slot) {
+    // Backward-shift deletion: pull later entries of the cluster into the hole when it lies
+    // between their home slot and where they sit, so lookups never need tombstones
+    const size_t mask = nameSlots.size() - 1;
+    size_t hole = slot;
+    for (size_t i = (hole + 1) & mask; nameSlots[i].pos != NO_POS; i = (i + 1) & mask) {
+        const size_t home = nameSlots[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            nameSlots[hole] = nameSlots[i];
+            hole = i;
+        }
+    }
+    nameSlots[hole].pos = NO_POS;
+    --indexedNames;
+}
+
+void Graph::reserveNames(size_t names) {
+    size_t size = 64;
+    while (size < 2 * names) size *= 2;
+    if (size <= nameSlots.size()) return;
+    std::vector<NameSlot> old(size, NameSlot{0, NO_POS});
+    old.swap(nameSlots);
+    const size_t mask = size - 1;
+    for (const NameSlot& s : old) {
+        if (s.pos == NO_POS) continue;
+        size_t i = s.hash & mask;
+        while (nameSlots[i].pos != NO_POS) i = (i + 1) & mask;
+        nameSlots[i] = s;
+    }
+}
+
+void Graph::rebuildIndex() {
+    std::fill(nameSlots.begin(), nameSlots.end(), NameSlot{0, NO_POS});
+    indexedNames = 0;
+    sharedNames = 0;
+    reserveNames(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i) indexName(i);
+}
+
+bool Graph::isConnected() const {
+    if (elements.empty()) return false;
+    return checkTopology(*this).islands.empty();
+}
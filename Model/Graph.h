@@ -6,46 +6,117 @@
 #define MORGHSPICY_GRAPH_H
 
 #include <stack>
+#include <unordered_map>
+#include <unordered_set>
 #include "NodeManager.h"
 #include "Common_Includes.h"
 #include "Node.h"
 #include "Edge.h"
 #include "Elements.h"
+#include "SourceRegistry.h"
+#include "CircuitArena.h"
 
 class NodeManager;
 
 class Graph {
 private:
+    // Backing store for elements/nodes/edges made with make<T>(); heap-allocated ones
+    // (clones, reduced models) can still be added and are deleted as before
+    CircuitArena arena;
+
     std::vector<Node*> nodes;
     std::vector<Edge*> edges;
 
+    // Time-varying sources, rebuilt on the next update after the element list changes
+    SourceRegistry sources;
+    bool sourcesDirty = true;
+
+    SourceRegistry& timeSources() {
+        if (sourcesDirty) {
+            sources.build(elements);
+            sourcesDirty = false;
+        }
+        return sources;
+    }
+
+    // Node ids are canonical as of this NodeManager revision unless an element was added since
+    bool nodesDirty = true;
+    unsigned long canonicalRevision = 0;
+
+    // Element name -> position in `elements`. With repeated names (unchecked subcircuit
+    // expansion) the first one wins, as with the old linear search; sharedNames counts
+    // them so a removal knows when it has to look for the next holder of the name.
+    // Open addressing over (hash, position) with linear probing: the names stay in the
+    // elements, so indexing one costs a hash and a probe, not a node and a string copy.
+    struct NameSlot { size_t hash; size_t pos; };
+    static constexpr size_t NO_POS = static_cast<size_t>(-1);
+    std::vector<NameSlot> nameSlots;     // power-of-two size, at most half full, pos NO_POS = empty
+    size_t indexedNames = 0;
+    size_t sharedNames = 0;
+
+    static size_t nameHash(std::string_view name) { return std::hash<std::string_view>{}(name); }
+    size_t findName(std::string_view name) const;       // slot of the name, or NO_POS
+    void indexName(size_t pos);                         // elements[pos] by its name, unless taken
+    void unindexSlot(size_t slot);
+    void reserveNames(size_t names);
+    void rebuildIndex();
+
+    template <class T>
+    void destroy(T* p) {
+        if (arena.owns(p)) p->~T();
+        else delete p;
+    }
+
 public:
     std::vector<Element*> elements;
 
     Graph() = default;
 
     ~Graph() {
-        // Delete all Node objects pointed to
-        for (Node* node_ptr : nodes) {
-            delete node_ptr;
-        }
+        // Arena objects are destroyed in place; their memory goes with the arena, chunk by chunk
+        for (Node* node_ptr : nodes) destroy(node_ptr);
         nodes.clear();
 
-        // Delete all Edge objects pointed to
-        for (Edge* edge_ptr : edges) {
-            delete edge_ptr;
-        }
+        for (Edge* edge_ptr : edges) destroy(edge_ptr);
         edges.clear();
 
-        // Delete all Element objects pointed to
-        for (Element* elem_ptr : elements) {
-            delete elem_ptr;
-        }
+        for (Element* elem_ptr : elements) destroy(elem_ptr);
         elements.clear();
     }
 
+    // Allocates an element (or Node/Edge) in this circuit's arena; it still has to be
+    // added with addElement/addNode/addEdge, after which the graph owns it
+    template <class T, class... Args>
+    T* make(Args&&... args) {
+        return arena.make<T>(std::forward<Args>(args)...);
+    }
+
+    // Rewrites element node ids to their DSU representatives. Cheap when nothing changed, so
+    // analyses call it up front instead of every connect/label command doing it.
     void canonicalizeNodes(const NodeManager& nm);
 
+    // Scope for loaders adding many elements and connections in one go: reserves room up
+    // front, and when it ends points labels straight at their nodes and canonicalizes once
+    class BulkEdit {
+    public:
+        BulkEdit(Graph& g, NodeManager& nm, size_t expectedElements = 0) : g(g), nm(nm) {
+            if (expectedElements) {
+                g.elements.reserve(g.elements.size() + expectedElements);
+                g.reserveNames(g.elements.size() + expectedElements);
+                nm.reserve(expectedElements);
+            }
+        }
+        ~BulkEdit() {
+            nm.rebuildLabelTable();
+            g.canonicalizeNodes(nm);
+        }
+        BulkEdit(const BulkEdit&) = delete;
+        BulkEdit& operator=(const BulkEdit&) = delete;
+    private:
+        Graph& g;
+        NodeManager& nm;
+    };
+
     void displayElementsByType(const std::string& type_filter) {
         std::cout << "Elements of type '" << type_filter << "' in the graph:\n";
         char filter_char = toupper(type_filter[0]);
@@ -62,69 +133,31 @@ public:
     }
 
     void updateTimeDependentSources(double time) {
-        for (Element* elem : elements) {
-            // Attempt to cast to each type of time-dependent source
-            if (auto* pulse_src = dynamic_cast<PulseSource*>(elem)) {
-                pulse_src->updateTime(time);
-            } else if (auto* sin_src = dynamic_cast<SinusoidalSource*>(elem)) {
-                sin_src->updateTime(time);
-            }
-        }
+        timeSources().update(time);
     }
 
-    bool isConnected() const {
-        if (nodes.empty() || elements.empty()) {
-            return false; // An empty or element-less circuit is not considered validly connected
-        }
-
-        std::map<int, std::vector<int>> adj;
-        for (const auto* elem : elements) {
-            adj[elem->node1].push_back(elem->node2);
-            adj[elem->node2].push_back(elem->node1);
-        }
-
-        std::set<int> visited;
-        std::stack<int> stack;
-
-        stack.push(0);
-
-        while (!stack.empty()) {
-            int u = stack.top();
-            stack.pop();
-
-            if (visited.find(u) == visited.end()) {
-                visited.insert(u);
-                if (adj.count(u)) {
-                    for (int v : adj.at(u)) {
-                        if (visited.find(v) == visited.end()) {
-                            stack.push(v);
-                        }
-                    }
-                }
-            }
-        }
-
-        for (const auto& pair : adj) {
-            if (visited.find(pair.first) == visited.end()) {
-                return false; // A node was not reached, so the graph is disconnected
-            }
-        }
-
-        return true;
+    // Where a transient step starting at `time` must stop at the latest (see SourceRegistry)
+    double nextBreakpoint(double time) {
+        return timeSources().nextBreakpoint(time);
     }
 
+    // True when every element has a path to ground (see checkTopology for the full report)
+    bool isConnected() const;
+
     // Add Node
     void addNode(Node* node) {
         nodes.push_back(node);
     }
 
     Element* findElement(const std::string& name) const {
-        for (Element* elem_ptr : elements) {
-            if (elem_ptr->name == name) {
-                return elem_ptr;
-            }
-        }
-        return nullptr;
+        size_t slot = findName(name);
+        return slot == NO_POS ? nullptr : elements[nameSlots[slot].pos];
+    }
+
+    // Position of the named element in getElements(), or -1
+    int indexOf(const std::string& name) const {
+        size_t slot = findName(name);
+        return slot == NO_POS ? -1 : static_cast<int>(nameSlots[slot].pos);
     }
 
     // Add Edge
@@ -135,6 +168,9 @@ public:
     // Add Element
     void addElement(Element* elem) {
         elements.push_back(elem);
+        indexName(elements.size() - 1);
+        sourcesDirty = true;
+        nodesDirty = true;
     }
 
     // Element Getter
@@ -159,23 +195,39 @@ public:
         }
     }
 
+    // Deletes every element in `doomed` in one pass over the list (bulk edits like model reduction)
+    void removeElements(const std::unordered_set<Element*>& doomed) {
+        sourcesDirty = true;
+        std::erase_if(elements, [&](Element* e) {
+            if (!doomed.count(e)) return false;
+            destroy(e);
+            return true;
+        });
+        rebuildIndex();
+    }
+
     //deleting an element by its name(used in command handler)
+    // The last element is moved into the hole, so the order of the others may change.
     bool removeElementByName(const std::string& name) {
-        for (auto it = elements.begin(); it != elements.end(); ++it) {
-            if ((*it)->name == name) {
-                delete *it; // 1. Deallocate the Element object's memory
-
-                // 2. Erase the pointer from the vector and get the next valid iterator
-                // This is the correct way to erase while iterating.
-                elements.erase(it);
-
-                std::cout << "Element '" << name << "' removed." << std::endl;
-                return true; // Exit the loop and function immediately
-            }
+        const size_t slot = findName(name);
+        if (slot == NO_POS) {
+            // This message is part of the calling function in CommandParser
+            return false;
+        }
+        const size_t pos = nameSlots[slot].pos;
+        unindexSlot(slot);
+        destroy(elements[pos]);
+        if (pos + 1 != elements.size()) {
+            elements[pos] = elements.back();
+            const size_t moved = findName(elements[pos]->name);
+            if (moved != NO_POS && nameSlots[moved].pos == elements.size() - 1) nameSlots[moved].pos = pos;
         }
-        // This message is now part of the calling function in CommandParser
-        // std::cerr << "Element '" << name << "' not found." << std::endl;
-        return false;
+        elements.pop_back();
+        sourcesDirty = true;
+        if (sharedNames) rebuildIndex();   // another element may carry the same name
+
+        std::cout << "Element '" << name << "' removed." << std::endl;
+        return true;
     }
 
 };
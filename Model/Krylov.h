@@ -0,0 +1,76 @@
+#ifndef MORGHSPICY_KRYLOV_H
+#define MORGHSPICY_KRYLOV_H
+
+#pragma once
+#include <eigen3/Eigen/Dense>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+// Restarted, right-preconditioned GMRES for operators that are only available as a product
+// (matrix-free Newton-Krylov). `apply(v)` returns A*v, `precondition(v)` returns ~A^-1 * v.
+// Solves A x = b starting from x; returns the number of operator products used, or -1 when
+// the residual did not drop below tol * ||b|| within maxProducts.
+template <typename Vector>
+int gmres(const std::function<Vector(const Vector&)>& apply,
+          const std::function<Vector(const Vector&)>& precondition,
+          const Vector& b, Vector& x, double tol, int maxProducts, int restart = 30) {
+    using Scalar = typename Vector::Scalar;
+    using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+    const double bnorm = b.norm();
+    if (bnorm == 0.0) { x.setZero(b.size()); return 0; }
+    if (x.size() != b.size()) x.setZero(b.size());
+
+    int products = 0;
+    while (products < maxProducts) {
+        Vector r = b - apply(x);
+        ++products;
+        double beta = r.norm();
+        if (beta <= tol * bnorm) return products;
+
+        const int m = restart;
+        Matrix V(b.size(), m + 1), H = Matrix::Zero(m + 1, m);
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> g = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>::Zero(m + 1);
+        std::vector<Scalar> cs(m), sn(m);
+        V.col(0) = r / beta;
+        g(0) = beta;
+
+        int j = 0;
+        for (; j < m && products < maxProducts; ++j) {
+            Vector w = apply(precondition(V.col(j)));
+            ++products;
+            // Modified Gram-Schmidt
+            for (int i = 0; i <= j; ++i) {
+                H(i, j) = V.col(i).dot(w);
+                w -= H(i, j) * V.col(i);
+            }
+            H(j + 1, j) = w.norm();
+            if (std::abs(H(j + 1, j)) > 0.0) V.col(j + 1) = w / H(j + 1, j);
+
+            // Apply the previous rotations, then a new one to zero H(j+1, j)
+            for (int i = 0; i < j; ++i) {
+                Scalar t = Eigen::numext::conj(cs[i]) * H(i, j) + Eigen::numext::conj(sn[i]) * H(i + 1, j);
+                H(i + 1, j) = -sn[i] * H(i, j) + cs[i] * H(i + 1, j);
+                H(i, j) = t;
+            }
+            double den = std::sqrt(std::norm(H(j, j)) + std::norm(H(j + 1, j)));
+            if (den == 0.0) { cs[j] = 1.0; sn[j] = 0.0; }
+            else { cs[j] = H(j, j) / den; sn[j] = H(j + 1, j) / den; }
+            H(j, j) = den;
+            H(j + 1, j) = 0.0;
+            g(j + 1) = -sn[j] * g(j);
+            g(j) = Eigen::numext::conj(cs[j]) * g(j);
+
+            if (std::abs(g(j + 1)) <= tol * bnorm) { ++j; break; }
+        }
+
+        // x += M^-1 V y with H y = g (upper triangular)
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> y =
+                H.topLeftCorner(j, j).template triangularView<Eigen::Upper>().solve(g.head(j));
+        x += precondition(V.leftCols(j) * y);
+        if (std::abs(g(j)) <= tol * bnorm) return products;
+    }
+    return -1;
+}
+
+#endif //MORGHSPICY_KRYLOV_H
@@ -8,6 +8,7 @@
 #include "MNASolver.h"
 #include "Graph.h"
 #include "Elements.h"
+#include "Subcircuit.h"
 #include "Node.h"
 #include "Common_Includes.h"
 
@@ -25,11 +26,9 @@ void MNASolver::constructMNAMatrix(const Graph& circuitGraph, double timestep_h,
     A_matrix.setZero();
     b_vector.setZero();
 
-    const std::vector<Element*>& all_elements_in_graph = circuitGraph.getElements();
-    for (Element* elem_ptr : all_elements_in_graph) {
-        elem_ptr->stampMNA(A_matrix, b_vector, node_id_to_matrix_idx,
-                           getExtraVariableStartIndex(), prev_solution, timestep_h);
-    }
+    if (!compiled.isCompiledFor(circuitGraph))
+        compiled.compile(circuitGraph, node_id_to_matrix_idx, getExtraVariableStartIndex());
+    compiled.stamp(A_matrix, b_vector, prev_solution, timestep_h);
     const double GMIN = 1e-12; // use 1e-9 only if you still see singular matrices
     for (int i = 0; i < num_non_ground_nodes; ++i) {
         A_matrix(i, i) += gmin;
@@ -38,23 +37,46 @@ void MNASolver::constructMNAMatrix(const Graph& circuitGraph, double timestep_h,
 }
 
 Eigen::VectorXd MNASolver::solve() {
+    last_solve_ok = false;
     if (total_unknowns == 0) {
         std::cerr << "Error: Cannot solve. Total unknowns is zero." << std::endl;
         solution_vector.setZero();
         return solution_vector;
     }
 
-    if (!A_matrix.fullPivLu().isInvertible()) {
-        std::cerr << "Error: Circuit matrix is singular (not invertible). Cannot solve." << std::endl;
+    // One factorization decides solvability: rcond() estimates the reciprocal condition
+    // number from these same LU factors in O(n^2), with the threshold fullPivLu used.
+    // The estimate can miss an exactly zero pivot (two parallel sources give 0.5), so
+    // that is checked too. Columns are not permuted by partial pivoting, so the smallest
+    // pivot of U points at the unknown that the preceding ones already determine
+    lu_factor.compute(A_matrix);
+    const double rcond = lu_factor.rcond();
+    Eigen::Index k = 0;
+    const double minPivot = lu_factor.matrixLU().diagonal().cwiseAbs().minCoeff(&k);
+    if (!(rcond > total_unknowns * Eigen::NumTraits<double>::epsilon()) || !(minPivot > 0.0)) {
+        std::cerr << "Error: Circuit matrix is singular (";
+        if (minPivot > 0.0) std::cerr << "rcond " << rcond; else std::cerr << "zero pivot";
+        std::cerr << "). Cannot solve." << std::endl;
+        reportSingular({static_cast<int>(k)}, "Not determined by the other unknowns");
         solution_vector.setZero(); // Return zero vector to indicate failure
         return solution_vector;
     }
 
-    solution_vector = A_matrix.lu().solve(b_vector);
+    solution_vector = lu_factor.solve(b_vector);
+    last_solve_ok = true;
+    for (Subcircuit* s : condensed) s->commit(solution_vector, node_id_to_matrix_idx);
 //    std::cout << "MNA System solved." << std::endl;
     return solution_vector;
 }
 
+Eigen::VectorXd MNASolver::solveTransposed(const Eigen::VectorXd& rhs) const {
+    return lu_factor.transpose().solve(rhs);
+}
+
+Eigen::VectorXd MNASolver::solveWith(const Eigen::VectorXd& rhs) const {
+    return lu_factor.solve(rhs);
+}
+
 // Display methods
 void MNASolver::displayMatrix() const {
     std::cout << "\n--- MNA Matrix (A) ---" << std::endl;
@@ -84,7 +106,13 @@ void MNASolver::displayNodeVoltages() const {
         }
     }
 }
-void MNASolver::initializeMatrix(const Graph& circuitGraph) {
+
+void MNASolver::setGmin(double g) {
+    gmin = g;
+    for (Subcircuit* s : subcircuits) s->gmin = g;
+}
+
+void MNASolver::initializeMatrix(const Graph& circuitGraph, bool condenseSubcircuits) {
     // 1. Identify all unique non-ground nodes from the graph.
     std::set<int> unique_node_ids;
     const std::vector<Node*>& all_nodes_in_graph = circuitGraph.getNodes();
@@ -134,12 +162,22 @@ void MNASolver::initializeMatrix(const Graph& circuitGraph) {
     // This step is necessary before counting extra variables.
     const std::vector<Element*>& all_elements = circuitGraph.getElements();
 
-
+    subcircuits.clear();
+    condensed.clear();
+    for (Element* e : all_elements) {
+        if (e->type != SUBCIRCUIT) continue;
+        auto* sub = static_cast<Subcircuit*>(e);
+        sub->gmin = gmin;
+        subcircuits.push_back(sub);
+        sub->setCondensed(condenseSubcircuits && sub->def->linear());
+        if (sub->condensed) condensed.push_back(sub);
+    }
 
     int num_extra_vars = 0;
     for (Element* elem : all_elements) {
         if (elem->introducesExtraVariable) {
-            elem->extraVariableIndex = num_extra_vars++;
+            elem->extraVariableIndex = num_extra_vars;
+            num_extra_vars += elem->extraVariableCount();
         }
     }
 
@@ -164,6 +202,14 @@ void MNASolver::initializeMatrix(const Graph& circuitGraph) {
         return;
     }
 
+    compiled.compile(circuitGraph, node_id_to_matrix_idx, getExtraVariableStartIndex());
+
+    row_node_id = sorted_non_ground_node_ids;
+    extra_owner.assign(num_extra_vars, nullptr);
+    for (const Element* elem : all_elements)
+        if (elem->introducesExtraVariable)
+            for (int k = 0; k < elem->extraVariableCount(); ++k) extra_owner[elem->extraVariableIndex + k] = elem;
+
     // 7. Resize matrices to the correct dimensions and initialize with zeros.
     A_matrix.resize(total_unknowns, total_unknowns);
     b_vector.resize(total_unknowns);
@@ -173,6 +219,113 @@ void MNASolver::initializeMatrix(const Graph& circuitGraph) {
     std::cerr << "[init] nodes(non-ground): " << unique_node_ids.size()
               << ", total_unknowns: " << total_unknowns << "\n";
 
+    analyzeStructure(circuitGraph);
+}
+
+std::string MNASolver::unknownName(int idx) const {
+    if (idx < 0 || idx >= total_unknowns) return "?";
+    if (idx < num_non_ground_nodes) {
+        const int id = row_node_id[idx];
+        std::string label = node_namer ? node_namer(id) : std::string{};
+        return "V(" + (label.empty() ? std::to_string(id) : label) + ")";
+    }
+    const int k = idx - num_non_ground_nodes;
+    const Element* owner = extra_owner[k];
+    if (!owner) return "x" + std::to_string(idx);
+    if (owner->extraVariableCount() == 1) return "I(" + owner->name + ")";
+    return owner->name + "[" + std::to_string(k - owner->extraVariableIndex) + "]";
+}
+
+void MNASolver::reportSingular(const std::vector<int>& unknowns, const char* what) const {
+    constexpr size_t MAX_NAMES = 8;
+    std::cerr << "  " << what << ": ";
+    for (size_t i = 0; i < unknowns.size() && i < MAX_NAMES; ++i)
+        std::cerr << (i ? ", " : "") << unknownName(unknowns[i]);
+    if (unknowns.size() > MAX_NAMES) std::cerr << ", ... (" << unknowns.size() << " in all)";
+    std::cerr << std::endl;
+}
+
+// Rank bound by maximum bipartite matching of equations (rows) to unknowns (columns) on
+// the nonzeros of one DC stamp, done once per layout. The pattern comes from the stamped
+// values, so a zero gain or an exact cancellation drops an entry: a deficit here only
+// says this DC matrix is singular, and solve() still makes the call from its own LU.
+// Unknowns reachable by alternating paths from an unmatched column are the ones the
+// equations cannot pin down (Dulmage-Mendelsohn), and are named in the report.
+void MNASolver::analyzeStructure(const Graph& circuitGraph) {
+    const int n = total_unknowns;
+    if (n == 0) return;
+
+    constructMNAMatrix(circuitGraph, 1e12, Eigen::VectorXd::Zero(n));
+    std::vector<int> rowStart(n + 1, 0), colStart(n + 1, 0);
+    std::vector<int> rowCols, colRows;
+    for (int c = 0; c < n; ++c)
+        for (int r = 0; r < n; ++r)
+            if (A_matrix(r, c) != 0.0) { ++rowStart[r + 1]; ++colStart[c + 1]; }
+    for (int i = 0; i < n; ++i) { rowStart[i + 1] += rowStart[i]; colStart[i + 1] += colStart[i]; }
+    rowCols.resize(rowStart[n]);
+    colRows.resize(colStart[n]);
+    {
+        std::vector<int> rf(rowStart.begin(), rowStart.end() - 1), cf(colStart.begin(), colStart.end() - 1);
+        for (int c = 0; c < n; ++c)
+            for (int r = 0; r < n; ++r)
+                if (A_matrix(r, c) != 0.0) { rowCols[rf[r]++] = c; colRows[cf[c]++] = r; }
+    }
+    A_matrix.setZero();
+    b_vector.setZero();
+
+    // Greedy pass, then augmenting paths from each unmatched row (iterative DFS)
+    std::vector<int> colMatch(n, -1), rowMatch(n, -1), seen(n, -1);
+    for (int r = 0; r < n; ++r)
+        for (int k = rowStart[r]; k < rowStart[r + 1]; ++k)
+            if (colMatch[rowCols[k]] < 0) { colMatch[rowCols[k]] = r; rowMatch[r] = rowCols[k]; break; }
+
+    std::vector<int> stackRow, stackPos, via;
+    for (int r0 = 0; r0 < n; ++r0) {
+        if (rowMatch[r0] >= 0) continue;
+        stackRow.assign(1, r0);
+        stackPos.assign(1, rowStart[r0]);
+        via.clear();
+        bool found = false;
+        while (!stackRow.empty() && !found) {
+            const int r = stackRow.back();
+            int& k = stackPos.back();
+            if (k == rowStart[r + 1]) { stackRow.pop_back(); stackPos.pop_back(); if (!via.empty()) via.pop_back(); continue; }
+            const int c = rowCols[k++];
+            if (seen[c] == r0) continue;
+            seen[c] = r0;
+            via.push_back(c);
+            if (colMatch[c] < 0) { found = true; break; }
+            stackRow.push_back(colMatch[c]);
+            stackPos.push_back(rowStart[colMatch[c]]);
+        }
+        if (!found) continue;
+        // via[i] is the column taken from stackRow[i]; flip the path
+        for (size_t i = 0; i < via.size(); ++i) {
+            colMatch[via[i]] = stackRow[i];
+            rowMatch[stackRow[i]] = via[i];
+        }
+    }
+
+    std::vector<int> unmatched;
+    for (int c = 0; c < n; ++c)
+        if (colMatch[c] < 0) unmatched.push_back(c);
+    if (unmatched.empty()) return;
+
+    std::vector<char> reached(n, 0);
+    std::vector<int> undetermined, queue = unmatched;
+    for (int c : unmatched) reached[c] = 1;
+    for (size_t q = 0; q < queue.size(); ++q) {
+        const int c = queue[q];
+        undetermined.push_back(c);
+        for (int k = colStart[c]; k < colStart[c + 1]; ++k) {
+            const int next = rowMatch[colRows[k]];
+            if (next >= 0 && !reached[next]) { reached[next] = 1; queue.push_back(next); }
+        }
+    }
+    std::sort(undetermined.begin(), undetermined.end());
+    std::cerr << "Warning: DC circuit matrix has rank at most " << n - static_cast<int>(unmatched.size())
+              << " of " << n << " (no matching on its nonzero entries)." << std::endl;
+    reportSingular(undetermined, "Unknowns the equations cannot determine");
 }
 void MNASolver::displayElementCurrents(const Graph& circuitGraph) const {
     std::cout << "\n--- Element Currents (from extra variables) ---" << std::endl;
@@ -6,16 +6,22 @@
 
 #include <eigen3/Eigen/Dense>
 #include <complex>
+#include <functional>
 #include <map>
+#include <string>
+#include <vector>
+#include "CompiledCircuit.h"
 
 class Graph;
-class Elements;
+class Element;
+class Subcircuit;
 
 class MNASolver {
 private:
     Eigen::MatrixXd A_matrix;        // The MNA matrix
     Eigen::VectorXd b_vector;        // RHS
     Eigen::VectorXd solution_vector; // node voltages + extra currents
+    Eigen::PartialPivLU<Eigen::MatrixXd> lu_factor; // factorization behind the last successful solve
 
     int num_ground_nodes{};
     int num_non_ground_nodes{};
@@ -24,15 +30,32 @@ private:
     int total_unknowns{};
 
     std::map<int, int> node_id_to_matrix_idx;
+    CompiledCircuit compiled;        // per-type stamping kernels, rebuilt by initializeMatrix
 
     double gmin = 1e-12;
     bool   skipDC = false;
+    bool   last_solve_ok = false; // false after a singular / empty solve
+
+    // Who owns each row/column, for diagnostics: node id per node row, element per extra variable
+    std::vector<int> row_node_id;
+    std::vector<const Element*> extra_owner;
+    std::function<std::string(int)> node_namer;
+
+    // Every subcircuit instance of the layout, which stamps gmin on its internal nodes too
+    std::vector<Subcircuit*> subcircuits;
+    // Instances stamped as port macromodels; they take their interior state from each solve
+    std::vector<Subcircuit*> condensed;
+
+    void analyzeStructure(const Graph& circuitGraph);
+    void reportSingular(const std::vector<int>& unknowns, const char* what) const;
 public:
     MNASolver();
     ~MNASolver() = default;
 
-    // 1) Matrix initialization
-    void initializeMatrix(const Graph& circuitGraph);
+    // 1) Matrix initialization. With condenseSubcircuits, instances of linear subcircuits
+    // add no unknowns and stamp only their ports (stampMNA analyses: their interior is
+    // eliminated per timestep, which AC's G + jwC split cannot express)
+    void initializeMatrix(const Graph& circuitGraph, bool condenseSubcircuits = false);
 
     // 2) Build the MNA system for a timestep
     void constructMNAMatrix(const Graph& circuitGraph, double timestep_h,
@@ -41,6 +64,11 @@ public:
     // 3) Solve
     Eigen::VectorXd solve();
 
+    // Solve A^T y = rhs with the factorization of the last successful solve() (adjoint analyses)
+    Eigen::VectorXd solveTransposed(const Eigen::VectorXd& rhs) const;
+    // Another right-hand side against the same factorization
+    Eigen::VectorXd solveWith(const Eigen::VectorXd& rhs) const;
+
     // Accessors
     const Eigen::VectorXd& getSolution() const { return solution_vector; }
     int getNumNonGroundNodes() const { return num_non_ground_nodes; }
@@ -51,6 +79,11 @@ public:
 
     int getExtraVariableStartIndex() const { return num_non_ground_nodes; }
 
+    // "V(<node>)" or "I(<element>)" for a row/column of the system
+    std::string unknownName(int idx) const;
+    // Node labels for diagnostics (default: the numeric id)
+    void setNodeNamer(std::function<std::string(int)> f) { node_namer = std::move(f); }
+
     // Debug
     void displayMatrix() const;
     void displaySolution() const;
@@ -58,7 +91,9 @@ public:
     void displayElementCurrents(const Graph& circuitGraph) const;
 
     bool hasUnknowns() const { return total_unknowns > 0; }
-    void setGmin(double g)   { gmin = g; }
+    bool lastSolveSucceeded() const { return last_solve_ok; }
+    void setGmin(double g);
+    double getGmin() const   { return gmin; }
     void setSkipDC(bool s)   { skipDC = s; }
 };
 
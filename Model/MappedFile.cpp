@@ -0,0 +1,88 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER size{};
+        if (GetFileSizeEx(file, &size)) {
+            open = true;
+            length = static_cast<std::size_t>(size.QuadPart);
+            if (length == 0) { CloseHandle(file); return; }
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                // The view keeps the mapping alive after both handles are closed
+                bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(mapping);
+                mapped = bytes != nullptr;
+            }
+        }
+        CloseHandle(file);
+        if (mapped) return;
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st{};
+        if (::fstat(fd, &st) == 0) {
+            open = true;
+            length = static_cast<std::size_t>(st.st_size);
+            if (length == 0) { ::close(fd); return; }
+            void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ::madvise(p, length, MADV_SEQUENTIAL);
+                bytes = static_cast<const char*>(p);
+                mapped = true;
+            }
+        }
+        ::close(fd);
+        if (mapped) return;
+    }
+#endif
+    // Not mappable (a pipe, say): read it whole
+    std::ifstream in(path, std::ios::binary);
+    open = in.is_open();
+    if (!open) { length = 0; return; }
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    bytes = buffer.data();
+    length = buffer.size();
+}
+
+MappedFile::~MappedFile() {
+    if (!mapped) return;
+#ifdef _WIN32
+    UnmapViewOfFile(bytes);
+#else
+    ::munmap(const_cast<char*>(bytes), length);
+#endif
+}
+
+void MappedFile::releaseBefore(std::size_t offset) const {
+    if (!mapped) return;
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const std::size_t bytesToRelease = (std::min)(offset, length) / info.dwPageSize * info.dwPageSize;   // windows.h min macro
+    // Unlocking pages that are not locked takes them out of the working set
+    if (bytesToRelease) VirtualUnlock(const_cast<char*>(bytes), bytesToRelease);
+#else
+    const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t bytesToRelease = std::min(offset, length) / page * page;
+    if (bytesToRelease) ::madvise(const_cast<char*>(bytes), bytesToRelease, MADV_DONTNEED);
+#endif
+}
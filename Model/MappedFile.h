@@ -0,0 +1,35 @@
+#ifndef MORGHSPICY_MAPPEDFILE_H
+#define MORGHSPICY_MAPPEDFILE_H
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of a whole file. The file is memory-mapped (mmap / MapViewOfFile), so
+// parsers work on its bytes in place; if mapping fails it is read into a buffer instead.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return open; }
+    const char* data() const { return bytes; }
+    std::size_t size() const { return length; }
+    std::string_view view() const { return {bytes, length}; }
+    // Lets the OS drop the resident pages that lie wholly before `offset`; they are read back
+    // from the file if touched again. For readers that stream through a file once.
+    void releaseBefore(std::size_t offset) const;
+
+private:
+    const char* bytes = nullptr;
+    std::size_t length = 0;
+    bool open = false;
+    bool mapped = false;
+    std::vector<char> buffer;   // fallback copy
+};
+
+#endif //MORGHSPICY_MAPPEDFILE_H
@@ -1,33 +1,79 @@
 #include "NodeManager.h"
 #include <cstdlib>
 #include <algorithm>
+#include <charconv>
 #include <iostream>
-#include <unordered_set>
-#include <cstdlib>
-
-static int nextFreeId(const std::unordered_map<int,int>& parent) {
-    // choose the smallest positive integer not used as a key in parent
-    int cand = 1;                 // reserve 0 for ground
-    while (parent.find(cand) != parent.end()) ++cand;
-    return cand;
-}
 
 NodeManager::NodeManager() {
     // make sure ground exists and is its own rep
-    parent[0] = 0;
-    rankv[0]  = 1;
+    parent.at(0) = 0;
+    rankv.at(0)  = 1;
 
     // keep friendly aliases
-    idToLabel[0]   = "0";
-    labelToId["0"] = 0;
-    labelToId["gnd"] = 0;
-    labelToId["GND"] = 0;
+    idToLabel.at(0) = internLabel("0", 0);
+    internLabel("gnd", 0);
+    internLabel("GND", 0);
 
     // first non-ground id is 1
     nextId = 1;
 }
 
+int NodeManager::findLabel(std::string_view label, size_t hash) const {
+    if (labelSlots.empty()) return -1;
+    const size_t mask = labelSlots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const LabelSlot& s = labelSlots[i];
+        if (s.index < 0) return -1;
+        if (s.hash == hash && labelText[s.index] == label) return s.index;
+    }
+}
+
+int NodeManager::internLabel(std::string_view label, int id) {
+    const size_t h = labelHash(label);
+    int k = findLabel(label, h);
+    return k >= 0 ? k : appendLabel(label, id, h);
+}
+
+int NodeManager::appendLabel(std::string_view label, int id, size_t hash) {
+    // Keep the table at most half full
+    if (2 * (labelText.size() + 1) > labelSlots.size())
+        growLabelSlots(std::max<size_t>(64, 2 * labelSlots.size()));
+
+    const int k = static_cast<int>(labelText.size());
+    labelText.emplace_back(label);
+    labelId.push_back(id);
+    const size_t mask = labelSlots.size() - 1;
+    size_t i = hash & mask;
+    while (labelSlots[i].index >= 0) i = (i + 1) & mask;
+    labelSlots[i] = LabelSlot{hash, k};
+    return k;
+}
+
+void NodeManager::growLabelSlots(size_t size) {
+    std::vector<LabelSlot> old(size, LabelSlot{0, -1});
+    old.swap(labelSlots);
+    const size_t mask = labelSlots.size() - 1;
+    for (const LabelSlot& s : old) {
+        if (s.index < 0) continue;
+        size_t i = s.hash & mask;
+        while (labelSlots[i].index >= 0) i = (i + 1) & mask;
+        labelSlots[i] = s;
+    }
+}
+
+void NodeManager::reserve(size_t labels) {
+    size_t size = 64;
+    while (size < 2 * labels) size *= 2;
+    if (size > labelSlots.size()) growLabelSlots(size);
+    labelId.reserve(labels);
+}
 
+void NodeManager::restoreLabel(std::string_view label, int id) {
+    // Exported labels are distinct, so no lookup first
+    touch(id);
+    const int k = appendLabel(label, id, labelHash(label));
+    if (idToLabel.get(id) < 0) idToLabel.at(id) = k;
+}
 
 bool NodeManager::isNumber(const std::string& s) {
     if (s.empty()) return false;
@@ -38,146 +84,160 @@ bool NodeManager::isNumber(const std::string& s) {
 
 int NodeManager::newNodeId() { return nextId++; }
 
+void NodeManager::touch(int id) {
+    int& p = parent.at(id);
+    if (p < 0) p = id;
+    if (id >= nextId) nextId = id + 1;   // fresh ids never collide with numeric nodes seen so far
+}
+
 int NodeManager::findRep(int u) const {
     if (u == 0) return 0;
-    auto it = parent.find(u);
-    if (it == parent.end()) {
-        parent[u] = u;
-        rankv[u]  = 0;
-        return u;
+    // An id never seen is its own singleton
+    int root = u;
+    for (int p = parent.get(root); p >= 0 && p != root; p = parent.get(root)) root = p;
+    // Second pass: point the whole path at the root
+    while (u != root) {
+        int& p = parent.at(u);
+        if (p < 0) break;
+        u = p;
+        p = root;
     }
-    if (it->second == u) return u;
-    return parent[u] = findRep(it->second);
+    return root;
 }
 
 int NodeManager::unite(int a, int b) {
+    touch(a);
+    touch(b);
     a = findRep(a);
     b = findRep(b);
     if (a == b) return a;
 
+    ++merges;
     // keep 0 as absolute root
-    if (a == 0) { parent[b] = 0; return 0; }
-    if (b == 0) { parent[a] = 0; return 0; }
+    if (b == 0) std::swap(a, b);
+    if (a != 0) {
+        int ra = rankv.get(a), rb = rankv.get(b);
+        if (ra < rb) std::swap(a, b);
+        if (ra == rb) rankv.at(a)++;
+    }
+    parent.at(b) = a;
 
-    int ra = rankv[a], rb = rankv[b];
-    if (ra < rb) std::swap(a, b);
-    parent[b] = a;
-    if (ra == rb) rankv[a]++;
+    // The survivor keeps its name, or takes the one of the node merged into it
+    if (idToLabel.get(a) < 0) {
+        int k = idToLabel.get(b);
+        if (k >= 0) idToLabel.at(a) = k;
+    }
     return a;
 }
 
 
 
-int NodeManager::resolveId(const std::string& tok) {
+int NodeManager::resolveId(std::string_view tok) {
     // 1) Ground aliases → node 0
     if (isGroundToken(tok)) return 0;
 
-    // 2) Pure integer string → that numeric id (except "0", already handled)
-    char* end = nullptr;
-    long v = std::strtol(tok.c_str(), &end, 10);
-    if (end && *end == '\0') {
-        int id = static_cast<int>(v);
-        // ensure DSU bookkeeping exists for this numeric node
-        if (!parent.count(id)) parent[id] = id;
-        if (!rankv.count(id))  rankv[id]  = 0;
-        return id;
+    // 2) Pure non-negative integer string → that numeric id (except "0", already handled)
+    if (!tok.empty() && (std::isdigit(static_cast<unsigned char>(tok[0])) || tok[0] == '+')) {
+        const char* first = tok.data() + (tok[0] == '+');
+        const char* last = tok.data() + tok.size();
+        int id = 0;
+        auto [end, ec] = std::from_chars(first, last, id);
+        if (ec == std::errc() && end == last && id >= 0) {
+            // ensure DSU bookkeeping exists for this numeric node
+            touch(id);
+            return id;
+        }
     }
 
     // 3) It’s a label — return existing binding if present
-    auto it = labelToId.find(tok);
-    if (it != labelToId.end()) return it->second;
+    const size_t h = labelHash(tok);
+    int k = findLabel(tok, h);
+    if (k >= 0) return findRep(labelId[k]);
 
     // 4) New label → create a fresh node id and bind it
-    int u = nextFreeId(parent);   // smallest unused positive integer
-    parent[u] = u;
-    rankv[u]  = 0;
-    idToLabel[u]   = tok;
-    labelToId[tok] = u;
+    int u = newNodeId();
+    parent.at(u) = u;
+    idToLabel.at(u) = appendLabel(tok, u, h);
     return u;
 }
 
+int NodeManager::findId(std::string_view tok) const {
+    if (isGroundToken(tok)) return 0;
+    if (!tok.empty() && (std::isdigit(static_cast<unsigned char>(tok[0])) || tok[0] == '+')) {
+        const char* first = tok.data() + (tok[0] == '+');
+        const char* last = tok.data() + tok.size();
+        int id = 0;
+        auto [end, ec] = std::from_chars(first, last, id);
+        if (ec == std::errc() && end == last && id >= 0) return parent.get(id) < 0 ? -1 : findRep(id);
+    }
+    const int k = findLabel(tok);
+    return k < 0 ? -1 : findRep(labelId[k]);
+}
+
 int NodeManager::labelNode(const std::string& label, int nodeId) {
     if (isGroundToken(label)) return 0;
     if (nodeId < 0) nodeId = newNodeId();
-    parent.emplace(nodeId, nodeId);
-    rankv.emplace(nodeId, 0);
+    touch(nodeId);
     // If label already exists, short them
-    auto it = labelToId.find(label);
-    if (it != labelToId.end()) nodeId = unite(nodeId, it->second);
-    labelToId[label] = nodeId;
-    idToLabel[nodeId] = label;
+    const size_t h = labelHash(label);
+    int k = findLabel(label, h);
+    if (k >= 0) nodeId = unite(nodeId, labelId[k]);
+    else k = appendLabel(label, nodeId, h);
+    labelId[k] = nodeId;
+    idToLabel.at(nodeId) = k;
     return findRep(nodeId);
 }
 
 int NodeManager::connect(const std::string& a, const std::string& b) {
     int ia = resolveId(a);
     int ib = resolveId(b);
-    int r  = unite(ia, ib);
-    rebuildLabelTable();
-    return r;
+    return unite(ia, ib);
 }
 
 std::string NodeManager::nameOf(int nodeId) const {
-    auto it = idToLabel.find(findRep(nodeId));
-    return it == idToLabel.end() ? std::string{} : it->second;
+    int k = idToLabel.get(findRep(nodeId));
+    return k < 0 ? std::string{} : labelText[k];
 }
 
 void NodeManager::setLabel(int nodeId, const std::string& label) {
     if (nodeId == 0 || label.empty()) return;
     int rep = findRep(nodeId);
-    labelToId[label] = rep;
-    idToLabel[rep]   = label;
+    int k = internLabel(label, rep);
+    labelId[k] = rep;
+    idToLabel.at(rep) = k;
 }
 
 int NodeManager::canonical(int u) const { return findRep(u); }
 
 void NodeManager::rebuildLabelTable() {
-    // move labels to canonical reps
-    std::unordered_map<std::string,int> newL2I;
-    std::unordered_map<int,std::string> newI2L;
-    for (auto& kv : labelToId) {
-        int rep = findRep(kv.second);
-        newL2I[kv.first] = rep;
-        // prefer first label assigned to that rep
-        if (!newI2L.count(rep)) newI2L[rep] = kv.first;
-    }
-    labelToId.swap(newL2I);
-    idToLabel.swap(newI2L);
-
-    idToLabel[0] = "0";
-    labelToId["0"]   = 0;
-    labelToId["gnd"] = 0;
-    labelToId["GND"] = 0;
+    for (int& id : labelId) id = findRep(id);
 }
 
 void NodeManager::assignNodeAsGND(const std::string& tok) {
     connect(tok, "0");
-    rebuildLabelTable();
 }
 
 void NodeManager::displayNodes() const {
     // show canonical id and its (first) label if any
     std::cout << "Nodes (canonical rep -> label):\n";
-    // Collect all known ids (parents + label binded ids)
-    std::unordered_set<int> ids;
-    for (auto& kv : parent) ids.insert(kv.first);
-    for (auto& kv : labelToId) ids.insert(kv.second);
-    ids.insert(0);
+    // Every known id: DSU members plus label-bound ids
+    NodeTable<char> ids{0};
+    parent.forEach([&](int id, int) { ids.at(id) = 1; });
+    for (int id : labelId) ids.at(id) = 1;
+    ids.at(0) = 1;
 
-    for (int u : ids) {
+    ids.forEach([&](int u, char) {
         int r = findRep(u);
-        auto it = idToLabel.find(r);
-        std::string label = (it == idToLabel.end() ? "" : it->second);
+        std::string label = nameOf(r);
         std::cout << "  " << r << (label.empty() ? "" : ("  (" + label + ")")) << "\n";
-    }
+    });
 }
 
 void NodeManager::renameNode(const std::string& oldLabel, const std::string& newLabel) {
     int id = resolveId(oldLabel);
     setLabel(id, newLabel);
-    rebuildLabelTable();
 }
 
-bool NodeManager::isGroundToken(const std::string& s) {
+bool NodeManager::isGroundToken(std::string_view s) {
     return (s == "0" || s == "gnd" || s == "GND");
 }
@@ -1,18 +1,69 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <deque>
 #include <unordered_map>
 #include <vector>
+#include <algorithm>
 #include <cctype>
 
 class Graph; // fwd
 
+// Per-node-id value. Ids are handed out densely, so they index a vector; a numeric node
+// far beyond every id seen so far (say "1000000") goes to a hash map instead of growing
+// the vector, and moves over once the vector reaches it.
+template <class T>
+class NodeTable {
+public:
+    explicit NodeTable(T fill) : fill(fill) {}
+
+    T get(int id) const {
+        if (id >= 0 && static_cast<size_t>(id) < dense.size()) return dense[id];
+        auto it = sparse.find(id);
+        return it == sparse.end() ? fill : it->second;
+    }
+    T& at(int id) {
+        if (id >= 0 && static_cast<size_t>(id) >= dense.size() && static_cast<size_t>(id) < 2 * dense.size() + 1024)
+            grow(static_cast<size_t>(id) + 1);
+        if (id >= 0 && static_cast<size_t>(id) < dense.size()) return dense[id];
+        return sparse.try_emplace(id, fill).first->second;
+    }
+    // f(id, value) for every entry that differs from the fill value, dense ids in order
+    template <class F>
+    void forEach(F&& f) const {
+        for (size_t i = 0; i < dense.size(); ++i)
+            if (dense[i] != fill) f(static_cast<int>(i), dense[i]);
+        for (const auto& kv : sparse)
+            if (kv.second != fill) f(kv.first, kv.second);
+    }
+
+private:
+    T fill;
+    std::vector<T> dense;
+    std::unordered_map<int, T> sparse;
+
+    void grow(size_t need) {
+        dense.resize(std::max(need, 2 * dense.size()), fill);
+        for (auto it = sparse.begin(); it != sparse.end();) {
+            if (it->first >= 0 && static_cast<size_t>(it->first) < dense.size()) {
+                dense[it->first] = it->second;
+                it = sparse.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
+
 class NodeManager {
 public:
     NodeManager();
 
     // ---- public API used by parser / app ----
     // Return canonical numeric id for a token that can be "0", "12", or "vdd"
-    int resolveId(const std::string& token);
+    int resolveId(std::string_view token);
+    // Same, for a node that has to exist already (output probes): -1 instead of a new node
+    int findId(std::string_view token) const;
 
     // Force a specific label name to refer to a (possibly new) node id, return id
     int labelNode(const std::string& label, int nodeId = -1);
@@ -29,9 +80,31 @@ public:
 
 
 
-    // After DSU merges, refresh label→id to the canonical representatives.
+    // Bumped by every union that actually merges two nodes; element node ids taken before
+    // a change may no longer be canonical (Graph::canonicalizeNodes checks it)
+    unsigned long revision() const { return merges; }
+
+    // Unions keep names current as they happen, so this is optional: it points every label
+    // straight at its representative, which loaders do once after a bulk edit.
     void rebuildLabelTable();
 
+    // Room for this many labels without rehashing (loaders that know the netlist size)
+    void reserve(size_t labels);
+
+    // No nodes besides ground and no labels besides its aliases
+    bool empty() const { return nextId == 1 && labelText.size() == BUILTIN_LABELS; }
+
+    // Snapshots: f(label, id) for every label beyond the ground aliases, in creation order.
+    // Replaying them through restoreLabel into an empty manager gives the same ids; it
+    // does not look for the label first, so each must be new.
+    template <class F>
+    void forEachLabel(F&& f) const {
+        for (size_t k = BUILTIN_LABELS; k < labelText.size(); ++k) f(std::string_view(labelText[k]), labelId[k]);
+    }
+    void restoreLabel(std::string_view label, int id);
+    // Makes a numeric node id known, as resolveId would have
+    void restoreNode(int id) { touch(id); }
+
 // ---- simple wrappers used by CommandParser ----
     int  getOrCreateNodeId(const std::string& tok) { return resolveId(tok); }
     void assignNodeAsGND(const std::string& tok);  // implemented in .cpp (below)
@@ -39,22 +112,36 @@ public:
     void renameNode(const std::string& oldLabel, const std::string& newLabel);
     std::string getNodeNameById(int id) const { return nameOf(id); }
 
-    static bool isGroundToken(const std::string& s);
+    static bool isGroundToken(std::string_view s);
 
 
 private:
-    // --- DSU / Union-Find ---
-    mutable std::unordered_map<int,int> parent;
-    mutable std::unordered_map<int,int> rankv;
+    // --- DSU / Union-Find over node ids (parent -1 = id not seen yet) ---
+    mutable NodeTable<int> parent{-1};
+    NodeTable<unsigned char> rankv{0};
 
     static bool isNumber(const std::string& s);
     int  findRep(int u) const;
     int  unite(int a, int b);
-
-    // label <-> id
-    std::unordered_map<std::string,int> labelToId;
-    std::unordered_map<int,std::string> idToLabel;
+    void touch(int id);    // make sure id is a DSU member
+
+    // label <-> id. Each label is interned once (a deque never moves its strings) and known
+    // by its index from then on; an open-addressing table of (hash, index) finds it by text.
+    static constexpr size_t BUILTIN_LABELS = 3;   // "0", "gnd", "GND"
+    struct LabelSlot { size_t hash; int index; };
+    std::deque<std::string> labelText;
+    std::vector<int> labelId;            // node id per label index
+    std::vector<LabelSlot> labelSlots;   // power-of-two size, index -1 = empty
+    NodeTable<int> idToLabel{-1};        // label index per canonical id
+
+    static size_t labelHash(std::string_view label) { return std::hash<std::string_view>{}(label); }
+    int findLabel(std::string_view label, size_t hash) const;   // label index or -1
+    int findLabel(std::string_view label) const { return findLabel(label, labelHash(label)); }
+    int appendLabel(std::string_view label, int id, size_t hash); // label known to be new
+    int internLabel(std::string_view label, int id);             // id is kept if the label exists
+    void growLabelSlots(size_t size);
 
     int newNodeId();       // create a fresh positive node id
-    int nextId = 1;        // 0 is ground
+    int nextId = 1;        // 0 is ground; always above every id in use
+    unsigned long merges = 0;
 };
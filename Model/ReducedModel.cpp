@@ -0,0 +1,250 @@
+#include "ReducedModel.h"
+
+#include <eigen3/Eigen/Sparse>
+#include <eigen3/Eigen/SparseLU>
+#include <cmath>
+#include <memory>
+#include <numbers>
+#include <unordered_map>
+
+int get_matrix_idx(int node_id, const std::map<int, int>& node_id_to_matrix_idx);
+
+namespace {
+    using SpMat  = Eigen::SparseMatrix<double>;
+    using SpMatC = Eigen::SparseMatrix<std::complex<double>>;
+
+    // Port impedance matrix B^T (G + jwC)^-1 B of the full network (ports are its first p unknowns)
+    bool fullImpedance(const SpMat& G, const SpMat& C, int p, double omega, Eigen::MatrixXcd& Z) {
+        SpMatC Y = G.cast<std::complex<double>>() + std::complex<double>(0.0, omega) * C.cast<std::complex<double>>();
+        Y.makeCompressed();
+        Eigen::SparseLU<SpMatC, Eigen::COLAMDOrdering<int>> lu;
+        lu.compute(Y);
+        if (lu.info() != Eigen::Success) return false;
+        Eigen::MatrixXcd rhs = Eigen::MatrixXcd::Zero(G.rows(), p);
+        for (int j = 0; j < p; ++j) rhs(j, j) = 1.0;
+        Z = Eigen::MatrixXcd(lu.solve(rhs)).topRows(p);
+        return true;
+    }
+
+    Eigen::MatrixXcd reducedImpedance(const Eigen::MatrixXd& Gr, const Eigen::MatrixXd& Cr,
+                                      const Eigen::MatrixXd& Br, double omega) {
+        Eigen::MatrixXcd Y = Gr.cast<std::complex<double>>() + std::complex<double>(0.0, omega) * Cr.cast<std::complex<double>>();
+        Eigen::MatrixXcd Bc = Br.cast<std::complex<double>>();
+        return Bc.transpose() * Y.partialPivLu().solve(Bc);
+    }
+}
+
+ReducedModel* ReducedModel::build(const std::string& name, const std::vector<Element*>& network,
+                                  const std::vector<int>& ports, const ReductionOptions& opt, std::string& error) {
+    const int p = static_cast<int>(ports.size());
+    if (p == 0) { error = "no ports given"; return nullptr; }
+
+    // Local unknowns: ports first, then internal nodes, then one current per inductor
+    std::unordered_map<int, int> local;
+    for (int i = 0; i < p; ++i) local[ports[i]] = i;
+    int numNodes = p, numInductors = 0;
+    for (const Element* e : network) {
+        if (e->type != RESISTOR && e->type != CAPACITOR && e->type != INDUCTOR) {
+            error = "'" + e->name + "' is not a resistor, capacitor or inductor";
+            return nullptr;
+        }
+        for (int node : {e->node1, e->node2})
+            if (node != 0 && !local.count(node)) local[node] = numNodes++;
+        if (e->type == INDUCTOR) ++numInductors;
+    }
+    const int n = numNodes + numInductors;
+    auto idx = [&](int node) { return node == 0 ? -1 : local.at(node); };
+
+    std::vector<Eigen::Triplet<double>> g, c;
+    auto add = [](std::vector<Eigen::Triplet<double>>& t, int r, int col, double v) {
+        if (r != -1 && col != -1) t.emplace_back(r, col, v);
+    };
+    int k = numNodes;
+    for (const Element* e : network) {
+        int a = idx(e->node1), b = idx(e->node2);
+        if (e->type == INDUCTOR) {
+            // KCL columns +-1, KVL row -(V(a) - V(b)) + sL*i = 0
+            add(g, a, k, 1.0); add(g, b, k, -1.0);
+            add(g, k, a, -1.0); add(g, k, b, 1.0);
+            add(c, k, k, e->value);
+            ++k;
+            continue;
+        }
+        auto& t = (e->type == RESISTOR) ? g : c;
+        double v = (e->type == RESISTOR) ? 1.0 / e->value : e->value;
+        add(t, a, a, v); add(t, b, b, v); add(t, a, b, -v); add(t, b, a, -v);
+    }
+    for (int i = 0; i < numNodes; ++i) g.emplace_back(i, i, opt.gmin);
+
+    SpMat G(n, n), C(n, n);
+    G.setFromTriplets(g.begin(), g.end());
+    C.setFromTriplets(c.begin(), c.end());
+    G.makeCompressed();
+    C.makeCompressed();
+
+    // Reference responses the reduced model has to reproduce: DC and half-decade steps from
+    // fmax/1000 up to fmax, so no part of the band goes unchecked
+    std::vector<double> checks = {0.0};
+    for (int k = -6; k <= 0; ++k) checks.push_back(opt.fmax * std::pow(10.0, 0.5 * k));
+    std::vector<Eigen::MatrixXcd> Zfull;
+    for (double f : checks) {
+        Eigen::MatrixXcd Z;
+        if (!fullImpedance(G, C, p, 2.0 * std::numbers::pi * f, Z)) {
+            error = "the network cannot be solved at " + std::to_string(f) + " Hz";
+            return nullptr;
+        }
+        Zfull.push_back(std::move(Z));
+    }
+
+    // Expansion points of the rational Krylov space: real shifts s0 = 2*pi*f at fmax, fmax/10
+    // and fmax/100, then s0 = 0. Around s = 0 alone a network without a DC path sees only gmin
+    // in G, every G^-1 B column comes out ~1/gmin along the same common mode, and deflation
+    // stops the basis long before the band is matched. The shifted G + s0*C are well
+    // conditioned; s = 0 comes last and adds what DC still needs (that common mode).
+    struct Shift {
+        Eigen::SparseLU<SpMat, Eigen::COLAMDOrdering<int>> lu;
+        std::pair<int, int> last{0, 0};   // columns of V added by its previous block
+        bool exhausted = false;
+    };
+    const double shiftFreqs[] = {1.0, 0.1, 0.01, 0.0};
+    std::vector<std::unique_ptr<Shift>> shifts;
+    for (double f : shiftFreqs) {
+        auto sh = std::make_unique<Shift>();
+        SpMat K = G + (2.0 * std::numbers::pi * f * opt.fmax) * C;
+        K.makeCompressed();
+        sh->lu.compute(K);
+        if (sh->lu.info() != Eigen::Success) {
+            error = "the network cannot be factored at " + std::to_string(f * opt.fmax) + " Hz";
+            return nullptr;
+        }
+        shifts.push_back(std::move(sh));
+    }
+
+    const int maxOrder = std::max(p, std::min(opt.maxOrder, n));
+    Eigen::MatrixXd V(n, maxOrder);
+    int q = 0;
+
+    // Orthogonalizes the block against the basis (two Gram-Schmidt passes) and appends the
+    // columns that survive; nearly dependent ones are deflated. Returns the new columns' range.
+    auto append = [&](Eigen::MatrixXd W) {
+        int first = q;
+        for (int j = 0; j < W.cols() && q < maxOrder; ++j) {
+            Eigen::VectorXd w = W.col(j);
+            double norm0 = w.norm();
+            if (norm0 == 0.0) continue;
+            for (int pass = 0; pass < 2; ++pass) {
+                w -= V.leftCols(q) * (V.leftCols(q).transpose() * w);
+            }
+            double nrm = w.norm();
+            if (nrm <= 1e-10 * norm0) continue;
+            V.col(q++) = w / nrm;
+        }
+        return std::make_pair(first, q);
+    };
+
+    Eigen::MatrixXd B = Eigen::MatrixXd::Zero(n, p);
+    for (int j = 0; j < p; ++j) B(j, j) = 1.0;
+
+    auto* model = new ReducedModel(name, ports);
+    model->fullSize = n;
+    model->elementCount = static_cast<int>(network.size());
+
+    // Projection onto the basis so far and its worst port-impedance error over the checks
+    auto project = [&] {
+        const auto Vq = V.leftCols(q);
+        model->Gr = Vq.transpose() * (G * Vq);
+        model->Cr = Vq.transpose() * (C * Vq);
+        model->Br = Vq.topRows(p).transpose();
+        double err = 0.0;
+        for (size_t i = 0; i < Zfull.size(); ++i) {
+            Eigen::MatrixXcd Zr = reducedImpedance(model->Gr, model->Cr, model->Br, 2.0 * std::numbers::pi * checks[i]);
+            err = std::max(err, (Zr - Zfull[i]).norm() / Zfull[i].norm());
+        }
+        model->matchError = err;
+        return err;
+    };
+
+    // One block per shift in turn, (G + s0*C)^-1 B first and then (G + s0*C)^-1 C times that
+    // shift's previous block, until the checks pass. A shift whose block deflates away adds
+    // nothing more; when all of them have, the basis stops growing but the model is only as
+    // good as matchError says, not exact.
+    bool grew = true;
+    while (grew && q < maxOrder) {
+        grew = false;
+        for (auto& sh : shifts) {
+            if (sh->exhausted || q >= maxOrder) continue;
+            const int cols = sh->last.second - sh->last.first;
+            sh->last = append(sh->lu.solve(cols ? Eigen::MatrixXd(C * V.middleCols(sh->last.first, cols)) : B));
+            sh->exhausted = sh->last.first == sh->last.second;
+            if (sh->exhausted) continue;
+            grew = true;
+            if (project() <= opt.tol) return model;
+        }
+    }
+    if (q == 0) { delete model; error = "no Krylov direction survived deflation"; return nullptr; }
+    project();
+    return model;
+}
+
+void ReducedModel::display() {
+    std::cout << "Reduced model " << name << ": " << ports.size() << " ports, " << order()
+              << " states (from " << elementCount << " elements, " << fullSize << " unknowns), "
+              << "error " << matchError << std::endl;
+}
+
+void ReducedModel::stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
+                            const std::map<int, int>& node_id_to_matrix_idx,
+                            int extra_var_start_idx,
+                            const Eigen::VectorXd& prev_solution,
+                            double h) {
+    if (h <= 0) {
+        std::cerr << "Error: Invalid timestep h (" << h << ") for reduced model '" << name << "'. Skipping stamp." << std::endl;
+        return;
+    }
+    const int p = static_cast<int>(ports.size());
+    const int q = order();
+    const int ip = extra_var_start_idx + extraVariableIndex; // port currents
+    const int z = ip + p;                                    // states
+
+    for (int j = 0; j < p; ++j) {
+        int r = get_matrix_idx(ports[j], node_id_to_matrix_idx);
+        if (r != -1) {
+            A(r, ip + j) += 1.0;
+            A(ip + j, r) += 1.0;
+        }
+        for (int i = 0; i < q; ++i) {
+            A(ip + j, z + i) -= Br(i, j);
+            A(z + i, ip + j) -= Br(i, j);
+        }
+    }
+
+    Eigen::VectorXd zPrev = Eigen::VectorXd::Zero(q);
+    if (z + q <= prev_solution.size()) zPrev = prev_solution.segment(z, q);
+    A.block(z, z, q, q) += Gr + Cr / h;
+    b.segment(z, q) += Cr * zPrev / h;
+}
+
+void ReducedModel::stampAC(SmallSignalSystem& sys, const std::map<int, int>& node_id_to_matrix_idx,
+                           int extra_var_start_idx, const Eigen::VectorXd& /*op*/) const {
+    const int p = static_cast<int>(ports.size());
+    const int q = order();
+    const int ip = extra_var_start_idx + extraVariableIndex;
+    const int z = ip + p;
+
+    for (int j = 0; j < p; ++j) {
+        int r = get_matrix_idx(ports[j], node_id_to_matrix_idx);
+        sys.addG(r, ip + j, 1.0);
+        sys.addG(ip + j, r, 1.0);
+        for (int i = 0; i < q; ++i) {
+            if (Br(i, j) == 0.0) continue;
+            sys.addG(ip + j, z + i, -Br(i, j));
+            sys.addG(z + i, ip + j, -Br(i, j));
+        }
+    }
+    for (int i = 0; i < q; ++i) {
+        for (int l = 0; l < q; ++l) {
+            if (Gr(i, l) != 0.0) sys.addG(z + i, z + l, Gr(i, l));
+            if (Cr(i, l) != 0.0) sys.addC(z + i, z + l, Cr(i, l));
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef MORGHSPICY_REDUCEDMODEL_H
+#define MORGHSPICY_REDUCEDMODEL_H
+
+#pragma once
+#include <string>
+#include <vector>
+#include "Elements.h"
+
+struct ReductionOptions {
+    int    maxOrder = 200;   // upper bound on the number of reduced states
+    double fmax = 1e9;       // responses must match up to here (Hz)
+    double tol = 1e-4;       // relative port-impedance error allowed at the check frequencies
+    double gmin = 0.0;       // on every node of the network; reduce passes the host solver's
+};
+
+// Passive reduced-order model (PRIMA) of a linear R/L/C network seen from a few port nodes.
+//
+// The network is written as (G + sC) x = B ip, vp = B^T x, with ip the currents flowing from the
+// host into the ports. Inductor rows use the sign that makes G + G^T >= 0 and C >= 0, so the
+// congruence Gr = V^T G V, Cr = V^T C V, Br = V^T B keeps the model passive. V is an orthonormal
+// basis of a rational block Krylov space: blocks of (G + s0 C)^-1 C started from (G + s0 C)^-1 B
+// at a few real shifts s0 across the band and at s0 = 0, added one at a time until the port
+// impedance matches the full network from DC up to fmax.
+//
+// In the host MNA it adds one current per port (ip) followed by the q states z:
+//   KCL at port j:  + ip_j
+//   port row j:     V(port_j) - Br(:,j)^T z = 0
+//   state rows:     (Gr + Cr/h) z - Br ip = Cr/h z_prev        (backward Euler, like C and L)
+class ReducedModel : public Element {
+public:
+    std::vector<int> ports;      // host node ids, never ground
+    Eigen::MatrixXd Gr, Cr, Br;  // q x q, q x q, q x p
+    int fullSize = 0;            // unknowns of the network it replaces
+    int elementCount = 0;        // elements it replaces
+    double matchError = 0.0;     // worst relative port-impedance error at the check frequencies
+
+    ReducedModel(std::string n, std::vector<int> portNodes)
+            : Element(n, portNodes.empty() ? 0 : portNodes[0], portNodes.size() > 1 ? portNodes[1] : 0, 0.0, REDUCED_MODEL),
+              ports(std::move(portNodes)) {
+        introducesExtraVariable = true;
+    }
+
+    // Builds the reduced model of `network` (R, L and C only) with the given ports.
+    // Returns nullptr and fills `error` when the network cannot be reduced.
+    static ReducedModel* build(const std::string& name, const std::vector<Element*>& network,
+                               const std::vector<int>& ports, const ReductionOptions& opt, std::string& error);
+
+    int order() const { return static_cast<int>(Gr.rows()); }
+    int extraVariableCount() const override { return static_cast<int>(ports.size()) + order(); }
+
+    void display() override;
+    Element* clone() const override { return new ReducedModel(*this); }
+    void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
+                  const std::map<int, int>& node_id_to_matrix_idx,
+                  int extra_var_start_idx,
+                  const Eigen::VectorXd& prev_solution,
+                  double h) override;
+    void stampAC(SmallSignalSystem& sys,
+                 const std::map<int, int>& node_id_to_matrix_idx,
+                 int extra_var_start_idx,
+                 const Eigen::VectorXd& op) const override;
+};
+
+#endif //MORGHSPICY_REDUCEDMODEL_H
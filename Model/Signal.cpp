@@ -0,0 +1,225 @@
+//
+// Created by Mehrshad on 8/11/2025.
+//
+
+#include "Signal.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    // Little-endian unsigned of N bytes; compilers turn this into a plain load on x86/ARM
+    template <int N>
+    std::uint64_t loadLE(const char* p) {
+        std::uint64_t v = 0;
+        for (int k = 0; k < N; ++k) v |= std::uint64_t(static_cast<unsigned char>(p[k])) << (8 * k);
+        return v;
+    }
+
+    bool endsWith(const std::string& s, const char* suffix) {
+        const size_t n = std::strlen(suffix);
+        if (s.size() < n) return false;
+        for (size_t i = 0; i < n; ++i)
+            if (std::tolower(static_cast<unsigned char>(s[s.size() - n + i])) != suffix[i]) return false;
+        return true;
+    }
+
+    SignalFormat formatOf(const std::string& path) {
+        if (endsWith(path, ".wav")) return SignalFormat::Wav;
+        if (endsWith(path, ".f32")) return SignalFormat::F32;
+        if (endsWith(path, ".f64")) return SignalFormat::F64;
+        return SignalFormat::Text;
+    }
+}
+
+Signal::Signal(std::string filePath, double Fs_, double tStop_, int chunk)
+        : fileLocation(std::move(filePath)), Fs(Fs_), tStop(tStop_), chunkSize(chunk) {}
+
+Signal::~Signal() = default;
+
+bool Signal::open() {
+    close();
+    file = std::make_unique<MappedFile>(fileLocation);
+    if (!file->isOpen()) { close(); return false; }
+
+    fileFormat = formatOf(fileLocation);
+    switch (fileFormat) {
+        case SignalFormat::Text:
+            break;
+        case SignalFormat::F32:
+        case SignalFormat::F64:
+            bitsPerSample = fileFormat == SignalFormat::F32 ? 32 : 64;
+            floatSamples = true;
+            frameBytes = bitsPerSample / 8;
+            sampleBytes = file->data();
+            sampleCount = file->size() / frameBytes;   // a trailing partial sample is dropped
+            break;
+        case SignalFormat::Wav:
+            if (!readWavHeader()) { close(); return false; }
+            break;
+    }
+    return true;
+}
+
+void Signal::close() {
+    file.reset();
+    sampleBytes = nullptr;
+    sampleCount = frameBytes = 0;
+    bitsPerSample = 0;
+    floatSamples = false;
+    textPos = chunkStart = nextSample = releasedBytes = 0;
+    chunkView = {};
+    buffer.clear();
+    decoded.reset();
+}
+
+bool Signal::readWavHeader() {
+    const char* p = file->data();
+    const size_t n = file->size();
+    if (n < 12 || std::memcmp(p, "RIFF", 4) != 0 || std::memcmp(p + 8, "WAVE", 4) != 0) return false;
+
+    int channels = 0, formatTag = 0;
+    bool haveFormat = false;
+    for (size_t at = 12; at + 8 <= n;) {
+        const char* id = p + at;
+        const size_t size = loadLE<4>(p + at + 4);
+        const size_t body = at + 8;
+        if (std::memcmp(id, "fmt ", 4) == 0 && size >= 16 && body + 16 <= n) {
+            formatTag = static_cast<int>(loadLE<2>(p + body));
+            channels = static_cast<int>(loadLE<2>(p + body + 2));
+            Fs = static_cast<double>(loadLE<4>(p + body + 4));
+            frameBytes = loadLE<2>(p + body + 12);
+            bitsPerSample = static_cast<int>(loadLE<2>(p + body + 14));
+            if (formatTag == 0xFFFE && size >= 40 && body + 26 <= n)   // WAVE_FORMAT_EXTENSIBLE
+                formatTag = static_cast<int>(loadLE<2>(p + body + 24));
+            haveFormat = true;
+        } else if (std::memcmp(id, "data", 4) == 0 && haveFormat) {
+            // Recorders that stream leave the size at 0 or 0xFFFFFFFF; take what is there
+            const size_t available = n - body;
+            const size_t bytes = (size == 0 || size > available) ? available : size;
+            floatSamples = formatTag == 3;
+            const bool pcm = formatTag == 1 && (bitsPerSample == 8 || bitsPerSample == 16 ||
+                                                bitsPerSample == 24 || bitsPerSample == 32);
+            const bool ieee = floatSamples && (bitsPerSample == 32 || bitsPerSample == 64);
+            if ((!pcm && !ieee) || channels < 1 || Fs <= 0 ||
+                frameBytes < static_cast<size_t>(channels) * (bitsPerSample / 8))
+                return false;
+            sampleBytes = p + body;
+            sampleCount = bytes / frameBytes;
+            return true;
+        }
+        at = body + size + (size & 1);   // chunks are padded to even length
+    }
+    return false;
+}
+
+size_t Signal::sampleLimit() const {
+    const double last = std::floor(tStop * Fs * (1.0 + 1e-12));
+    if (!(last < 1e18)) return std::numeric_limits<size_t>::max();   // also t=inf
+    return last < 0 ? 0 : static_cast<size_t>(last) + 1;
+}
+
+void Signal::decode(size_t first, size_t n, double* out) const {
+    const char* p = sampleBytes + first * frameBytes;
+    const size_t stride = frameBytes;
+    switch (floatSamples ? -bitsPerSample : bitsPerSample) {
+        case -64: for (size_t i = 0; i < n; ++i, p += stride) out[i] = std::bit_cast<double>(loadLE<8>(p)); break;
+        case -32: for (size_t i = 0; i < n; ++i, p += stride) out[i] = std::bit_cast<float>(static_cast<std::uint32_t>(loadLE<4>(p))); break;
+        case 8:   for (size_t i = 0; i < n; ++i, p += stride) out[i] = (static_cast<unsigned char>(*p) - 128) / 128.0; break;
+        case 16:  for (size_t i = 0; i < n; ++i, p += stride) out[i] = static_cast<std::int16_t>(loadLE<2>(p)) / 32768.0; break;
+        case 24:  for (size_t i = 0; i < n; ++i, p += stride)
+                      out[i] = static_cast<std::int32_t>(static_cast<std::uint32_t>(loadLE<3>(p)) << 8) / 2147483648.0;
+                  break;
+        case 32:  for (size_t i = 0; i < n; ++i, p += stride) out[i] = static_cast<std::int32_t>(loadLE<4>(p)) / 2147483648.0; break;
+        default: break;
+    }
+}
+
+size_t Signal::parseText(size_t maxSamples, std::vector<double>& out) {
+    const char* data = file->data();
+    const size_t size = file->size();
+    size_t parsed = 0;
+    while (parsed < maxSamples && textPos < size) {
+        const char* line = data + textPos;
+        const char* eol = static_cast<const char*>(std::memchr(line, '\n', size - textPos));
+        if (!eol) eol = data + size;
+        textPos = static_cast<size_t>(eol - data) + 1;
+
+        // Like `stream >> v`: leading blanks and a '+' are fine, whatever follows the number is ignored
+        while (line < eol && (*line == ' ' || *line == '\t' || *line == '\r')) ++line;
+        if (line < eol && *line == '+' && line + 1 < eol && line[1] != '-') ++line;
+        double v;
+        if (line < eol && std::from_chars(line, eol, v).ec == std::errc()) {
+            out.push_back(v);
+            ++parsed;
+        }
+    }
+    return parsed;
+}
+
+bool Signal::readNextChunk() {
+    chunkView = {};
+    if (!file) return false;
+    chunkStart = nextSample;
+    const size_t limit = sampleLimit();
+    if (chunkSize <= 0 || nextSample >= limit) return false;
+    const size_t want = std::min(static_cast<size_t>(chunkSize), limit - nextSample);
+
+    buffer.clear();
+    size_t got;
+    if (fileFormat == SignalFormat::Text) {
+        got = parseText(want, buffer);
+    } else {
+        got = std::min(want, sampleCount - std::min(nextSample, sampleCount));
+        buffer.resize(got);
+        decode(nextSample, got, buffer.data());
+    }
+    nextSample += got;
+    chunkView = {buffer.data(), got};
+
+    // Chunks are read once, so what lies behind them need not stay resident
+    const size_t consumed = fileFormat == SignalFormat::Text
+            ? textPos : static_cast<size_t>(sampleBytes - file->data()) + nextSample * frameBytes;
+    if (consumed >= releasedBytes + RELEASE_BYTES) {
+        file->releaseBefore(consumed);
+        releasedBytes = consumed;
+    }
+    return got > 0;
+}
+
+SignalChunk Signal::readAll() {
+    if (!file && !open()) return {{}, 0.0, 1.0 / Fs};
+    const size_t limit = sampleLimit();
+    textPos = 0;
+    buffer.clear();
+    if (fileFormat == SignalFormat::Text) {
+        // One sample per line at most, so the line count sizes the buffer in one allocation
+        const std::string_view text = file->view();
+        const size_t lines = static_cast<size_t>(std::count(text.begin(), text.end(), '\n')) + 1;
+        buffer.reserve(std::min(lines, limit));
+        parseText(limit, buffer);
+        chunkView = buffer;
+    } else {
+        const size_t n = std::min(sampleCount, limit);
+        const bool inPlace = std::endian::native == std::endian::little && floatSamples && bitsPerSample == 64 &&
+                             frameBytes == sizeof(double) &&
+                             reinterpret_cast<std::uintptr_t>(sampleBytes) % alignof(double) == 0;
+        if (inPlace) {
+            chunkView = {reinterpret_cast<const double*>(sampleBytes), n};
+        } else {
+            // Every element is written by decode, so skip zero-filling what may be a GB
+            decoded = std::make_unique_for_overwrite<double[]>(n);
+            decode(0, n, decoded.get());
+            chunkView = {decoded.get(), n};
+        }
+    }
+    chunkStart = 0;
+    nextSample = chunkView.size();
+    return currentChunk();
+}
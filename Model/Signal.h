@@ -0,0 +1,100 @@
+//
+// Created by Mehrshad on 8/11/2025.
+//
+
+#ifndef MORGHSPICY_SIGNAL_H
+#define MORGHSPICY_SIGNAL_H
+
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+// How the samples are stored; open() picks it from the extension
+enum class SignalFormat {
+    Text,   // one sample (double) per line
+    F32,    // .f32: raw little-endian float32
+    F64,    // .f64: raw little-endian float64
+    Wav     // .wav: PCM 8/16/24/32-bit or IEEE float, first channel; Fs comes from the header
+};
+
+// A run of samples with an implicit time base: sample i is at t0 + i * dt
+struct SignalChunk {
+    std::span<const double> samples;
+    double t0 = 0.0;
+    double dt = 0.0;
+
+    size_t size() const { return samples.size(); }
+    double time(size_t i) const { return t0 + static_cast<double>(i) * dt; }
+};
+
+class Signal {
+public:
+    explicit Signal(std::string filePath = "", double Fs = 1000.0, double tStop = 1.0, int chunk = 4096);
+    ~Signal();
+    Signal(const Signal&) = delete;
+    Signal& operator=(const Signal&) = delete;
+
+    // Maps the file and reads its header; false if it cannot be opened or is not a valid WAV
+    bool open();
+    void close();
+
+    // Read next chunk (at most chunkSize samples, none past tStop); returns false on EOF.
+    // The file pages behind the chunks are released as they go, so streaming through a
+    // file of any length keeps one chunk (plus RELEASE_BYTES of mapping) resident.
+    bool readNextChunk();
+    SignalChunk currentChunk() const { return {chunkView, chunkStart / Fs, 1.0 / Fs}; }
+
+    // Every sample up to tStop in one span (opens the file if needed), valid while the Signal
+    // is open. Raw float64 is viewed in place; other formats are decoded once into a buffer
+    // the Signal owns.
+    SignalChunk readAll();
+
+    // Config
+    void setFs(double fs) { Fs = fs; }
+    void setTStop(double t) { tStop = t; }
+    void setChunkSize(int n) { chunkSize = n; }
+    const std::string& path() const { return fileLocation; }
+    SignalFormat format() const { return fileFormat; }
+    double sampleRate() const { return Fs; }
+
+private:
+    static constexpr size_t RELEASE_BYTES = size_t(8) << 20;
+
+    std::string fileLocation;
+    std::unique_ptr<MappedFile> file;
+    SignalFormat fileFormat = SignalFormat::Text;
+    double Fs;      // samples per second
+    double tStop;   // seconds
+    int chunkSize;  // samples per read
+
+    // Binary formats: where the samples start and how they are laid out
+    const char* sampleBytes = nullptr;
+    size_t sampleCount = 0;     // whole file
+    size_t frameBytes = 0;      // one sample of every channel
+    int bitsPerSample = 0;
+    bool floatSamples = false;
+
+    size_t textPos = 0;         // Text: next byte to parse
+    size_t chunkStart = 0;      // index of the first sample of the current chunk
+    size_t nextSample = 0;
+    size_t releasedBytes = 0;   // file pages before this offset were handed back
+    std::span<const double> chunkView;
+    std::vector<double> buffer; // decoded samples behind chunkView
+    std::unique_ptr<double[]> decoded;   // readAll of a binary format that cannot be viewed in place
+
+    bool readWavHeader();
+    size_t sampleLimit() const; // samples with t <= tStop
+    void decode(size_t first, size_t n, double* out) const;   // binary samples [first, first + n)
+    size_t parseText(size_t maxSamples, std::vector<double>& out);
+};
+
+
+
+#endif //MORGHSPICY_SIGNAL_H
@@ -0,0 +1,49 @@
+#ifndef MORGHSPICY_SMALLSIGNAL_H
+#define MORGHSPICY_SMALLSIGNAL_H
+
+#pragma once
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/Sparse>
+#include <complex>
+#include <vector>
+
+// Circuit linearized around an operating point, in descriptor form:
+//   (G + s*C) x = u,   s = j*omega
+// Same unknown layout as the MNASolver it was built from (nodes, then extra variables).
+// Rows/columns of -1 (ground) are dropped by the helpers, like the MNA stamps do.
+struct SmallSignalSystem {
+    int n = 0;
+    std::vector<Eigen::Triplet<double>> G, C;
+    Eigen::VectorXcd u;   // AC excitation (phasors)
+
+    explicit SmallSignalSystem(int size = 0) : n(size), u(Eigen::VectorXcd::Zero(size)) {}
+
+    void addG(int r, int c, double v) { if (r != -1 && c != -1) G.emplace_back(r, c, v); }
+    void addC(int r, int c, double v) { if (r != -1 && c != -1) C.emplace_back(r, c, v); }
+    void addU(int r, std::complex<double> v) { if (r != -1) u(r) += v; }
+
+    // Two-terminal admittance between rows a and b
+    void conductance(int a, int b, double g) {
+        addG(a, a, g); addG(b, b, g); addG(a, b, -g); addG(b, a, -g);
+    }
+    void capacitance(int a, int b, double c) {
+        addC(a, a, c); addC(b, b, c); addC(a, b, -c); addC(b, a, -c);
+    }
+    // Branch current k leaving a, entering b, plus the KVL row V(a) - V(b)
+    void branch(int a, int b, int k) {
+        addG(a, k, 1.0); addG(b, k, -1.0); addG(k, a, 1.0); addG(k, b, -1.0);
+    }
+
+    Eigen::SparseMatrix<double> sparseG() const {
+        Eigen::SparseMatrix<double> m(n, n);
+        m.setFromTriplets(G.begin(), G.end());
+        return m;
+    }
+    Eigen::SparseMatrix<double> sparseC() const {
+        Eigen::SparseMatrix<double> m(n, n);
+        m.setFromTriplets(C.begin(), C.end());
+        return m;
+    }
+};
+
+#endif //MORGHSPICY_SMALLSIGNAL_H
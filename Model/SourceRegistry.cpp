@@ -0,0 +1,77 @@
+#include "SourceRegistry.h"
+#include "Elements.h"
+
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+void SourceRegistry::build(const std::vector<Element*>& elements) {
+    sineElems.clear(); offset.clear(); amp.clear(); omega.clear(); phase.clear();
+    pulseElems.clear();
+    fileElems.clear();
+    for (Element* e : elements) {
+        if (e->type == SINUSOIDAL_SOURCE) {
+            auto* src = static_cast<SinusoidalSource*>(e);
+            sineElems.push_back(src);
+            offset.push_back(src->getOffset());
+            amp.push_back(src->getAmplitude());
+            omega.push_back(2 * std::numbers::pi * src->getFrequency());
+            phase.push_back(src->getPhase());
+        } else if (e->type == PULSE_SOURCE) {
+            pulseElems.push_back(static_cast<PulseSource*>(e));
+        } else if (e->type == FILE_SOURCE) {
+            fileElems.push_back(static_cast<FileSource*>(e));
+        }
+    }
+    const size_t n = sineElems.size();
+    s.assign(n, 0.0); c.assign(n, 1.0);
+    rotC.assign(n, 1.0); rotS.assign(n, 0.0);
+    anchored = false;
+    lastStep = 0.0;
+}
+
+void SourceRegistry::anchor(double time) {
+    for (size_t i = 0; i < sineElems.size(); ++i) {
+        const double arg = omega[i] * time + phase[i];
+        s[i] = std::sin(arg);
+        c[i] = std::cos(arg);
+    }
+    sinceAnchor = 0;
+}
+
+void SourceRegistry::update(double time) {
+    const size_t n = sineElems.size();
+    if (n) {
+        const double step = time - lastTime;
+        // Accumulated time carries rounding, so "same step" is up to a few ulp of the step
+        const bool sameStep = anchored && step > 0.0 && std::abs(step - lastStep) <= 1e-12 * step;
+        if (sameStep && ++sinceAnchor < REANCHOR) {
+            for (size_t i = 0; i < n; ++i) {
+                const double sn = s[i] * rotC[i] + c[i] * rotS[i];
+                const double cn = c[i] * rotC[i] - s[i] * rotS[i];
+                s[i] = sn;
+                c[i] = cn;
+            }
+        } else {
+            anchor(time);
+            if (anchored && step > 0.0 && !sameStep) {
+                for (size_t i = 0; i < n; ++i) {
+                    rotC[i] = std::cos(omega[i] * step);
+                    rotS[i] = std::sin(omega[i] * step);
+                }
+                lastStep = step;
+            }
+        }
+        anchored = true;
+        lastTime = time;
+        for (size_t i = 0; i < n; ++i) sineElems[i]->setWaveform(time, offset[i] + amp[i] * s[i]);
+    }
+    for (PulseSource* p : pulseElems) p->setWaveform(time, p->evaluate(time));
+    for (FileSource* f : fileElems) f->updateTime(time);
+}
+
+double SourceRegistry::nextBreakpoint(double time) const {
+    double next = std::numeric_limits<double>::infinity();
+    for (const FileSource* f : fileElems) next = std::min(next, f->nextBreakpoint(time));
+    return next;
+}
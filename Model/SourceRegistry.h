@@ -0,0 +1,48 @@
+#ifndef MORGHSPICY_SOURCEREGISTRY_H
+#define MORGHSPICY_SOURCEREGISTRY_H
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+class Element;
+class SinusoidalSource;
+class PulseSource;
+class FileSource;
+
+// The time-varying sources of a graph, collected once so a timestep only touches them.
+// update(t) evaluates every waveform in one pass and hands the values to the elements,
+// which then stamp the cached value (no sin() per stamp or per Newton iteration).
+// Sines are kept as sin/cos of their phase and advanced by a rotation when the step
+// repeats, so a fixed-step transient needs no sin() at all; they are re-anchored with
+// an exact sin/cos every REANCHOR steps, on a changed step, or when time goes back.
+// File sources advance their own cursors and supply the transient's breakpoints.
+class SourceRegistry {
+public:
+    void build(const std::vector<Element*>& elements);
+    void update(double time);
+    // Earliest breakpoint after `time` (a file source's next sample), infinity if none
+    double nextBreakpoint(double time) const;
+
+    std::size_t size() const { return sineElems.size() + pulseElems.size() + fileElems.size(); }
+
+private:
+    static constexpr int REANCHOR = 256;
+
+    // Sines, one entry per source: value = offset + amp * s, (s, c) = sin/cos(omega t + phase)
+    std::vector<SinusoidalSource*> sineElems;
+    std::vector<double> offset, amp, omega, phase;
+    std::vector<double> s, c;            // at lastTime
+    std::vector<double> rotC, rotS;      // cos/sin(omega * lastStep)
+
+    std::vector<PulseSource*> pulseElems;
+    std::vector<FileSource*> fileElems;
+
+    bool anchored = false;
+    double lastTime = 0.0, lastStep = 0.0;
+    int sinceAnchor = 0;
+
+    void anchor(double time);
+};
+
+#endif //MORGHSPICY_SOURCEREGISTRY_H
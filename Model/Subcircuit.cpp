@@ -0,0 +1,231 @@
+#include "Subcircuit.h"
+
+#include <numeric>
+#include <unordered_map>
+
+int get_matrix_idx(int node_id, const std::map<int, int>& node_id_to_matrix_idx);
+
+namespace {
+    int findRoot(std::vector<int>& parent, int x) {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    }
+
+    // Local id -> host row maps, one per node count and thread. The keys (1..n) never
+    // change, so an instance only rewrites the values; Monte Carlo workers stamp clones
+    // that share a definition, hence thread_local.
+    std::map<int, int>& scratchMap(size_t nodes) {
+        thread_local std::unordered_map<size_t, std::map<int, int>> maps;
+        std::map<int, int>& m = maps[nodes];
+        if (m.empty())
+            for (int id = 1; id <= static_cast<int>(nodes); ++id) m.emplace_hint(m.end(), id, -1);
+        return m;
+    }
+}
+
+void SubcircuitDef::addElement(std::unique_ptr<Element> e) {
+    if (e->introducesExtraVariable) {
+        e->extraVariableIndex = extraCount;
+        extraCount += e->extraVariableCount();
+    }
+    hasDiodes = hasDiodes || e->type == DIODE;
+    hasSources = hasSources || e->type == VOLTAGE_SOURCE || e->type == CURRENT_SOURCE;
+    elements.push_back(std::move(e));
+}
+
+int SubcircuitDef::internalNode(std::string_view nodeName) const {
+    for (size_t i = PORTS; i < nodeNames.size(); ++i)
+        if (nodeNames[i] == nodeName) return static_cast<int>(i) + 1;
+    return -1;
+}
+
+void SubcircuitDef::finish() {
+    // Ports joined without capacitors and current sources: conductive; with them: capacitive
+    const int n = static_cast<int>(nodeNames.size()) + 1;
+    std::vector<int> all(n), dc(n);
+    std::iota(all.begin(), all.end(), 0);
+    std::iota(dc.begin(), dc.end(), 0);
+    for (const auto& e : elements) {
+        all[findRoot(all, e->node1)] = findRoot(all, e->node2);
+        if (e->type != CAPACITOR && e->type != CURRENT_SOURCE) dc[findRoot(dc, e->node1)] = findRoot(dc, e->node2);
+    }
+    if (findRoot(dc, 1) == findRoot(dc, 2)) coupling = Coupling::Conductive;
+    else if (findRoot(all, 1) == findRoot(all, 2)) coupling = Coupling::Capacitive;
+    else coupling = Coupling::None;
+}
+
+std::shared_ptr<SubcircuitDef> SubcircuitDef::copy() const {
+    auto d = std::make_shared<SubcircuitDef>();
+    d->name = name;
+    d->nodeNames = nodeNames;
+    d->elements.reserve(elements.size());
+    for (const auto& e : elements) d->elements.emplace_back(e->clone());
+    d->extraCount = extraCount;
+    d->coupling = coupling;
+    d->hasDiodes = hasDiodes;
+    d->hasSources = hasSources;
+    return d;
+}
+
+std::shared_ptr<const SubcircuitMacromodel> SubcircuitDef::macromodel(double h, double gmin) const {
+    {
+        std::lock_guard<std::mutex> lock(macroMutex);
+        for (const auto& m : macromodels)
+            if (m->h == h && m->gmin == gmin) return m;
+    }
+
+    // Local unknowns: ports 0 and 1, then the interior (internal nodes, element unknowns)
+    const int u = unknowns();
+    const int n = PORTS + u;
+    std::map<int, int> rows;
+    for (int id = 1; id <= static_cast<int>(nodeNames.size()); ++id) rows.emplace_hint(rows.end(), id, id - 1);
+    const int extraStart = static_cast<int>(nodeNames.size());
+
+    // The stamps are affine in x_prev: stamping with x_prev = 0 gives A and s, and with
+    // x_prev = e_j the column j of P
+    Eigen::MatrixXd A = Eigen::MatrixXd::Zero(n, n), scratch(n, n), P(n, n);
+    Eigen::VectorXd s = Eigen::VectorXd::Zero(n), b(n), prev = Eigen::VectorXd::Zero(n);
+    for (const auto& e : elements) e->stampMNA(A, s, rows, extraStart, prev, h);
+    for (int k = 0; k < internalNodes(); ++k) A(PORTS + k, PORTS + k) += gmin;
+    for (int j = 0; j < n; ++j) {
+        scratch.setZero();
+        b.setZero();
+        prev.setZero();
+        prev(j) = 1.0;
+        for (const auto& e : elements) e->stampMNA(scratch, b, rows, extraStart, prev, h);
+        P.col(j) = b - s;
+    }
+
+    auto m = std::make_shared<SubcircuitMacromodel>();
+    m->h = h;
+    m->gmin = gmin;
+    m->ok = true;
+    m->stateful = u > 0 && !P.rightCols(u).isZero(0.0);
+    m->K.setZero(u, PORTS);
+    m->z0.setZero(u);
+    m->Z.setZero(u, n);
+    if (u > 0) {
+        Eigen::PartialPivLU<Eigen::MatrixXd> lu(A.bottomRightCorner(u, u));
+        m->ok = lu.rcond() > u * Eigen::NumTraits<double>::epsilon();
+        if (m->ok) {
+            m->K = lu.solve(A.bottomLeftCorner(u, PORTS));
+            m->z0 = lu.solve(s.tail(u));
+            m->Z = lu.solve(P.bottomRows(u));
+        }
+    }
+    const auto Api = A.topRightCorner(PORTS, u);
+    m->S = A.topLeftCorner(PORTS, PORTS) - Api * m->K;
+    m->r0 = s.head(PORTS) - Api * m->z0;
+    m->R = P.topRows(PORTS) - Api * m->Z;
+
+    std::lock_guard<std::mutex> lock(macroMutex);
+    macromodels.insert(macromodels.begin(), m);
+    if (macromodels.size() > MACROMODELS_KEPT) macromodels.pop_back();
+    return m;
+}
+
+Subcircuit::Subcircuit(std::string n, int n1, int n2, std::shared_ptr<const SubcircuitDef> d)
+        : Element(std::move(n), n1, n2, 0.0, SUBCIRCUIT), def(std::move(d)) {
+    introducesExtraVariable = def->unknowns() > 0;
+}
+
+void Subcircuit::setCondensed(bool on) {
+    condensed = on;
+    introducesExtraVariable = !on && def->unknowns() > 0;
+    macro.reset();
+    interior = Eigen::VectorXd::Zero(on ? def->unknowns() : 0);
+    y = interior;
+}
+
+void Subcircuit::commit(const Eigen::VectorXd& solution, const std::map<int, int>& node_id_to_matrix_idx) {
+    // A stateless interior is not needed by the next stamp; probes recover it from y
+    if (!condensed || !macro || !macro->ok || !macro->stateful) return;
+    interior = y - macro->K * portVoltages(solution, node_id_to_matrix_idx);
+}
+
+double Subcircuit::internalVoltage(int local, const Eigen::VectorXd& solution,
+                                   const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx) const {
+    const int k = local - 1 - SubcircuitDef::PORTS;
+    if (k < 0 || k >= def->internalNodes()) return 0.0;
+    if (!condensed) {
+        const int idx = extra_var_start_idx + extraVariableIndex + k;
+        return idx < solution.size() ? solution(idx) : 0.0;
+    }
+    if (!macro || !macro->ok) return 0.0;
+    return y(k) - macro->K.row(k).dot(portVoltages(solution, node_id_to_matrix_idx));
+}
+
+void Subcircuit::display() {
+    std::cout << "Subcircuit " << name << " (" << def->name << "): connected to nodes " << node1 << " - " << node2
+              << ", contains " << def->elements.size() << " internal elements." << std::endl;
+}
+
+const std::map<int, int>& Subcircuit::localRows(const std::map<int, int>& node_id_to_matrix_idx, int base) const {
+    std::map<int, int>& rows = scratchMap(def->nodeNames.size());
+    auto it = rows.begin();
+    (it++)->second = get_matrix_idx(node1, node_id_to_matrix_idx);   // -1: the port is grounded
+    (it++)->second = get_matrix_idx(node2, node_id_to_matrix_idx);
+    for (int k = 0; it != rows.end(); ++it, ++k) it->second = base + k;
+    return rows;
+}
+
+Eigen::Vector2d Subcircuit::portVoltages(const Eigen::VectorXd& solution, const std::map<int, int>& node_id_to_matrix_idx) const {
+    Eigen::Vector2d v = Eigen::Vector2d::Zero();
+    const int r1 = get_matrix_idx(node1, node_id_to_matrix_idx);
+    const int r2 = get_matrix_idx(node2, node_id_to_matrix_idx);
+    if (r1 != -1 && r1 < solution.size()) v(0) = solution(r1);
+    if (r2 != -1 && r2 < solution.size()) v(1) = solution(r2);
+    return v;
+}
+
+void Subcircuit::stampCondensed(Eigen::MatrixXd& A, Eigen::VectorXd& b,
+                                const std::map<int, int>& node_id_to_matrix_idx,
+                                const Eigen::VectorXd& prev_solution, double h) {
+    if (!macro || macro->h != h || macro->gmin != gmin) macro = def->macromodel(h, gmin);
+    if (!macro->ok) {
+        std::cerr << "Error: Subcircuit '" << name << "' (" << def->name
+                  << ") cannot be condensed, its interior is singular. Skipping stamp." << std::endl;
+        return;
+    }
+    Eigen::VectorXd xprev(SubcircuitDef::PORTS + def->unknowns());
+    xprev.head<SubcircuitDef::PORTS>() = portVoltages(prev_solution, node_id_to_matrix_idx);
+    xprev.tail(def->unknowns()) = interior;
+    y = macro->z0 + macro->Z * xprev;
+    const Eigen::Vector2d rhs = macro->r0 + macro->R * xprev;
+
+    const int r[SubcircuitDef::PORTS] = {get_matrix_idx(node1, node_id_to_matrix_idx),
+                                         get_matrix_idx(node2, node_id_to_matrix_idx)};
+    for (int i = 0; i < SubcircuitDef::PORTS; ++i) {
+        if (r[i] == -1) continue;
+        b(r[i]) += rhs(i);
+        for (int j = 0; j < SubcircuitDef::PORTS; ++j)
+            if (r[j] != -1) A(r[i], r[j]) += macro->S(i, j);
+    }
+}
+
+void Subcircuit::stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
+                          const std::map<int, int>& node_id_to_matrix_idx,
+                          int extra_var_start_idx,
+                          const Eigen::VectorXd& prev_solution,
+                          double h) {
+    if (condensed) {
+        stampCondensed(A, b, node_id_to_matrix_idx, prev_solution, h);
+        return;
+    }
+    const int base = extra_var_start_idx + extraVariableIndex;
+    const std::map<int, int>& rows = localRows(node_id_to_matrix_idx, base);
+    for (const auto& e : def->elements)
+        e->stampMNA(A, b, rows, base + def->internalNodes(), prev_solution, h);
+    for (int k = 0; k < def->internalNodes(); ++k) A(base + k, base + k) += gmin;
+}
+
+void Subcircuit::stampAC(SmallSignalSystem& sys,
+                         const std::map<int, int>& node_id_to_matrix_idx,
+                         int extra_var_start_idx,
+                         const Eigen::VectorXd& op) const {
+    const int base = extra_var_start_idx + extraVariableIndex;
+    const std::map<int, int>& rows = localRows(node_id_to_matrix_idx, base);
+    for (const auto& e : def->elements)
+        e->stampAC(sys, rows, base + def->internalNodes(), op);
+    for (int k = 0; k < def->internalNodes(); ++k) sys.addG(base + k, base + k, gmin);
+}
@@ -0,0 +1,124 @@
+#ifndef MORGHSPICY_SUBCIRCUIT_H
+#define MORGHSPICY_SUBCIRCUIT_H
+
+#pragma once
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Elements.h"
+
+// Port-level Schur complement of a linear definition for one timestep h. The definition's
+// stamp is  A [x_p; x_i] = s + P x_prev  with x_prev = [ports; interior] at the previous
+// accepted solution; eliminating the interior x_i leaves a 2x2 system on the ports:
+//   S x_p = r0 + R x_prev,   S = App - Api Aii^-1 Aip
+// and the interior follows as x_i = (z0 + Z x_prev) - K x_p.
+struct SubcircuitMacromodel {
+    double h = 0.0;
+    double gmin = 0.0;        // on the internal-node diagonal of Aii
+    bool ok = false;          // false: Aii is singular and the interior cannot be eliminated
+    bool stateful = false;    // interior values of the previous step enter b (C or L inside)
+    Eigen::Matrix2d S;
+    Eigen::Vector2d r0;
+    Eigen::Matrix<double, 2, Eigen::Dynamic> R;
+    Eigen::VectorXd z0;       // Aii^-1 s_i
+    Eigen::MatrixXd Z;        // Aii^-1 P_i
+    Eigen::MatrixXd K;        // Aii^-1 Aip
+};
+
+// One subcircuit definition (a parsed library/<name>.sub), shared by all of its instances;
+// its elements never go into a Graph. Node ids are local to the definition: 1 and 2 are the
+// ports, 3.. the internal nodes. extraVariableIndex of an element counts from the first
+// element unknown of the definition (after the internal nodes).
+struct SubcircuitDef {
+    // How the ports are tied together at DC, for the topology check
+    enum class Coupling { None, Capacitive, Conductive };
+
+    static constexpr int PORTS = 2;
+
+    std::string name;
+    std::vector<std::string> nodeNames;             // local id - 1 -> name in the file
+    std::vector<std::unique_ptr<Element>> elements;
+    int extraCount = 0;                             // unknowns added by the elements
+    Coupling coupling = Coupling::None;
+    bool hasDiodes = false;
+    bool hasSources = false;
+
+    int internalNodes() const { return static_cast<int>(nodeNames.size()) - PORTS; }
+    int unknowns() const { return internalNodes() + extraCount; }
+    // Only linear definitions can be condensed to their ports
+    bool linear() const { return !hasDiodes; }
+    // Local id of an internal node by its name in the file, -1 if there is none
+    int internalNode(std::string_view nodeName) const;
+
+    // Appends an element whose nodes are local ids and gives it its slot among the unknowns
+    void addElement(std::unique_ptr<Element> e);
+    // Works out `coupling` once every element is in
+    void finish();
+    // A copy with its own elements and no macromodels yet, for an instance whose element
+    // values have to differ from the shared definition (Monte Carlo)
+    std::shared_ptr<SubcircuitDef> copy() const;
+
+    // The condensed model for timestep h and internal-node gmin, built on first use and
+    // shared by every instance
+    std::shared_ptr<const SubcircuitMacromodel> macromodel(double h, double gmin) const;
+
+private:
+    static constexpr size_t MACROMODELS_KEPT = 4;   // a transient uses its step, a shorter last one and DC
+    mutable std::mutex macroMutex;
+    mutable std::vector<std::shared_ptr<const SubcircuitMacromodel>> macromodels;   // most recent first
+};
+
+// One instance: the shared definition plus the two host nodes its ports connect to. The
+// internal nodes and the internal element unknowns are this element's extra variables, so
+// an instance is expanded only into the solver's index space, when it is stamped.
+//
+// A condensed instance (linear definition, see MNASolver::initializeMatrix) adds no unknowns:
+// it stamps the definition's 2x2 macromodel and keeps its own interior state, which the
+// solver commits after each solve.
+class Subcircuit : public Element {
+public:
+    std::shared_ptr<const SubcircuitDef> def;
+    bool condensed = false;
+    double gmin = 0.0;   // on the internal nodes; the solver sets its own (MNASolver::initializeMatrix)
+
+    Subcircuit(std::string n, int n1, int n2, std::shared_ptr<const SubcircuitDef> d);
+
+    int extraVariableCount() const override { return condensed ? 0 : def->unknowns(); }
+
+    // Switches between the expanded and condensed forms; either way the interior starts at zero
+    void setCondensed(bool on);
+    // Interior state after an accepted solve (condensed only)
+    void commit(const Eigen::VectorXd& solution, const std::map<int, int>& node_id_to_matrix_idx);
+    // Voltage of internal node `local` (see SubcircuitDef::internalNode) in a solution
+    double internalVoltage(int local, const Eigen::VectorXd& solution,
+                           const std::map<int, int>& node_id_to_matrix_idx, int extra_var_start_idx) const;
+
+    void display() override;
+    Element* clone() const override { return new Subcircuit(*this); }
+    void stampMNA(Eigen::MatrixXd& A, Eigen::VectorXd& b,
+                  const std::map<int, int>& node_id_to_matrix_idx,
+                  int extra_var_start_idx,
+                  const Eigen::VectorXd& prev_solution,
+                  double h) override;
+    void stampAC(SmallSignalSystem& sys,
+                 const std::map<int, int>& node_id_to_matrix_idx,
+                 int extra_var_start_idx,
+                 const Eigen::VectorXd& op) const override;
+
+private:
+    std::shared_ptr<const SubcircuitMacromodel> macro;   // the one the last stamp used
+    Eigen::VectorXd interior;   // x_i at the last committed solution
+    Eigen::VectorXd y;          // z0 + Z x_prev of the last stamp
+
+    // Local node id -> host matrix row for this instance
+    const std::map<int, int>& localRows(const std::map<int, int>& node_id_to_matrix_idx, int base) const;
+    Eigen::Vector2d portVoltages(const Eigen::VectorXd& solution, const std::map<int, int>& node_id_to_matrix_idx) const;
+    void stampCondensed(Eigen::MatrixXd& A, Eigen::VectorXd& b,
+                        const std::map<int, int>& node_id_to_matrix_idx,
+                        const Eigen::VectorXd& prev_solution, double h);
+};
+
+#endif //MORGHSPICY_SUBCIRCUIT_H
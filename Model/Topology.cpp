@@ -0,0 +1,250 @@
+#include "Topology.h"
+#include "Graph.h"
+#include "ReducedModel.h"
+#include "Subcircuit.h"
+
+#include <numeric>
+#include <ostream>
+#include <unordered_map>
+
+namespace {
+    constexpr size_t MAX_LOOPS = 64;      // loops traced and named; further ones are not listed
+    constexpr size_t MAX_NAMES = 8;       // names printed per problem
+
+    // Union by size with path halving, no recursion
+    struct DisjointSets {
+        std::vector<int> parent, size;
+        explicit DisjointSets(size_t n) : parent(n), size(n, 1) { std::iota(parent.begin(), parent.end(), 0); }
+        int find(int x) {
+            while (parent[x] != x) {
+                parent[x] = parent[parent[x]];
+                x = parent[x];
+            }
+            return x;
+        }
+        bool unite(int a, int b) {
+            a = find(a);
+            b = find(b);
+            if (a == b) return false;
+            if (size[a] < size[b]) std::swap(a, b);
+            parent[b] = a;
+            size[a] += size[b];
+            return true;
+        }
+    };
+
+    enum class Kind { Voltage, Current, Conductive };
+
+    Kind kindOf(const Element* e) {
+        switch (e->type) {
+            case VOLTAGE_SOURCE: case SINUSOIDAL_SOURCE: case PULSE_SOURCE: case FILE_SOURCE:
+            case VCVS: case CCVS: case INDUCTOR:
+                return Kind::Voltage;
+            case CURRENT_SOURCE: case CAPACITOR: case VCCS: case CCCS:
+                return Kind::Current;
+            case SUBCIRCUIT:
+                return static_cast<const Subcircuit*>(e)->def->coupling == SubcircuitDef::Coupling::Conductive
+                       ? Kind::Conductive : Kind::Current;
+            default:
+                return Kind::Conductive;
+        }
+    }
+
+    bool isCurrentSource(const Element* e) {
+        return e->type == CURRENT_SOURCE || e->type == VCCS || e->type == CCCS;
+    }
+
+    // Terminal pairs an element ties together. A reduced model couples all its ports,
+    // referenced to ground; a subcircuit instance ties its ports if its definition does.
+    template <class F>
+    void forEachBranch(const Element* e, F&& f) {
+        if (e->type == REDUCED_MODEL) {
+            const auto& ports = static_cast<const ReducedModel*>(e)->ports;
+            for (int p : ports) f(0, p);
+            return;
+        }
+        if (e->type == SUBCIRCUIT && static_cast<const Subcircuit*>(e)->def->coupling == SubcircuitDef::Coupling::None)
+            return;
+        f(e->node1, e->node2);
+    }
+
+    // Node id -> dense index, ground first. Node ids are usually small, so a plain table
+    // is used unless they are sparse.
+    class NodeIndex {
+    public:
+        explicit NodeIndex(const std::vector<Element*>& elements) {
+            int maxId = 0;
+            size_t terminals = 0;
+            for (const Element* e : elements)
+                forEachBranch(e, [&](int a, int b) { maxId = std::max({maxId, a, b}); terminals += 2; });
+            if (static_cast<size_t>(maxId) <= 4 * terminals + 16) direct.assign(static_cast<size_t>(maxId) + 1, -1);
+            else hashed.reserve(terminals);
+            (*this)(0);
+        }
+        int operator()(int id) {
+            if (id < 0) id = 0;
+            if (!direct.empty()) {
+                int& slot = direct[static_cast<size_t>(id)];
+                if (slot < 0) slot = count++;
+                return slot;
+            }
+            auto [it, fresh] = hashed.try_emplace(id, count);
+            if (fresh) ++count;
+            return it->second;
+        }
+        int size() const { return count; }
+    private:
+        std::vector<int> direct;
+        std::unordered_map<int, int> hashed;
+        int count = 0;
+    };
+
+    struct Branch { int a, b, elem; };
+}
+
+bool TopologyReport::dcSolvable() const {
+    if (!islands.empty() || !loops.empty()) return false;
+    for (const Cutset& c : cutsets)
+        if (c.driven) return false;
+    return true;
+}
+
+TopologyReport checkTopology(const Graph& g) {
+    TopologyReport report;
+    const auto& elements = g.getElements();
+
+    // Dense endpoints of every branch, so the three passes below do no lookups
+    NodeIndex index(elements);
+    std::vector<Branch> branches;
+    branches.reserve(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i)
+        forEachBranch(elements[i], [&](int a, int b) { branches.push_back({index(a), index(b), static_cast<int>(i)}); });
+    const int n = index.size();
+
+    // all: every branch. dc: everything except current sources and capacitors.
+    // vs: voltage-defined branches only; a branch that closes a cycle there is a loop.
+    DisjointSets all(n), dc(n), vs(n);
+    std::vector<Branch> forest, closing;
+    for (const Branch& br : branches) {
+        all.unite(br.a, br.b);
+        const Kind kind = kindOf(elements[br.elem]);
+        if (kind != Kind::Current) dc.unite(br.a, br.b);
+        if (kind == Kind::Voltage) {
+            if (vs.unite(br.a, br.b)) forest.push_back(br);
+            else closing.push_back(br);
+        }
+    }
+
+    // Floating islands: group the elements by component, CSR style (count, offsets, fill)
+    const int groundAll = all.find(0);
+    {
+        std::vector<int> bucket(n, -1);
+        std::vector<int> count;
+        for (const Branch& br : branches) {
+            const int r = all.find(br.a);
+            if (r == groundAll) continue;
+            if (bucket[r] < 0) { bucket[r] = static_cast<int>(count.size()); count.push_back(0); }
+            ++count[bucket[r]];
+        }
+        report.islands.resize(count.size());
+        for (size_t k = 0; k < count.size(); ++k) report.islands[k].reserve(count[k]);
+        for (const Branch& br : branches) {
+            const int r = all.find(br.a);
+            if (r == groundAll) continue;
+            auto& island = report.islands[bucket[r]];
+            if (island.empty() || island.back() != br.elem) island.push_back(br.elem);
+        }
+    }
+
+    // Loops: each closing branch plus the forest path between its ends
+    if (!closing.empty()) {
+        std::vector<int> offset(n + 1, 0), adjNode(2 * forest.size()), adjElem(2 * forest.size());
+        for (const Branch& e : forest) { ++offset[e.a + 1]; ++offset[e.b + 1]; }
+        std::partial_sum(offset.begin(), offset.end(), offset.begin());
+        std::vector<int> fill(offset.begin(), offset.end() - 1);
+        for (const Branch& e : forest) {
+            adjNode[fill[e.a]] = e.b; adjElem[fill[e.a]++] = e.elem;
+            adjNode[fill[e.b]] = e.a; adjElem[fill[e.b]++] = e.elem;
+        }
+
+        // BFS parents and depths for the trees that carry a closing branch
+        std::vector<int> parent(n, -2), parentElem(n, -1), depth(n, 0), queue;
+        auto root = [&](int s) {
+            if (parent[s] != -2) return;
+            parent[s] = -1;
+            queue.assign(1, s);
+            for (size_t q = 0; q < queue.size(); ++q) {
+                const int u = queue[q];
+                for (int k = offset[u]; k < offset[u + 1]; ++k) {
+                    const int v = adjNode[k];
+                    if (parent[v] != -2) continue;
+                    parent[v] = u;
+                    parentElem[v] = adjElem[k];
+                    depth[v] = depth[u] + 1;
+                    queue.push_back(v);
+                }
+            }
+        };
+
+        for (const Branch& c : closing) {
+            if (report.loops.size() == MAX_LOOPS) {
+                report.loopsTruncated = true;
+                break;
+            }
+            root(c.a);
+            std::vector<int> loop{c.elem};
+            int a = c.a, b = c.b;
+            while (a != b) {
+                if (depth[a] >= depth[b]) { loop.push_back(parentElem[a]); a = parent[a]; }
+                else { loop.push_back(parentElem[b]); b = parent[b]; }
+            }
+            report.loops.push_back(std::move(loop));
+        }
+    }
+
+    // Cutsets: a dc component without ground, inside the grounded island, is reached only
+    // through current sources and capacitors; those elements form its cutset
+    {
+        const int groundDc = dc.find(0);
+        std::vector<int> bucket(n, -1);
+        for (const Branch& br : branches) {
+            const Element* e = elements[br.elem];
+            if (kindOf(e) != Kind::Current || all.find(br.a) != groundAll) continue;
+            const int ra = dc.find(br.a), rb = dc.find(br.b);
+            if (ra == rb) continue;
+            for (int r : {ra, rb}) {
+                if (r == groundDc) continue;
+                if (bucket[r] < 0) { bucket[r] = static_cast<int>(report.cutsets.size()); report.cutsets.emplace_back(); }
+                auto& cut = report.cutsets[bucket[r]];
+                cut.elements.push_back(br.elem);
+                cut.driven = cut.driven || isCurrentSource(e);
+            }
+        }
+    }
+    return report;
+}
+
+void TopologyReport::print(const Graph& g, std::ostream& os) const {
+    const auto& elements = g.getElements();
+    auto names = [&](const std::vector<int>& list) {
+        std::string s;
+        for (size_t i = 0; i < list.size() && i < MAX_NAMES; ++i) {
+            if (i) s += ", ";
+            s += elements[list[i]]->name;
+        }
+        if (list.size() > MAX_NAMES) s += ", ... (" + std::to_string(list.size()) + " elements)";
+        return s;
+    };
+
+    for (const auto& island : islands)
+        os << "Error: floating island with no path to ground: " << names(island) << "\n";
+    for (const auto& loop : loops) {
+        if (loop.size() == 1) os << "Error: " << elements[loop[0]]->name << " is shorted (both terminals on one node)\n";
+        else os << "Error: loop of voltage sources/inductors: " << names(loop) << "\n";
+    }
+    if (loopsTruncated) os << "Error: (only the first " << MAX_LOOPS << " loops are listed)\n";
+    for (const auto& cut : cutsets) {
+        if (cut.driven) os << "Error: current source with no DC return path, cutset: " << names(cut.elements) << "\n";
+        else os << "Warning: no DC path to ground except through: " << names(cut.elements) << " (held by gmin)\n";
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef MORGHSPICY_TOPOLOGY_H
+#define MORGHSPICY_TOPOLOGY_H
+
+#pragma once
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+class Graph;
+
+// Structural problems that make the MNA matrix singular (or the DC answer meaningless),
+// found before any matrix is built. Entries are indices into Graph::getElements().
+//   islands: groups of elements with no connection to ground at all
+//   loops:   loops made only of voltage-defined branches (V, E, H, sources, and L at DC)
+//   cutsets: node groups reached only through current sources and capacitors; `driven`
+//            ones contain a current source (its current has nowhere to go), the others
+//            are just without a DC path to ground and are held by gmin
+struct TopologyReport {
+    struct Cutset {
+        std::vector<int> elements;
+        bool driven = false;
+    };
+
+    std::vector<std::vector<int>> islands;
+    std::vector<std::vector<int>> loops;
+    bool loopsTruncated = false;   // more loops exist than are listed
+    std::vector<Cutset> cutsets;
+
+    bool clean() const { return islands.empty() && loops.empty() && cutsets.empty(); }
+    // No islands, loops or driven cutsets: the DC system is solvable
+    bool dcSolvable() const;
+
+    // One line per problem, naming the elements ("Error: ..." / "Warning: ...")
+    void print(const Graph& g, std::ostream& os) const;
+};
+
+// Union-find over the element terminals, then a CSR walk of the voltage-branch forest to
+// name each loop. Linear in the number of elements (plus the length of reported loops).
+TopologyReport checkTopology(const Graph& g);
+
+#endif //MORGHSPICY_TOPOLOGY_H
@@ -0,0 +1,60 @@
+#include "VecMath.h"
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+namespace vecmath {
+
+namespace {
+    constexpr double log2e = 1.4426950408889634074;
+    constexpr double ln2hi = 6.93147180369123816490e-01;
+    constexpr double ln2lo = 1.90821492927058770002e-10;
+    constexpr double c[14] = {1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0,
+                              1.0 / 362880.0, 1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0,
+                              1.0 / 24.0, 1.0 / 6.0, 0.5, 1.0, 1.0};
+}
+
+#if defined(__AVX512F__)
+void exp(const double* x, double* y, std::size_t n) {
+    const __m512d lo = _mm512_set1_pd(EXP_MIN), hi = _mm512_set1_pd(EXP_MAX);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d v = _mm512_min_pd(_mm512_max_pd(_mm512_loadu_pd(x + i), lo), hi);
+        __m512d kd = _mm512_roundscale_pd(_mm512_mul_pd(v, _mm512_set1_pd(log2e)),
+                                          _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512d r = _mm512_fnmadd_pd(kd, _mm512_set1_pd(ln2hi), v);
+        r = _mm512_fnmadd_pd(kd, _mm512_set1_pd(ln2lo), r);
+        __m512d p = _mm512_set1_pd(c[0]);
+        for (int j = 1; j < 14; ++j) p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c[j]));
+        _mm512_storeu_pd(y + i, _mm512_scalef_pd(p, kd));
+    }
+    for (; i < n; ++i) y[i] = expScalar(x[i]);
+}
+#elif defined(__AVX2__) && defined(__FMA__)
+void exp(const double* x, double* y, std::size_t n) {
+    const __m256d lo = _mm256_set1_pd(EXP_MIN), hi = _mm256_set1_pd(EXP_MAX);
+    // 1.5 * 2^52 + 1023: after the add, the low mantissa bits hold k + 1023
+    const __m256d bias = _mm256_set1_pd(6755399441055744.0 + 1023.0);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(x + i), lo), hi);
+        __m256d kd = _mm256_round_pd(_mm256_mul_pd(v, _mm256_set1_pd(log2e)),
+                                     _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256d r = _mm256_fnmadd_pd(kd, _mm256_set1_pd(ln2hi), v);
+        r = _mm256_fnmadd_pd(kd, _mm256_set1_pd(ln2lo), r);
+        __m256d p = _mm256_set1_pd(c[0]);
+        for (int j = 1; j < 14; ++j) p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c[j]));
+        __m256i e = _mm256_slli_epi64(_mm256_castpd_si256(_mm256_add_pd(kd, bias)), 52);
+        _mm256_storeu_pd(y + i, _mm256_mul_pd(p, _mm256_castsi256_pd(e)));
+    }
+    for (; i < n; ++i) y[i] = expScalar(x[i]);
+}
+#else
+void exp(const double* x, double* y, std::size_t n) {
+    // Branch-free, so the compiler can still vectorize it with whatever the target has
+    for (std::size_t i = 0; i < n; ++i) y[i] = expScalar(x[i]);
+}
+#endif
+
+}
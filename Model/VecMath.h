@@ -0,0 +1,47 @@
+#ifndef MORGHSPICY_VECMATH_H
+#define MORGHSPICY_VECMATH_H
+
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Batched elementary functions for the device kernels.
+// exp: x = k ln2 + r with |r| <= ln2/2 (Cody-Waite split of ln2), exp(r) by a degree-13
+// polynomial, then 2^k is put straight into the exponent bits. Relative error is a few ulp.
+// Arguments are clamped to [-708, 709], so the result never overflows or goes subnormal.
+namespace vecmath {
+    constexpr double EXP_MIN = -708.0;
+    constexpr double EXP_MAX = 709.0;
+
+    inline double expScalar(double x) {
+        constexpr double log2e = 1.4426950408889634074;
+        constexpr double ln2hi = 6.93147180369123816490e-01;
+        constexpr double ln2lo = 1.90821492927058770002e-10;
+        constexpr double shifter = 6755399441055744.0;     // 1.5 * 2^52: adding it rounds to an integer
+        x = x < EXP_MIN ? EXP_MIN : (x > EXP_MAX ? EXP_MAX : x);
+        double kd = (x * log2e + shifter) - shifter;
+        double r = (x - kd * ln2hi) - kd * ln2lo;
+        double p = 1.0 / 6227020800.0;
+        p = p * r + 1.0 / 479001600.0;
+        p = p * r + 1.0 / 39916800.0;
+        p = p * r + 1.0 / 3628800.0;
+        p = p * r + 1.0 / 362880.0;
+        p = p * r + 1.0 / 40320.0;
+        p = p * r + 1.0 / 5040.0;
+        p = p * r + 1.0 / 720.0;
+        p = p * r + 1.0 / 120.0;
+        p = p * r + 1.0 / 24.0;
+        p = p * r + 1.0 / 6.0;
+        p = p * r + 0.5;
+        p = p * r + 1.0;
+        p = p * r + 1.0;
+        auto k = static_cast<std::int64_t>(kd);
+        return p * std::bit_cast<double>(static_cast<std::uint64_t>(k + 1023) << 52);
+    }
+
+    // y[i] = exp(x[i]); AVX-512 or AVX2+FMA when compiled for them, otherwise a plain loop
+    void exp(const double* x, double* y, std::size_t n);
+}
+
+#endif //MORGHSPICY_VECMATH_H
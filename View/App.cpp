@@ -81,6 +81,11 @@ void App::cleanup() {
 
 void App::showPlot(const PlotData& pd) {
     plotter.clear();
+    switch (pd.axis) {
+        case PlotAxis::Frequency: plotter.setMode(PlotMode::Frequency); break;
+        case PlotAxis::Phase:     plotter.setMode(PlotMode::Phase);     break;
+        default:                  plotter.setMode(PlotMode::Time);      break;
+    }
     for (size_t k = 0; k < pd.data_series.size(); ++k) {
         plotter.addSeries(
                 (k < pd.series_names.size() ? pd.series_names[k] : "sig_" + std::to_string(k)),
@@ -91,11 +96,11 @@ void App::showPlot(const PlotData& pd) {
 
 void App::loadAndPlotSignal(const std::string& path, double Fs, double tStop, int chunkSize) {
     Signal s(path, Fs, tStop, chunkSize);
-    auto pairs = s.readAllAsPoints();  // internally chunked, but returns full (t,y)
-    std::vector<Point> pts; pts.reserve(pairs.size());
-    for (auto& pr : pairs) pts.push_back({ pr.first, pr.second });
-    plotter.addSeries(path, pts);
-    std::cout << "[Signal] Loaded: " << pts.size() << " samples\n";
+    const SignalChunk all = s.readAll();  // mapped; raw float64 is not even copied
+    std::vector<Point> pts(all.size());
+    for (size_t i = 0; i < all.size(); ++i) pts[i] = { all.time(i), all.samples[i] };
+    plotter.addSeries(path, std::move(pts));
+    std::cout << "[Signal] Loaded: " << all.size() << " samples\n";
 }
 
 void App::loadAndPlotSignal(const std::string& path, double Fs, double tStop, int chunkSize, bool byChunks) {
@@ -104,14 +109,17 @@ void App::loadAndPlotSignal(const std::string& path, double Fs, double tStop, in
     // Demo streaming: load only the first chunk
     Signal s(path, Fs, tStop, chunkSize);
     if (!s.open()) { std::cerr << "[Signal] Cannot open: " << path << "\n"; return; }
-    std::vector<std::pair<double,double>> pairs;
-    if (s.readNextChunk()) s.appendCurrentChunkAsPoints(pairs, 0.0);
+    std::vector<Point> pts;
+    if (s.readNextChunk()) {
+        const SignalChunk c = s.currentChunk();
+        pts.resize(c.size());
+        for (size_t i = 0; i < c.size(); ++i) pts[i] = { c.time(i), c.samples[i] };
+    }
     s.close();
 
-    std::vector<Point> pts; pts.reserve(pairs.size());
-    for (auto& pr : pairs) pts.push_back({ pr.first, pr.second });
-    plotter.addSeries(path + " (chunk)", pts);
-    std::cout << "[Signal] Loaded first chunk: " << pts.size() << " samples (chunk=" << chunkSize << ")\n";
+    const size_t n = pts.size();
+    plotter.addSeries(path + " (chunk)", std::move(pts));
+    std::cout << "[Signal] Loaded first chunk: " << n << " samples (chunk=" << chunkSize << ")\n";
 }
 
 void App::handleEvents() {
@@ -296,6 +304,7 @@ int App::run() {
             this->loadAndPlotSignal(p, Fs, t, c);
         };
         parser.onScopeClear = [this](){ this->plotter.clear(); };
+        parser.onPlot = [this](const PlotData& pd){ this->showPlot(pd); };
         parser.parseCommand("load schematics/rc_step.txt");
 
         // Run once so there's a plot on screen
@@ -10,7 +10,7 @@
 #include <string>
 #include "View/Plotter.h"
 #include "Controller/SimulationRunner.h"
-#include "Controller/Signal.h"
+#include "Model/Signal.h"
 #include "Model/MNASolver.h"
 #include "Model/NodeManager.h"
 #include "Model/Graph.h"
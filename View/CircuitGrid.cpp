@@ -523,18 +523,18 @@ std::optional<double> CircuitGrid::parseEng(const std::string& sraw) {
         int n2 = nm->getOrCreateNodeId(pe.n2);
 
         if (pe.kind == "Resistor") {
-            g->addElement(new Resistor(pe.name, n1, n2, pe.value));
+            g->addElement(g->make<Resistor>(pe.name, n1, n2, pe.value));
         } else if (pe.kind == "Capacitor") {
-            g->addElement(new Capacitor(pe.name, n1, n2, pe.value));
+            g->addElement(g->make<Capacitor>(pe.name, n1, n2, pe.value));
         } else if (pe.kind == "Inductor") {
-            g->addElement(new Inductor(pe.name, n1, n2, pe.value));
+            g->addElement(g->make<Inductor>(pe.name, n1, n2, pe.value));
         } else if (pe.kind == "VoltageSource") {
-            g->addElement(new VoltageSource(pe.name, n1, n2, pe.value));
+            g->addElement(g->make<VoltageSource>(pe.name, n1, n2, pe.value));
         } else if (pe.kind == "CurrentSource") {
-            g->addElement(new CurrentSource(pe.name, n1, n2, pe.value));
+            g->addElement(g->make<CurrentSource>(pe.name, n1, n2, pe.value));
         } else if (pe.kind == "Diode") {
             std::string model = pe.valueStr.empty() ? "default" : pe.valueStr;
-            g->addElement(new Diode(pe.name, n1, n2, model));
+            g->addElement(g->make<Diode>(pe.name, n1, n2, model));
         } else if (pe.kind == "Ground") {
             nm->assignNodeAsGND(pe.n1); // نود n1 زمین شود
         }
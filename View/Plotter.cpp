@@ -22,11 +22,11 @@ void Plotter::clear() {
 }
 
 void Plotter::addSeries(const std::string& name,
-                        const std::vector<Point>& pts,
+                        std::vector<Point> pts,
                         std::optional<SDL_Color> color) {
     Series s;
     s.name = name;
-    s.points = pts;
+    s.points = std::move(pts);
     s.color = color.value_or(palette[series.size() % (sizeof(palette)/sizeof(palette[0]))]);
     series.push_back(std::move(s));
     recomputeBounds();
@@ -88,6 +88,11 @@ SDL_FPoint Plotter::worldToScreen(double x, double y) const {
     return SDL_FPoint{sx, sy};
 }
 
+double Plotter::axisX(double x) const {
+    if (mode == PlotMode::Frequency) return std::log10(std::max(x, 1e-300));
+    return x;
+}
+
 void Plotter::drawGrid(SDL_Renderer* r) const {
     SDL_SetRenderDrawColor(r, 230,230,230,255);
     int nx = 10, ny = 8;
@@ -139,7 +144,7 @@ void Plotter::render(SDL_Renderer* r) {
         SDL_SetRenderDrawColor(r, s.color.r, s.color.g, s.color.b, alpha);
 
         std::vector<SDL_FPoint> pts; pts.reserve(s.points.size());
-        for (const auto& p : s.points) pts.push_back(worldToScreen(p.x, p.y));
+        for (const auto& p : s.points) pts.push_back(worldToScreen(axisX(p.x), p.y));
         SDL_RenderLines(r, pts.data(), (int)pts.size());
     }
     drawCursors(r);
@@ -152,7 +157,7 @@ void Plotter::recomputeBounds() {
     minX=minY=1e300; maxX=maxY=-1e300;
     for (const auto& s : series)
         for (const auto& p : s.points) {
-            minX = std::min(minX, p.x); maxX = std::max(maxX, p.x);
+            minX = std::min(minX, axisX(p.x)); maxX = std::max(maxX, axisX(p.x));
             minY = std::min(minY, p.y); maxY = std::max(maxY, p.y);
         }
 }
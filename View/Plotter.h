@@ -29,13 +29,13 @@ public:
     // data
     void clear();
     void addSeries(const std::string& name,
-                   const std::vector<Point>& pts,
+                   std::vector<Point> pts,
                    std::optional<SDL_Color> color = std::nullopt);
 
     // view
     void setAutoZoom(bool on);
     void applyAutoZoom();
-    void setMode(PlotMode m) { mode = m; }
+    void setMode(PlotMode m) { mode = m; recomputeBounds(); if (autoZoom) applyAutoZoom(); }
 
     // interaction
     void handleEvent(const SDL_Event& e);
@@ -100,6 +100,7 @@ private:
     void drawLegend(SDL_Renderer* r) const;
     void drawCursors(SDL_Renderer* r) const;
     SDL_FPoint worldToScreen(double x, double y) const;
+    double axisX(double x) const; // Frequency mode plots log10(f)
     void recomputeBounds();
 };
 